@@ -0,0 +1,118 @@
+#ifndef HOST_3DS_H
+#define HOST_3DS_H
+
+/*
+    Host stand-in for the parts of libctru used by the box-art pipeline.
+    Only what the host build compiles is provided here; anything the
+    renderer needs stays device-only.
+*/
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+
+typedef uint8_t  u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int8_t   s8;
+typedef int16_t  s16;
+typedef int32_t  s32;
+typedef int64_t  s64;
+
+typedef s32 Result;
+typedef u32 Handle;
+
+#define U64_MAX UINT64_MAX
+#define BIT(n)  (1U << (n))
+
+#define R_SUCCEEDED(res) ((res) >= 0)
+#define R_FAILED(res)    ((res) < 0)
+
+// Linear heap. On the host this is ordinary heap memory.
+void* linearAlloc(size_t size);
+void  linearFree(void* mem);
+
+// Milliseconds since the Unix epoch, like osGetTime() on the console.
+u64 osGetTime(void);
+
+// Monotonic clock counting at the ARM11 system clock rate, like the console's tick counter.
+#define SYSCLOCK_ARM11     268111856
+#define CPU_TICKS_PER_MSEC (SYSCLOCK_ARM11 / 1000.0)
+#define CPU_TICKS_PER_USEC (SYSCLOCK_ARM11 / 1000000.0)
+
+u64 svcGetSystemTick(void);
+
+// Threads. On the host these are pthreads; the priority is ignored. A core_id of 0 or more
+// pins the thread to that CPU and fails if the CPU does not exist, like an unavailable core
+// on the console.
+typedef struct Thread_tag* Thread;
+typedef void (*ThreadFunc)(void* arg);
+
+#define CUR_THREAD_HANDLE 0xFFFF8000
+
+Thread threadCreate(ThreadFunc entrypoint, void* arg, size_t stack_size, int prio, int core_id, bool detached);
+Result threadJoin(Thread thread, u64 timeout_ns);
+void   threadFree(Thread thread);
+Result svcGetThreadPriority(s32* out, Handle handle);
+void   svcSleepThread(s64 ns);
+
+// System core time and New 3DS clock. The host has no such limits; these only report success.
+Result APT_CheckNew3DS(bool* out);
+Result APT_SetAppCpuTimeLimit(u32 percent);
+void   osSetSpeedupEnable(bool enable);
+
+// Light events, built on a mutex and condition variable instead of the kernel's arbiter
+typedef enum {
+    RESET_ONESHOT = 0,
+    RESET_STICKY  = 1,
+} ResetType;
+
+typedef struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t  cond;
+    bool            signalled;
+    ResetType       type;
+} LightEvent;
+
+void LightEvent_Init(LightEvent* event, ResetType reset_type);
+void LightEvent_Clear(LightEvent* event);
+void LightEvent_Signal(LightEvent* event);
+void LightEvent_Wait(LightEvent* event);
+
+// Light locks, a plain mutex on the host
+typedef pthread_mutex_t LightLock;
+
+void LightLock_Init(LightLock* lock);
+void LightLock_Lock(LightLock* lock);
+void LightLock_Unlock(LightLock* lock);
+
+// File system service, with files opened directly on the host file system and read with
+// pread. Archives other than the SD card are not provided.
+typedef enum {
+    ARCHIVE_SDMC = 0x9,
+} FS_ArchiveID;
+
+typedef enum {
+    PATH_EMPTY  = 1,
+    PATH_BINARY = 2,
+    PATH_ASCII  = 3,
+} FS_PathType;
+
+typedef struct {
+    FS_PathType type;
+    u32         size;
+    const void* data;
+} FS_Path;
+
+#define FS_OPEN_READ BIT(0)
+
+FS_Path fsMakePath(FS_PathType type, const void* path);
+Result  FSUSER_OpenFileDirectly(Handle* out, FS_ArchiveID archiveId, FS_Path archivePath, FS_Path filePath,
+                                u32 openFlags, u32 attributes);
+Result  FSFILE_Read(Handle handle, u32* bytesRead, u64 offset, void* buffer, u32 size);
+Result  FSFILE_GetSize(Handle handle, u64* size);
+Result  FSFILE_Close(Handle handle);
+
+#endif // HOST_3DS_H
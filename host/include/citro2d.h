@@ -0,0 +1,37 @@
+#ifndef HOST_CITRO2D_H
+#define HOST_CITRO2D_H
+
+#include <citro3d.h>
+#include <tex3ds.h>
+
+typedef struct {
+    C3D_Tex*                 tex;
+    const Tex3DS_SubTexture* subtex;
+} C2D_Image;
+
+typedef struct C2D_ImageTint C2D_ImageTint;
+
+// Parsed text; only its measurements are kept on the host
+typedef struct {
+    float width;
+    u32   lines;
+} C2D_Text;
+
+// C2D_DrawText flags
+#define C2D_WithColor BIT(1)
+#define C2D_WordWrap  BIT(4)
+
+// Nothing is drawn on the host; draws are counted in hostImageDraws, hostRectDraws and
+// hostTextDraws, and those made while blending is on in hostBlendedDraws
+bool C2D_DrawImageAt(C2D_Image img, float x, float y, float depth, const C2D_ImageTint* tint, float scaleX,
+                     float scaleY);
+bool C2D_DrawRectSolid(float x, float y, float z, float w, float h, u32 clr);
+void C2D_DrawText(const C2D_Text* text, u32 flags, float x, float y, float z, float scaleX, float scaleY, ...);
+void C2D_Flush(void);
+
+extern u32 hostImageDraws;
+extern u32 hostRectDraws;
+extern u32 hostTextDraws;
+extern u32 hostBlendedDraws;
+
+#endif // HOST_CITRO2D_H
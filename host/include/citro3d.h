@@ -0,0 +1,72 @@
+#ifndef HOST_CITRO3D_H
+#define HOST_CITRO3D_H
+
+#include <3ds.h>
+
+// Texture formats, numbered as on the PICA200.
+typedef enum {
+    GPU_RGBA8    = 0x0,
+    GPU_RGB8     = 0x1,
+    GPU_RGBA5551 = 0x2,
+    GPU_RGB565   = 0x3,
+    GPU_RGBA4    = 0x4,
+    GPU_LA8      = 0x5,
+    GPU_HILO8    = 0x6,
+    GPU_L8       = 0x7,
+    GPU_A8       = 0x8,
+    GPU_LA4      = 0x9,
+    GPU_L4       = 0xA,
+    GPU_A4       = 0xB,
+    GPU_ETC1     = 0xC,
+    GPU_ETC1A4   = 0xD,
+} GPU_TEXCOLOR;
+
+typedef enum {
+    GPU_NEAREST = 0x0,
+    GPU_LINEAR  = 0x1,
+} GPU_TEXTURE_FILTER_PARAM;
+
+typedef enum {
+    GPU_CLAMP_TO_EDGE   = 0x0,
+    GPU_CLAMP_TO_BORDER = 0x1,
+    GPU_REPEAT          = 0x2,
+    GPU_MIRRORED_REPEAT = 0x3,
+} GPU_TEXTURE_WRAP_PARAM;
+
+typedef struct C3D_Tex {
+    void*        data;
+    GPU_TEXCOLOR fmt;
+    size_t       size;
+    u16          height;
+    u16          width;
+    u32          param;
+    u32          border;
+} C3D_Tex;
+
+typedef enum {
+    GPU_BLEND_ADD = 0,
+} GPU_BLENDEQUATION;
+
+typedef enum {
+    GPU_SRC_ALPHA           = 6,
+    GPU_ONE_MINUS_SRC_ALPHA = 7,
+} GPU_BLENDFACTOR;
+
+typedef enum {
+    GPU_LOGICOP_COPY = 3,
+} GPU_LOGICOP;
+
+bool C3D_TexInit(C3D_Tex* tex, u16 width, u16 height, GPU_TEXCOLOR format);
+void C3D_TexSetFilter(C3D_Tex* tex, GPU_TEXTURE_FILTER_PARAM magFilter, GPU_TEXTURE_FILTER_PARAM minFilter);
+void C3D_TexSetWrap(C3D_Tex* tex, GPU_TEXTURE_WRAP_PARAM wrapS, GPU_TEXTURE_WRAP_PARAM wrapT);
+void C3D_TexFlush(C3D_Tex* tex);
+void C3D_TexDelete(C3D_Tex* tex);
+
+// Blending turns on with C3D_AlphaBlend and off with C3D_ColorLogicOp; the host tracks it in hostBlending
+void C3D_AlphaBlend(GPU_BLENDEQUATION colorEq, GPU_BLENDEQUATION alphaEq, GPU_BLENDFACTOR srcClr,
+                    GPU_BLENDFACTOR dstClr, GPU_BLENDFACTOR srcAlpha, GPU_BLENDFACTOR dstAlpha);
+void C3D_ColorLogicOp(GPU_LOGICOP op);
+
+extern bool hostBlending;
+
+#endif // HOST_CITRO3D_H
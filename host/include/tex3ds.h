@@ -0,0 +1,26 @@
+#ifndef HOST_TEX3DS_H
+#define HOST_TEX3DS_H
+
+#include <stdio.h>
+#include <3ds.h>
+#include <citro3d.h>
+
+// Sub-texture description, laid out like the one in libtex3ds.
+typedef struct {
+    u16   width;
+    u16   height;
+    float left;
+    float top;
+    float right;
+    float bottom;
+} Tex3DS_SubTexture;
+
+// Imported .t3x texture. The host has no tex3ds output to read, so imports always fail.
+typedef struct Tex3DS_Texture_s* Tex3DS_Texture;
+typedef struct C3D_TexCube C3D_TexCube;
+
+Tex3DS_Texture           Tex3DS_TextureImportStdio(FILE* fp, C3D_Tex* tex, C3D_TexCube* texcube, bool vram);
+const Tex3DS_SubTexture* Tex3DS_GetSubTexture(const Tex3DS_Texture texture, size_t index);
+void                     Tex3DS_TextureFree(Tex3DS_Texture texture);
+
+#endif // HOST_TEX3DS_H
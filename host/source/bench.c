@@ -0,0 +1,2205 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <malloc.h>
+#include <time.h>
+#include <unistd.h>
+#include <math.h>
+#include <stdatomic.h>
+#include "lodepng.h"
+#include "etc1.h"
+#include "texcache.h"
+#include "atlas.h"
+#include "loader.h"
+#include "residency.h"
+#include "framebudget.h"
+#include "bundle.h"
+#include "prefetch.h"
+#include "ioqueue.h"
+#include "pixels.h"
+#include "jobs.h"
+#include "tiledimage.h"
+#include "carousel.h"
+#include "displaylist.h"
+#include "texture.h"
+
+/*
+    Host benchmark for the box-art load pipeline.
+
+    Runs the loader over the images/gameN.png set and over a synthetic corpus
+    of generated PNGs, and reports ms/image, MB/s of decoded RGBA and the peak
+    heap a single conversion needs. Heap usage is tracked by wrapping the
+    allocator at link time (see host/Makefile).
+*/
+
+#define DEFAULT_ITERATIONS 20
+#define MAX_CORPUS 64
+
+// Checks that failed or cases that could not run; main returns non-zero when there are any.
+// Checks that leave nothing to go on with exit(1) instead.
+static int benchFailures;
+
+static void benchFailed(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+    benchFailures++;
+}
+
+//---------------------------------------------------------------------------------
+// Heap tracking
+//---------------------------------------------------------------------------------
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+void  __real_free(void* ptr);
+
+// Atomic because the loader thread allocates too; the peak is approximate while it runs
+static _Atomic size_t heapCurrent;
+static _Atomic size_t heapPeak;
+
+static void heapAdd(void* ptr) {
+    if (ptr) {
+        size_t current = atomic_fetch_add(&heapCurrent, malloc_usable_size(ptr)) + malloc_usable_size(ptr);
+        if (current > heapPeak) heapPeak = current;
+    }
+}
+
+static void heapRemove(void* ptr) {
+    if (ptr) atomic_fetch_sub(&heapCurrent, malloc_usable_size(ptr));
+}
+
+// A malloc of exactly this many bytes fails, to check that running out of memory is handled
+static _Atomic size_t heapFailSize;
+
+void* __wrap_malloc(size_t size) {
+    if (size && size == heapFailSize) return NULL;
+    void* ptr = __real_malloc(size);
+    heapAdd(ptr);
+    return ptr;
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+    void* ptr = __real_calloc(count, size);
+    heapAdd(ptr);
+    return ptr;
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+    heapRemove(ptr);
+    void* result = __real_realloc(ptr, size);
+    // On failure the original block is still allocated
+    heapAdd(result ? result : ptr);
+    return result;
+}
+
+void __wrap_free(void* ptr) {
+    heapRemove(ptr);
+    __real_free(ptr);
+}
+
+//---------------------------------------------------------------------------------
+// Corpus
+//---------------------------------------------------------------------------------
+typedef struct {
+    char           name[64];
+    char           path[256]; // Empty for images that only exist in memory
+    unsigned char* png;
+    size_t         pngsize;
+    unsigned       width, height;
+} BenchImage;
+
+typedef struct {
+    const char* name;
+    BenchImage  images[MAX_CORPUS];
+    int         count;
+} BenchCorpus;
+
+// CPU time of the calling thread; unlike the clock it leaves out time the host spent elsewhere
+static double threadMs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static double nowMs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static int loadImageSet(BenchCorpus* corpus, const char* dir) {
+    corpus->name  = "images";
+    corpus->count = 0;
+
+    // Same naming scheme as initializeBoxes: game0.png, game1.png, ...
+    for (int i = 0; i < MAX_CORPUS; i++) {
+        BenchImage* image = &corpus->images[corpus->count];
+        snprintf(image->path, sizeof(image->path), "%s/game%d.png", dir, i);
+        if (lodepng_load_file(&image->png, &image->pngsize, image->path)) break;
+
+        LodePNGState state;
+        lodepng_state_init(&state);
+        lodepng_inspect(&image->width, &image->height, &state, image->png, image->pngsize);
+        lodepng_state_cleanup(&state);
+
+        snprintf(image->name, sizeof(image->name), "game%d.png", i);
+        corpus->count++;
+    }
+
+    return corpus->count;
+}
+
+static void addSyntheticImage(BenchCorpus* corpus, unsigned width, unsigned height, bool alpha, u32 seed) {
+    BenchImage* image = &corpus->images[corpus->count];
+    unsigned char* pixels = malloc((size_t)width * height * 4);
+
+    // Smooth gradients with a little noise compress roughly like real cover art
+    for (unsigned y = 0; y < height; y++) {
+        for (unsigned x = 0; x < width; x++) {
+            seed = seed * 1664525u + 1013904223u;
+            unsigned char* p = &pixels[((size_t)y * width + x) * 4];
+            p[0] = (unsigned char)(x * 255 / width + ((seed >> 24) & 7));
+            p[1] = (unsigned char)(y * 255 / height + ((seed >> 16) & 7));
+            p[2] = (unsigned char)((x + y) * 127 / (width + height) + ((seed >> 8) & 15));
+            p[3] = alpha ? (unsigned char)(255 - ((x ^ y) & 63)) : 255;
+        }
+    }
+
+    lodepng_encode32(&image->png, &image->pngsize, pixels, width, height);
+    free(pixels);
+
+    image->path[0] = '\0';
+    image->width   = width;
+    image->height  = height;
+    snprintf(image->name, sizeof(image->name), "%ux%u%s", width, height, alpha ? " alpha" : "");
+    corpus->count++;
+}
+
+static void buildSyntheticCorpus(BenchCorpus* corpus) {
+    corpus->name  = "synthetic";
+    corpus->count = 0;
+
+    addSyntheticImage(corpus, 64, 64, false, 1);
+    addSyntheticImage(corpus, 128, 130, false, 2);
+    addSyntheticImage(corpus, 128, 130, true, 3);
+    addSyntheticImage(corpus, 256, 256, false, 4);
+    addSyntheticImage(corpus, 400, 240, false, 5);
+    addSyntheticImage(corpus, 512, 512, true, 6);
+    addSyntheticImage(corpus, 1024, 600, false, 7);
+}
+
+// Builds a palette of 8 red, 8 green and 4 blue levels, which every pixel of a palette image is snapped to.
+// With 'transparent' the entries without blue are fully transparent.
+static void addBenchPalette(LodePNGColorMode* mode, bool transparent) {
+    for (u32 i = 0; i < 256; i++) {
+        lodepng_palette_add(mode, (i >> 5) * 0x24, ((i >> 2) & 7) * 0x24, (i & 3) * 0x55,
+                            transparent && !(i & 3) ? 0 : 255);
+    }
+}
+
+// Adds an image encoded in exactly 'colortype'. With 'trns' a palette image gets transparent entries and a
+// gray or RGB image a color key, both stored in a tRNS chunk.
+static void addNativeImage(BenchCorpus* corpus, unsigned width, unsigned height, LodePNGColorType colortype, bool trns,
+                           u32 seed) {
+    static const char* names[] = { "gray", "", "rgb", "palette", "gray+alpha", "", "rgba" };
+    BenchImage* image = &corpus->images[corpus->count];
+    unsigned char* pixels = malloc((size_t)width * height * 4);
+
+    for (unsigned y = 0; y < height; y++) {
+        for (unsigned x = 0; x < width; x++) {
+            seed = seed * 1664525u + 1013904223u;
+            unsigned char* p = &pixels[((size_t)y * width + x) * 4];
+            p[0] = (unsigned char)(x * 255 / width + ((seed >> 24) & 7));
+            p[1] = (unsigned char)(y * 255 / height + ((seed >> 16) & 7));
+            p[2] = (unsigned char)((x + y) * 127 / (width + height) + ((seed >> 8) & 15));
+            p[3] = (unsigned char)(255 - ((x ^ y) & 63));
+            if (!(colortype & 4)) p[3] = 255;
+            if (colortype == LCT_GREY || colortype == LCT_GREY_ALPHA) p[1] = p[2] = p[0];
+            if (colortype == LCT_PALETTE) {
+                p[0] = (p[0] >> 5) * 0x24;
+                p[1] = (p[1] >> 5) * 0x24;
+                p[2] = (p[2] >> 6) * 0x55;
+                if (trns && !p[2]) p[3] = 0;
+            }
+        }
+    }
+
+    // Encode in exactly this color type rather than whatever lodepng finds smallest
+    LodePNGState state;
+    lodepng_state_init(&state);
+    state.encoder.auto_convert     = 0;
+    state.info_png.color.colortype = colortype;
+    state.info_png.color.bitdepth  = 8;
+    if (colortype == LCT_PALETTE) addBenchPalette(&state.info_png.color, trns);
+    if (colortype != LCT_PALETTE && trns) {
+        state.info_png.color.key_defined = 1;
+        state.info_png.color.key_r = pixels[0];
+        state.info_png.color.key_g = pixels[1];
+        state.info_png.color.key_b = pixels[2];
+    }
+    if (lodepng_encode(&image->png, &image->pngsize, pixels, width, height, &state)) {
+        fprintf(stderr, "cannot encode a %s image\n", names[colortype]);
+        exit(1);
+    }
+    lodepng_state_cleanup(&state);
+    free(pixels);
+
+    image->path[0] = '\0';
+    image->width   = width;
+    image->height  = height;
+    snprintf(image->name, sizeof(image->name), "%ux%u %s%s", width, height, names[colortype], trns ? " trns" : "");
+    corpus->count++;
+}
+
+// One image per 8-bit color type, to cover every pixel conversion kernel
+static void buildNativeCorpus(BenchCorpus* corpus) {
+    corpus->name  = "native";
+    corpus->count = 0;
+
+    addNativeImage(corpus, 128, 130, LCT_GREY, false, 11);
+    addNativeImage(corpus, 128, 130, LCT_GREY_ALPHA, false, 12);
+    addNativeImage(corpus, 128, 130, LCT_RGB, false, 13);
+    addNativeImage(corpus, 128, 130, LCT_RGBA, false, 14);
+    addNativeImage(corpus, 128, 130, LCT_PALETTE, false, 15);
+    addNativeImage(corpus, 37, 21, LCT_PALETTE, false, 16);
+    addNativeImage(corpus, 37, 21, LCT_GREY_ALPHA, false, 17);
+    addNativeImage(corpus, 64, 64, LCT_PALETTE, true, 18);
+    addNativeImage(corpus, 64, 64, LCT_RGB, true, 19);
+}
+
+// Art beyond one texture: a 2x2 grid of tiles without alpha and a 3x1 strip with alpha
+static void buildLargeCorpus(BenchCorpus* corpus) {
+    corpus->name  = "large";
+    corpus->count = 0;
+
+    addSyntheticImage(corpus, 1500, 1100, false, 21);
+    addSyntheticImage(corpus, 2100, 700, true, 22);
+}
+
+static void freeCorpus(BenchCorpus* corpus) {
+    for (int i = 0; i < corpus->count; i++) free(corpus->images[i].png);
+    corpus->count = 0;
+}
+
+//---------------------------------------------------------------------------------
+// Benchmarks
+//---------------------------------------------------------------------------------
+typedef C2D_Image (*BenchConvert)(const BenchImage* image);
+
+static C2D_Image convertFromFile(const BenchImage* image) {
+    return convertPNGToC2DImage(image->path);
+}
+
+static C2D_Image convertFromMemory(const BenchImage* image) {
+    return convertPNGBufferToC2DImage(image->png, image->pngsize);
+}
+
+// Options used by the convertWithOptions case
+static TextureOptions benchOptions;
+
+static C2D_Image convertWithOptions(const BenchImage* image) {
+    return convertPNGBufferToC2DImageWithOptions(image->png, image->pngsize, &benchOptions);
+}
+
+static C2D_Image convertFromCache(const BenchImage* image) {
+    return convertPNGToC2DImageCached(image->path);
+}
+
+// Removes every entry from the benchmark's private cache directory
+static void clearCache(const BenchCorpus* corpus) {
+    char path[512];
+    for (int i = 0; i < corpus->count; i++) {
+        snprintf(path, sizeof(path), "%s/", textureCacheDirectory);
+        size_t length = strlen(path);
+        for (const char* c = corpus->images[i].path; *c && length + 5 < sizeof(path); c++) {
+            path[length++] = (*c == '/' || *c == ':') ? '_' : *c;
+        }
+        snprintf(path + length, sizeof(path) - length, ".tex");
+        remove(path);
+    }
+}
+
+static void runCase(const char* label, const BenchCorpus* corpus, BenchConvert convert, int iterations) {
+    double totalMs    = 0.0;
+    double totalBytes = 0.0;
+    size_t peak       = 0;
+    double texBytes   = 0.0;
+
+    for (int i = 0; i < corpus->count; i++) {
+        const BenchImage* image = &corpus->images[i];
+        if (convert == convertFromFile && !image->path[0]) continue;
+
+        for (int n = 0; n < iterations; n++) {
+            size_t baseline = heapCurrent;
+            heapPeak = heapCurrent;
+
+            double start = nowMs();
+            C2D_Image img = convert(image);
+            totalMs += nowMs() - start;
+
+            if (heapPeak - baseline > peak) peak = heapPeak - baseline;
+            if (!img.tex) {
+                fprintf(stderr, "%s: failed to convert %s\n", label, image->name);
+                exit(1);
+            }
+
+            texBytes += img.tex->size;
+            freeC2DImage(&img);
+            totalBytes += (double)image->width * image->height * 4;
+        }
+    }
+
+    int runs = corpus->count * iterations;
+    printf("%-28s %-10s %4d %10.3f %10.2f %10zu %10.0f\n",
+           label, corpus->name, corpus->count, totalMs / runs,
+           totalBytes / (1024.0 * 1024.0) / (totalMs / 1000.0), peak / 1024, texBytes / runs / 1024);
+}
+
+// Queues the whole set on the loader thread and drains it the way the main loop does,
+// reporting how long until the first cover can be drawn, until all are in, and how much
+// of that the main thread itself spends queuing and uploading
+static void runLoaderCase(const BenchCorpus* corpus, int iterations) {
+    double firstMs = 0.0, allMs = 0.0, mainMs = 0.0;
+    int    covers  = 0;
+
+    Loader* loader = loaderCreate();
+    if (!loader) {
+        fprintf(stderr, "loader: cannot start the loader thread\n");
+        exit(1);
+    }
+
+    for (int n = 0; n < iterations; n++) {
+        clearCache(corpus);
+
+        double start = nowMs();
+        for (int i = 0; i < corpus->count; i++) {
+            loaderRequest(loader, i, NULL, NULL, corpus->images[i].path, &defaultTextureOptions, IO_PRIORITY_VISIBLE);
+        }
+        mainMs += nowMs() - start;
+
+        int received = 0;
+        while (received < corpus->count) {
+            LoaderResult result;
+            if (!loaderPoll(loader, &result)) {
+                svcSleepThread(100000);
+                continue;
+            }
+
+            double uploadStart = nowMs();
+            C2D_Image img = uploadTextureData(&result.data);
+            freeTextureData(&result.data);
+            mainMs += nowMs() - uploadStart;
+
+            if (!result.loaded || !img.tex) {
+                fprintf(stderr, "loader: failed to load %s\n", corpus->images[result.id].name);
+                exit(1);
+            }
+            if (received++ == 0) firstMs += nowMs() - start;
+            freeC2DImage(&img);
+            covers++;
+        }
+        allMs += nowMs() - start;
+    }
+
+    loaderDestroy(loader);
+
+    printf("%-28s %-10s %4d %10.3f %10s %10s %10s  first cover %.3f ms, all %.3f ms, %u workers\n",
+           "loader (main thread)", corpus->name, corpus->count, mainMs / covers, "-", "-", "-",
+           firstMs / iterations, allMs / iterations, (unsigned)atomic_load(&loader->workers));
+}
+
+typedef struct {
+    const BenchImage* image;
+    TextureData       data;
+} BenchDecode;
+
+static void decodeJob(void* arg) {
+    BenchDecode* decode = (BenchDecode*)arg;
+    const TextureOptions options = { GPU_RGBA4, true };
+    decodePNGToTexture(decode->image->png, decode->image->pngsize, &options, &decode->data, allocateTextureData, NULL);
+}
+
+// Decodes a whole corpus as one job per image with 0, 1, 2, ... workers, for as many
+// workers as the machine has cores to pin them to
+static void runJobsCase(const BenchCorpus* corpus, int iterations) {
+    double baselineMs = 0.0;
+
+    for (u32 workers = 0; workers <= JOB_MAX_WORKERS; workers++) {
+        JobSystem* jobs = jobSystemCreate(workers);
+        if (!jobs || jobs->workerCount < workers) {
+            jobSystemDestroy(jobs);
+            break;
+        }
+
+        double totalMs = 0.0;
+        for (int n = 0; n < iterations; n++) {
+            BenchDecode decodes[MAX_CORPUS];
+            Job work[MAX_CORPUS];
+            JobGroup group;
+            atomic_init(&group.pending, 0);
+
+            const double start = nowMs();
+            for (int i = 0; i < corpus->count; i++) {
+                decodes[i] = (BenchDecode){ &corpus->images[i], {0} };
+                work[i]    = (Job){ decodeJob, &decodes[i], &group };
+                jobSubmit(jobs, &work[i]);
+            }
+            jobWait(jobs, &group);
+            totalMs += nowMs() - start;
+
+            for (int i = 0; i < corpus->count; i++) {
+                if (!decodes[i].data.data) {
+                    fprintf(stderr, "jobs: failed to decode %s\n", corpus->images[i].name);
+                    exit(1);
+                }
+                freeTextureData(&decodes[i].data);
+            }
+        }
+        jobSystemDestroy(jobs);
+
+        if (workers == 0) baselineMs = totalMs;
+        char label[32];
+        snprintf(label, sizeof(label), "jobs, %u workers", (unsigned)workers);
+        printf("%-28s %-10s %4d %10.3f %10s %10s %10s  %.2fx\n", label, corpus->name, corpus->count,
+               totalMs / (corpus->count * iterations), "-", "-", "-", baselineMs / totalMs);
+    }
+}
+
+#define LIBRARY_SIZE    1000
+#define LIBRARY_WINDOW  2
+
+static const BenchCorpus* libraryCorpus;
+
+// A large library made of the image set repeated, as the residency manager sees it
+static void libraryPaths(int id, char* t3xPath, char* etcPath, char* pngPath, size_t size) {
+    t3xPath[0] = '\0';
+    etcPath[0] = '\0';
+    snprintf(pngPath, size, "%s", libraryCorpus->images[id % libraryCorpus->count].path);
+}
+
+// Scrolls across a LIBRARY_SIZE title library with the residency manager and checks that
+// the covers around the selection become resident while the rest stays within the budget
+static void runResidencyCase(const BenchCorpus* corpus, size_t budget, bool sliced) {
+    libraryCorpus = corpus;
+
+    Atlas* atlas = atlasCreate(ATLAS_PAGE_SIZE, TEXTURE_FORMAT_AUTO);
+    Loader* loader = sliced ? NULL : loaderCreate();
+    Residency* covers = residencyCreate(budget, atlas, loader, NULL, libraryPaths, &defaultTextureOptions);
+
+    size_t windowPeak = 0;
+    u32 frames = 0, worstFrameUs = 0;
+    FrameBudget frameBudget;
+    frameBudgetInit(&frameBudget);
+    double start = nowMs();
+
+    for (int selected = 0; selected < LIBRARY_SIZE; selected++) {
+        int wanted[2 * LIBRARY_WINDOW + 1];
+        int count = 0;
+        for (int distance = 0; distance <= LIBRARY_WINDOW; distance++) {
+            wanted[count++] = (selected + distance) % LIBRARY_SIZE;
+            if (distance > 0) wanted[count++] = (selected - distance + LIBRARY_SIZE) % LIBRARY_SIZE;
+        }
+
+        // Keep updating like the frame loop does until the whole window is resident
+        bool resident = false;
+        for (int frame = 0; !resident; frame++) {
+            // Without a loader every frame gets the adaptive slice, like the frame loop on an Old 3DS
+            covers->timeSlice = loader ? 0 : frameBudget.budgetUs;
+            const u64 frameStart = svcGetSystemTick();
+            residencyUpdate(covers, wanted, count, 0);
+            const u32 frameUs = ticksToMicroseconds(svcGetSystemTick() - frameStart);
+            frameBudgetUpdate(&frameBudget, frameUs, frameUs);
+            if (frameUs > worstFrameUs) worstFrameUs = frameUs;
+            frames++;
+
+            resident = true;
+            size_t windowBytes = 0;
+            for (int i = 0; i < count; i++) {
+                C2D_Image image = residencyGet(covers, wanted[i]);
+                if (!image.tex) resident = false;
+                else windowBytes += (size_t)image.subtex->width * image.subtex->height * textureFormatBits(image.tex->fmt) / 8;
+            }
+            if (windowBytes > windowPeak) windowPeak = windowBytes;
+
+            if (frame > 10000) {
+                fprintf(stderr, "residency: window around %d never became resident\n", selected);
+                exit(1);
+            }
+            if (!resident && loader) svcSleepThread(100000);
+        }
+
+        if (covers->used > budget && covers->used > windowPeak) {
+            fprintf(stderr, "residency: %zu bytes resident over a %zu byte budget\n", covers->used, budget);
+            exit(1);
+        }
+    }
+
+    const double totalMs = nowMs() - start;
+    printf("%-28s %-10s %4d %10.3f %10s %10zu %10s  budget %zu KiB, %u loads (%u shared), %u evictions",
+           sliced ? "residency scroll, sliced" : "residency scroll", "library", LIBRARY_SIZE, totalMs / LIBRARY_SIZE,
+           "-", covers->peak / 1024, "-", budget / 1024, (unsigned)covers->loads, (unsigned)covers->shared,
+           (unsigned)covers->evictions);
+    if (sliced) printf(", %.2f frames/title, worst frame %u us", (double)frames / LIBRARY_SIZE, (unsigned)worstFrameUs);
+    printf("\n");
+
+    loaderDestroy(loader);
+    residencyDestroy(covers);
+    atlasDestroy(atlas);
+}
+
+// Fills the loader's queue with covers ahead of one that is resident and one still loading,
+// as a fast scroll does, and checks that neither is evicted or cancelled for coming after the
+// loader had no room left. The budget is 0, so any cover not marked as wanted is evicted.
+static void runSaturatedResidencyCase(const BenchCorpus* corpus) {
+    libraryCorpus = corpus;
+
+    Loader* loader = loaderCreate();
+    Residency* covers = residencyCreate(0, NULL, loader, NULL, libraryPaths, &defaultTextureOptions);
+    const int resident = 0, loading = 1;
+
+    for (int frame = 0; !residencyGet(covers, resident).tex; frame++) {
+        residencyUpdate(covers, &resident, 1, 0);
+        if (frame > 10000) {
+            fprintf(stderr, "residency saturated: cover %d never became resident\n", resident);
+            exit(1);
+        }
+        svcSleepThread(100000);
+    }
+
+    int wanted[LOADER_MAX_PENDING + 4];
+    int count = 0;
+    for (int i = 0; i < LOADER_MAX_PENDING + 2; i++) wanted[count++] = 2 + i;
+    wanted[count++] = resident;
+    wanted[count++] = loading;
+
+    residencyUpdate(covers, &wanted[count - 2], 2, 0);
+    const u32 cancelled = covers->cancelled;
+    for (int frame = 0; frame < 8; frame++) {
+        residencyUpdate(covers, wanted, count, 0);
+        residencyCancel(covers);
+        if (!residencyGet(covers, resident).tex || covers->cancelled != cancelled) {
+            fprintf(stderr, "residency saturated: a wanted cover behind a full loader was %s\n",
+                    covers->cancelled != cancelled ? "cancelled" : "evicted");
+            exit(1);
+        }
+    }
+
+    printf("%-28s %-10s %4d %10s %10s %10s %10s  %d wanted, loader full after %d\n", "residency saturated",
+           corpus->name, corpus->count, "-", "-", "-", "-", count, LOADER_MAX_PENDING);
+
+    loaderDestroy(loader);
+    residencyDestroy(covers);
+}
+
+// Writes the images of 'corpus' into 'dir' as loose cover files, so the residency manager
+// reads them from storage like the cover art on the SD card
+static bool writeCoverLibrary(BenchCorpus* library, const BenchCorpus* corpus, const char* dir) {
+    library->name  = corpus->name;
+    library->count = 0;
+
+    for (int i = 0; i < corpus->count; i++) {
+        BenchImage* image = &library->images[i];
+        *image = corpus->images[i];
+        snprintf(image->path, sizeof(image->path), "%s/cover%d.png", dir, i);
+        if (lodepng_save_file(image->png, image->pngsize, image->path)) return false;
+        library->count++;
+    }
+    return true;
+}
+
+// Loads every cover of the set through a residency manager set up as main.c sets it up,
+// with an AUTO atlas and defaultTextureOptions, and checks that each cover is packed in the
+// format its alpha channel calls for: RGB565 for opaque art, RGBA5551 or RGBA4 otherwise
+static void runCoverFormatCase(const BenchCorpus* corpus, bool sliced) {
+    libraryCorpus = corpus;
+
+    Atlas* atlas = atlasCreate(ATLAS_PAGE_SIZE, TEXTURE_FORMAT_AUTO);
+    Loader* loader = sliced ? NULL : loaderCreate();
+    Residency* covers = residencyCreate(1024 * 1024, atlas, loader, NULL, libraryPaths, &defaultTextureOptions);
+
+    int wanted[MAX_CORPUS];
+    for (int i = 0; i < corpus->count; i++) wanted[i] = i;
+
+    bool resident = false;
+    for (int frame = 0; !resident; frame++) {
+        residencyUpdate(covers, wanted, corpus->count, 0);
+        resident = true;
+        for (int i = 0; i < corpus->count; i++) {
+            if (!residencyGet(covers, i).tex) resident = false;
+        }
+        if (frame > 10000) {
+            fprintf(stderr, "cover formats: %s covers never became resident\n", corpus->name);
+            exit(1);
+        }
+        if (!resident && loader) svcSleepThread(100000);
+    }
+
+    u32 opaque = 0;
+    for (int i = 0; i < corpus->count; i++) {
+        const BenchImage* image = &corpus->images[i];
+
+        unsigned char* rgba;
+        unsigned width, height;
+        lodepng_decode32(&rgba, &width, &height, image->png, image->pngsize);
+        const ImageOpacity scanned = imageOpacity(rgba, width, height);
+        free(rgba);
+
+        // The header may err towards blending, and the cover is decoded by what it says
+        const ImageOpacity header = pngOpacity(image->png, image->pngsize);
+        const ImageOpacity expected = header != IMAGE_OPACITY_UNKNOWN ? header : scanned;
+        const GPU_TEXCOLOR format = residencyGet(covers, i).tex->fmt;
+        if (format != textureFormatFor(TEXTURE_FORMAT_AUTO, expected) ||
+            residencyOpaque(covers, i) != (expected == IMAGE_OPAQUE)) {
+            fprintf(stderr, "cover formats: %s was packed as format %d\n", image->name, (int)format);
+            exit(1);
+        }
+        if (format == GPU_RGB565) opaque++;
+    }
+
+    int pages[2] = { 0 };
+    for (int i = 0; i < atlas->pageCount; i++) pages[atlas->pages[i].tex.fmt == GPU_RGB565]++;
+    printf("%-28s %-10s %4d %10s %10s %10s %10s  %u RGB565 covers, %d RGB565 and %d alpha pages\n",
+           sliced ? "cover formats, sliced" : "cover formats", corpus->name, corpus->count, "-", "-", "-", "-",
+           (unsigned)opaque, pages[1], pages[0]);
+
+    loaderDestroy(loader);
+    residencyDestroy(covers);
+    atlasDestroy(atlas);
+}
+
+// Carousel geometry of main.c
+#define PREFETCH_TITLES 48
+#define PREFETCH_STRIDE 138.0f // BOX_WIDTH + BOX_SPACING
+#define PREFETCH_BOX    128.0f
+#define PREFETCH_VIEW   400.0f // TOP_SCREEN_WIDTH
+#define PREFETCH_SPEED  8.0f
+#define PREFETCH_SLICE_US 500 // per frame without a loader, like an Old 3DS
+#define PREFETCH_FRAME_US 200 // per frame with a loader, a fraction of one decode
+
+static BenchCorpus prefetchLibrary;
+
+static void prefetchPaths(int id, char* t3xPath, char* etcPath, char* pngPath, size_t size) {
+    t3xPath[0] = '\0';
+    etcPath[0] = '\0';
+    snprintf(pngPath, size, "%s", prefetchLibrary.images[id].path);
+}
+
+// Writes PREFETCH_TITLES copies of the image set into 'dir', each with a private chunk
+// holding its title number so no two titles share art (and a texture)
+static bool buildPrefetchLibrary(const BenchCorpus* corpus, const char* dir) {
+    prefetchLibrary.name  = "unique";
+    prefetchLibrary.count = 0;
+
+    for (int i = 0; i < PREFETCH_TITLES; i++) {
+        const BenchImage* source = &corpus->images[i % corpus->count];
+        BenchImage* image = &prefetchLibrary.images[i];
+
+        // Everything up to IEND, then the title chunk and a new IEND
+        size_t size = source->pngsize - 12;
+        unsigned char* png = malloc(size);
+        if (!png) return false;
+        memcpy(png, source->png, size);
+
+        const u32 title = (u32)i;
+        snprintf(image->path, sizeof(image->path), "%s/title%d.png", dir, i);
+        snprintf(image->name, sizeof(image->name), "title%d.png", i);
+        const bool written = !lodepng_chunk_create(&png, &size, sizeof(title), "sbTl", (const unsigned char*)&title) &&
+                             !lodepng_chunk_create(&png, &size, 0, "IEND", NULL) &&
+                             !lodepng_save_file(png, size, image->path);
+        free(png);
+        if (!written) return false;
+        prefetchLibrary.count++;
+    }
+    return true;
+}
+
+// Holds the D-pad across most of the library and then back, and counts the covers that were
+// resident when they came into view. Without a loader covers are decoded in slices of
+// PREFETCH_SLICE_US per frame like an Old 3DS; with one every frame is paced to
+// PREFETCH_FRAME_US so a cover takes several frames on the loader thread. Without 'prefetch'
+// only the covers on screen are asked for. Returns the misses.
+static u32 runPrefetchCase(bool prefetch, bool threaded) {
+    clearCache(&prefetchLibrary);
+
+    Atlas* atlas = atlasCreate(ATLAS_PAGE_SIZE, TEXTURE_FORMAT_AUTO);
+    Loader* loader = threaded ? loaderCreate() : NULL;
+    Residency* covers = residencyCreate(256 * 1024, atlas, loader, NULL, prefetchPaths, &defaultTextureOptions);
+    covers->timeSlice = threaded ? 0 : PREFETCH_SLICE_US;
+
+    Prefetcher prefetcher;
+    prefetchInit(&prefetcher);
+
+    bool onScreen[PREFETCH_TITLES];
+    for (int i = 0; i < PREFETCH_TITLES; i++) onScreen[i] = i * PREFETCH_STRIDE < PREFETCH_VIEW;
+
+    // Turn past the middle once a cover asked for ahead is still loading, or at the end
+    const int forward  = (int)(PREFETCH_TITLES / 2 * PREFETCH_STRIDE / PREFETCH_SPEED);
+    const int last     = (int)((PREFETCH_TITLES - 4) * PREFETCH_STRIDE / PREFETCH_SPEED);
+    const int backward = forward / 2;
+    int turn = -1;
+    float scroll = 0.0f;
+    u32 reversals = 0;
+
+    for (int frame = 0; turn < 0 || frame < turn + backward; frame++) {
+        const double frameStart = nowMs();
+        const float dx = turn < 0 ? -PREFETCH_SPEED : PREFETCH_SPEED;
+        scroll -= dx;
+        const bool reversed = prefetchObserve(&prefetcher, dx);
+
+        int wanted[PREFETCH_TITLES];
+        int count = 0;
+        for (int i = 0; i < PREFETCH_TITLES; i++) {
+            const float x = i * PREFETCH_STRIDE - scroll;
+            if (x < PREFETCH_VIEW && x + PREFETCH_BOX > 0.0f) wanted[count++] = i;
+        }
+
+        // Walk away from the screen in the scroll direction so the nearest come first
+        const int onScreenCount = count;
+        for (int n = 0; prefetch && n < PREFETCH_TITLES; n++) {
+            const int i = prefetcher.direction < 0 ? PREFETCH_TITLES - 1 - n : n;
+            const float x = i * PREFETCH_STRIDE - scroll;
+            const bool right = x >= PREFETCH_VIEW;
+            const float distance = right ? x - PREFETCH_VIEW : -(x + PREFETCH_BOX);
+            if (distance >= 0.0f && prefetchWanted(&prefetcher, distance, right ? 1 : -1)) wanted[count++] = i;
+        }
+
+        residencyUpdate(covers, wanted, count, count - onScreenCount);
+        if (reversed) {
+            residencyCancel(covers);
+            reversals++;
+        }
+
+        bool aheadLoading = false;
+        for (int n = onScreenCount; n < count; n++) aheadLoading |= residencyGet(covers, wanted[n]).tex == NULL;
+        if (turn < 0 && ((frame >= forward && (aheadLoading || !prefetch)) || frame >= last)) turn = frame + 1;
+
+        for (int i = 0; i < PREFETCH_TITLES; i++) {
+            const float x = i * PREFETCH_STRIDE - scroll;
+            const bool visible = x < PREFETCH_VIEW && x + PREFETCH_BOX > 0.0f;
+            if (visible && !onScreen[i]) prefetchRecord(&prefetcher, residencyGet(covers, i).tex != NULL);
+            onScreen[i] = visible;
+        }
+
+        const double spentUs = (nowMs() - frameStart) * 1000.0;
+        if (loader && spentUs < PREFETCH_FRAME_US) svcSleepThread((s64)((PREFETCH_FRAME_US - spentUs) * 1000.0));
+    }
+
+    char label[64];
+    snprintf(label, sizeof(label), "%s, %s", prefetch ? "prefetch" : "on-screen only",
+             threaded ? "loader" : "sliced");
+    printf("%-28s %-10s %4d %10s %10s %10s %10s  %u hits, %u misses, lead %u frames, %u cancelled\n",
+           label, prefetchLibrary.name, PREFETCH_TITLES, "-", "-", "-", "-", (unsigned)prefetcher.hits,
+           (unsigned)prefetcher.misses, (unsigned)prefetcher.leadFrames, (unsigned)covers->cancelled);
+
+    // Covers asked for ahead in the old direction are still queued when the D-pad turns
+    if (prefetch && threaded && reversals > 0 && covers->cancelled == 0) {
+        fprintf(stderr, "prefetch: %u reversals cancelled no queued loads\n", (unsigned)reversals);
+        exit(1);
+    }
+
+    loaderDestroy(loader);
+    residencyDestroy(covers);
+    atlasDestroy(atlas);
+    clearCache(&prefetchLibrary);
+    return prefetcher.misses;
+}
+
+// Runs the scroll without and with prefetching and checks that prefetching misses fewer covers
+static void runPrefetchCases(bool threaded) {
+    const u32 onScreenMisses = runPrefetchCase(false, threaded);
+    const u32 prefetchMisses = runPrefetchCase(true, threaded);
+    if (prefetchMisses >= onScreenMisses) {
+        fprintf(stderr, "prefetch: %u misses with prefetching, %u without\n", (unsigned)prefetchMisses,
+                (unsigned)onScreenMisses);
+        exit(1);
+    }
+}
+
+// Reads every cover of the set as loose files and out of a bundle of the same files, through
+// the unbuffered file backend, the mapping and the I/O queue, and checks the payloads match
+static void runBundleCase(const BenchCorpus* corpus, int iterations) {
+    char path[] = "/tmp/slipstream-bundle-XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        benchFailed("bundle: cannot create %s\n", path);
+        return;
+    }
+    close(fd);
+
+    BundleAsset assets[MAX_CORPUS];
+    for (int i = 0; i < corpus->count; i++) {
+        assets[i] = (BundleAsset){ (u32)i, BUNDLE_PNG, corpus->images[i].png, corpus->images[i].pngsize };
+    }
+    if (!bundleWrite(path, assets, (u32)corpus->count)) {
+        fprintf(stderr, "bundle: cannot write %s\n", path);
+        exit(1);
+    }
+
+    double looseMs = 0.0;
+    for (int n = 0; n < iterations; n++) {
+        for (int i = 0; i < corpus->count; i++) {
+            unsigned char* png = NULL;
+            size_t pngsize = 0;
+            double start = nowMs();
+            lodepng_load_file(&png, &pngsize, corpus->images[i].path);
+            looseMs += nowMs() - start;
+            free(png);
+        }
+    }
+
+    // 0: unbuffered file, 1: mapped, 2: I/O queue
+    IOQueue* io = ioQueueCreate();
+    double bundleMs[3] = { 0.0, 0.0, 0.0 };
+    for (int mode = 0; mode < 3; mode++) {
+        for (int n = 0; n < iterations; n++) {
+            double start = nowMs();
+            Bundle* bundle = bundleOpen(path, mode == 1, mode == 2 ? io : NULL);
+            if (!bundle || (mode == 1 && !bundle->mapped) || (mode == 2 && !bundle->queue)) {
+                fprintf(stderr, "bundle: cannot open %s\n", path);
+                exit(1);
+            }
+            for (int i = 0; i < corpus->count; i++) {
+                const BundleEntry* entry = bundleFind(bundle, (u32)i, BUNDLE_PNG);
+                const u8* png = entry ? bundleAcquire(bundle, entry, IO_PRIORITY_VISIBLE, NULL) : NULL;
+                // Touch the payload so the mapping is paged in like a decode would
+                volatile u8 sum = 0;
+                for (size_t b = 0; png && b < entry->size; b += 4096) sum += png[b];
+                bundleMs[mode] += nowMs() - start;
+
+                if (!png || entry->size != corpus->images[i].pngsize ||
+                    memcmp(png, corpus->images[i].png, entry->size)) {
+                    fprintf(stderr, "bundle: %s differs from the loose file\n", corpus->images[i].name);
+                    exit(1);
+                }
+                bundleRelease(bundle, png);
+                start = nowMs();
+            }
+            bundleClose(bundle);
+        }
+    }
+    ioQueueDestroy(io);
+
+    const int runs = corpus->count * iterations;
+    printf("%-28s %-10s %4d %10.3f %10s %10s %10s\n", "read loose files", corpus->name, corpus->count,
+           looseMs / runs, "-", "-", "-");
+    printf("%-28s %-10s %4d %10.3f %10s %10s %10s\n", "read bundle", corpus->name, corpus->count,
+           bundleMs[0] / runs, "-", "-", "-");
+    printf("%-28s %-10s %4d %10.3f %10s %10s %10s\n", "read bundle, mapped", corpus->name, corpus->count,
+           bundleMs[1] / runs, "-", "-", "-");
+    printf("%-28s %-10s %4d %10.3f %10s %10s %10s\n", "read bundle, I/O queue", corpus->name, corpus->count,
+           bundleMs[2] / runs, "-", "-", "-");
+    remove(path);
+}
+
+#define IO_BENCH_BLOCK      (64 * 1024)
+#define IO_BENCH_BLOCKS     64
+#define IO_BENCH_BACKGROUND 32
+#define IO_BENCH_ADJACENT   16
+#define IO_BENCH_SMALL      4096
+
+static u8 ioBenchByte(u64 position) {
+    return (u8)(position ^ (position >> 8) ^ (position >> 16));
+}
+
+// Fails the benchmark if a finished request did not receive the bytes at its offset
+static void checkIORequest(const IORequest* request) {
+    if (atomic_load(&request->state) != IO_DONE) return;
+    for (u32 i = 0; i < request->size; i++) {
+        if (request->read != request->size || ((const u8*)request->buffer)[i] != ioBenchByte(request->offset + i)) {
+            fprintf(stderr, "io: request at %llu read the wrong bytes\n", (unsigned long long)request->offset);
+            exit(1);
+        }
+    }
+}
+
+// Queues a cache rebuild's worth of background reads and then one visible read, and reports how
+// long the visible read took and how many background reads finished before it. Then queues
+// adjacent small reads to show them merged, and withdraws some queued reads.
+static void runIOCase(void) {
+    char path[] = "/tmp/slipstream-io-XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        benchFailed("io: cannot create %s\n", path);
+        return;
+    }
+
+    u8* block = malloc(IO_BENCH_BLOCK);
+    for (u64 b = 0; b < IO_BENCH_BLOCKS; b++) {
+        for (u32 i = 0; i < IO_BENCH_BLOCK; i++) block[i] = ioBenchByte(b * IO_BENCH_BLOCK + i);
+        if (write(fd, block, IO_BENCH_BLOCK) != IO_BENCH_BLOCK) {
+            fprintf(stderr, "io: cannot write %s\n", path);
+            exit(1);
+        }
+    }
+    close(fd);
+    free(block);
+
+    IOQueue* io = ioQueueCreate();
+    IOFile file;
+    if (!io || !ioOpen(&file, path)) {
+        fprintf(stderr, "io: cannot open %s\n", path);
+        exit(1);
+    }
+
+    static IORequest background[IO_BENCH_BACKGROUND], visible, adjacent[IO_BENCH_ADJACENT];
+    static u8 backgroundData[IO_BENCH_BACKGROUND][IO_BENCH_BLOCK], visibleData[IO_BENCH_BLOCK];
+    static u8 adjacentData[IO_BENCH_ADJACENT][IO_BENCH_SMALL];
+
+    const double start = nowMs();
+    for (int i = 0; i < IO_BENCH_BACKGROUND; i++) {
+        background[i] = (IORequest){ .file = &file, .offset = (u64)i * IO_BENCH_BLOCK, .size = IO_BENCH_BLOCK,
+                                     .buffer = backgroundData[i], .priority = IO_PRIORITY_BACKGROUND };
+        ioSubmit(io, &background[i]);
+    }
+    const double visibleStart = nowMs();
+    visible = (IORequest){ .file = &file, .offset = (u64)(IO_BENCH_BLOCKS - 1) * IO_BENCH_BLOCK,
+                           .size = IO_BENCH_BLOCK, .buffer = visibleData, .priority = IO_PRIORITY_VISIBLE };
+    ioSubmit(io, &visible);
+    ioWait(&visible);
+    const double visibleMs = nowMs() - visibleStart;
+
+    int before = 0;
+    for (int i = 0; i < IO_BENCH_BACKGROUND; i++) {
+        if (atomic_load(&background[i].state) == IO_DONE) before++;
+    }
+    for (int i = 0; i < IO_BENCH_BACKGROUND; i++) {
+        ioWait(&background[i]);
+        checkIORequest(&background[i]);
+    }
+    const double totalMs = nowMs() - start;
+    checkIORequest(&visible);
+
+    // Adjacent reads queued while a large visible read is in progress are served together
+    static u8 wholeData[IO_BENCH_BLOCKS * IO_BENCH_BLOCK];
+    IORequest whole = { .file = &file, .offset = 0, .size = sizeof(wholeData), .buffer = wholeData,
+                        .priority = IO_PRIORITY_VISIBLE };
+    const u32 reads = atomic_load(&io->reads);
+    ioSubmit(io, &whole);
+    for (int i = 0; i < IO_BENCH_ADJACENT; i++) {
+        adjacent[i] = (IORequest){ .file = &file, .offset = (u64)(IO_BENCH_BLOCKS / 2) * IO_BENCH_BLOCK +
+                                   (u64)((i * 7) % IO_BENCH_ADJACENT) * IO_BENCH_SMALL, .size = IO_BENCH_SMALL,
+                                   .buffer = adjacentData[i], .priority = IO_PRIORITY_PREFETCH };
+        ioSubmit(io, &adjacent[i]);
+    }
+    int withdrawn = 0;
+    for (int i = 0; i < IO_BENCH_ADJACENT; i += 4) {
+        if (ioCancel(io, &adjacent[i])) withdrawn++;
+    }
+    for (int i = 0; i < IO_BENCH_ADJACENT; i++) {
+        const IOState state = ioWait(&adjacent[i]);
+        if (state == IO_FAILED) {
+            fprintf(stderr, "io: read failed\n");
+            exit(1);
+        }
+        checkIORequest(&adjacent[i]);
+    }
+    ioWait(&whole);
+    checkIORequest(&whole);
+    const u32 adjacentReads = atomic_load(&io->reads) - reads;
+
+    printf("%-28s %-10s %4d %10.3f %10s %10s %10s\n", "io visible behind background", "-", IO_BENCH_BACKGROUND,
+           visibleMs, "-", "-", "-");
+    printf("  visible read %.3f ms, all reads %.3f ms, %d of %d background reads finished first\n", visibleMs,
+           totalMs, before, IO_BENCH_BACKGROUND);
+    printf("  %d adjacent reads (%d withdrawn) behind a large read, %u file reads in all\n", IO_BENCH_ADJACENT,
+           withdrawn, (unsigned)adjacentReads);
+
+    ioClose(&file);
+    ioQueueDestroy(io);
+    remove(path);
+}
+
+// The per-pixel loop convertPNGToC2DImage used before the tile walker, kept as the baseline
+static void swizzleRGBA8Reference(void* texture, u32 textureWidth, u32 textureHeight, const u8* rgba, u32 width, u32 height) {
+    (void)textureWidth;
+    (void)textureHeight;
+
+    for (u32 x = 0; x < width && x < 512; x++) {
+        for (u32 y = 0; y < height && y < 512; y++) {
+            const u32 dstPos = calculateTexturePosition(x, y);
+            const u32 srcPos = (y * width + x) * 4;
+
+            ((uint8_t *)texture)[dstPos + 0] = rgba[srcPos + 3];
+            ((uint8_t *)texture)[dstPos + 1] = rgba[srcPos + 2];
+            ((uint8_t *)texture)[dstPos + 2] = rgba[srcPos + 1];
+            ((uint8_t *)texture)[dstPos + 3] = rgba[srcPos + 0];
+        }
+    }
+}
+
+// Checks that decoding rows straight into the texture gives the same tiles as decoding
+// the whole image and swizzling it afterwards
+// Returns the first row of tiles covering a width x height image that differs between two
+// textures, or -1. Only those tiles are written by every decode path.
+static int differingTileRow(const void* a, const void* b, u32 textureWidth, u32 width, u32 height, GPU_TEXCOLOR format) {
+    const size_t tileBytes = textureFormatBits(format) * 8;
+    const size_t rowBytes  = (textureWidth >> 3) * tileBytes;
+    for (u32 tileY = 0; tileY < (height + 7) / 8; tileY++) {
+        if (memcmp((const u8*)a + tileY * rowBytes, (const u8*)b + tileY * rowBytes, ((width + 7) / 8) * tileBytes)) {
+            return (int)tileY;
+        }
+    }
+    return -1;
+}
+
+// Decodes every image a slice at a time like the frame loop does without a loader, checks the
+// texture against the one-shot decode and reports how many frames a cover takes to stream in
+// and by how much a slice overran its budget.
+// The whole image decoded with lodepng and swizzled in one go, in the format 'options' call for:
+// TEXTURE_FORMAT_AUTO follows the header's opacity when it has one, else that of the pixels
+static void* wholeImageTexture(const BenchImage* image, const TextureOptions* options, u32 textureWidth,
+                               u32 textureHeight, GPU_TEXCOLOR* format) {
+    unsigned char* rgba;
+    unsigned width, height;
+    lodepng_decode32(&rgba, &width, &height, image->png, image->pngsize);
+
+    const ImageOpacity header = pngOpacity(image->png, image->pngsize);
+    *format = textureFormatFor(options->format, header != IMAGE_OPACITY_UNKNOWN ? header : imageOpacity(rgba, width, height));
+
+    void* texture = calloc(1, (size_t)textureWidth * textureHeight * textureFormatBits(*format) / 8);
+    swizzleToFormat(*format, texture, textureWidth, textureHeight, rgba, width, height, options->dither);
+    free(rgba);
+    return texture;
+}
+
+static void runSlicedDecodeCase(const BenchCorpus* corpus, u32 budgetUs) {
+    const TextureOptions* options = &defaultTextureOptions;
+    u32 frames = 0, decoded = 0, worstSliceUs = 0, worstBandUs = 0;
+    u64 totalUs = 0;
+
+    for (int i = 0; i < corpus->count; i++) {
+        const BenchImage* image = &corpus->images[i];
+        if (image->width > MAX_TEXTURE_SIZE || image->height > MAX_TEXTURE_SIZE) continue;
+
+        // What one band of 8 rows costs, from the fastest of a few one-shot decodes
+        u32 decodeUs = UINT32_MAX;
+        for (int n = 0; n < 3; n++) {
+            TextureData whole;
+            const u64 start = svcGetSystemTick();
+            decodePNGToTexture(image->png, image->pngsize, options, &whole, allocateTextureData, NULL);
+            const u32 us = ticksToMicroseconds(svcGetSystemTick() - start);
+            if (us < decodeUs) decodeUs = us;
+            freeTextureData(&whole);
+        }
+        const u32 bandUs = decodeUs / ((image->height + 7) / 8) + 1;
+        if (bandUs > worstBandUs) worstBandUs = bandUs;
+
+        TextureData data;
+        PNGDecode* decode = beginPNGDecode(image->png, image->pngsize, options, &data, allocateTextureData, NULL);
+        PNGDecodeStatus status = PNG_DECODE_PENDING;
+
+        while (decode && status == PNG_DECODE_PENDING) {
+            const u64 sliceStart = svcGetSystemTick();
+            const double cpuStart = threadMs();
+            status = advancePNGDecode(decode, budgetUs);
+            const u32 sliceUs = ticksToMicroseconds(svcGetSystemTick() - sliceStart);
+            const u32 cpuUs = (u32)((threadMs() - cpuStart) * 1000.0);
+            if (sliceUs > worstSliceUs) worstSliceUs = sliceUs;
+            totalUs += sliceUs;
+            frames++;
+
+            // The slice may overrun by the step that crosses the deadline, which is at most a band.
+            // CPU time is checked so the host preempting the bench does not count as an overrun.
+            if (cpuUs > budgetUs + bandUs) {
+                fprintf(stderr, "sliced decode: a %u us slice of %s took %u us, a band takes %u us\n",
+                        (unsigned)budgetUs, image->name, (unsigned)cpuUs, (unsigned)bandUs);
+                exit(1);
+            }
+        }
+        endPNGDecode(decode);
+
+        GPU_TEXCOLOR format;
+        void* expected = wholeImageTexture(image, options, data.textureWidth, data.textureHeight, &format);
+        if (status != PNG_DECODE_DONE || data.format != format ||
+            differingTileRow(data.data, expected, data.textureWidth, data.width, data.height, data.format) >= 0) {
+            fprintf(stderr, "sliced decode: %s differs from the whole-image decode\n", image->name);
+            exit(1);
+        }
+        free(expected);
+        freeTextureData(&data);
+        decoded++;
+    }
+
+    char label[40];
+    snprintf(label, sizeof(label), "sliced decode, %u us", (unsigned)budgetUs);
+    printf("%-28s %-10s %4u %10.3f %10s %10s %10s  %.1f frames/image, worst slice %u us, band %u us\n", label,
+           corpus->name, (unsigned)decoded, totalUs / 1000.0 / decoded, "-", "-", "-", (double)frames / decoded,
+           (unsigned)worstSliceUs, (unsigned)worstBandUs);
+}
+
+// Straightforward per-byte conversion the kernels are checked against
+static void convertPixelsReference(PixelLayout layout, PixelOrder order, u8* out, const u8* in, u32 count,
+                                   const LodePNGColorMode* mode) {
+    for (u32 i = 0; i < count; i++) {
+        u8 rgba[4];
+        switch (layout) {
+            case PIXELS_RGB8:
+                rgba[0] = in[i * 3]; rgba[1] = in[i * 3 + 1]; rgba[2] = in[i * 3 + 2]; rgba[3] = 255;
+                break;
+            case PIXELS_RGBA8:
+                memcpy(rgba, &in[i * 4], 4);
+                break;
+            case PIXELS_GRAY8:
+                rgba[0] = rgba[1] = rgba[2] = in[i]; rgba[3] = 255;
+                break;
+            case PIXELS_GRAY_ALPHA8:
+                rgba[0] = rgba[1] = rgba[2] = in[i * 2]; rgba[3] = in[i * 2 + 1];
+                break;
+            default:
+                memcpy(rgba, &mode->palette[in[i] * 4], 4);
+                break;
+        }
+        for (int c = 0; c < 4; c++) out[i * 4 + c] = rgba[order == PIXELS_ABGR ? 3 - c : c];
+    }
+}
+
+// Checks every conversion kernel against the per-byte reference at widths that exercise the
+// vector bulk and the scalar tail, then times converting rows to GPU texels both ways: the
+// old path (lodepng_convert to RGBA, then reversing each pixel) and convertPixels.
+static void runPixelKernelCase(int iterations) {
+    static const struct { PixelLayout layout; LodePNGColorType colortype; u32 bytes; const char* name; } kernels[] = {
+        { PIXELS_RGB8,        LCT_RGB,        3, "rgb" },
+        { PIXELS_RGBA8,       LCT_RGBA,       4, "rgba" },
+        { PIXELS_GRAY8,       LCT_GREY,       1, "gray" },
+        { PIXELS_GRAY_ALPHA8, LCT_GREY_ALPHA, 2, "gray+alpha" },
+        { PIXELS_PALETTE8,    LCT_PALETTE,    1, "palette" },
+    };
+    enum { PIXELS = 256 * 1024 };
+    u8* in        = malloc(PIXELS * 4);
+    u8* out       = malloc(PIXELS * 4 + 4);
+    u8* reference = malloc(PIXELS * 4 + 4);
+    u32 seed = 99;
+    for (u32 i = 0; i < PIXELS * 4; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        in[i] = (u8)(seed >> 24);
+    }
+
+    for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++) {
+        LodePNGColorMode mode, rgba;
+        lodepng_color_mode_init(&mode);
+        lodepng_color_mode_init(&rgba);
+        mode.colortype = kernels[k].colortype;
+        if (kernels[k].layout == PIXELS_PALETTE8) {
+            // A short palette, so indices past it are covered too
+            for (u32 i = 0; i < 200; i++) lodepng_palette_add(&mode, (u8)i, (u8)(i * 7), (u8)(i * 13), (u8)(255 - i));
+        }
+        if (pixelLayoutFor(&mode) != kernels[k].layout) {
+            fprintf(stderr, "pixels: %s is not converted by its kernel\n", kernels[k].name);
+            exit(1);
+        }
+
+        for (int order = PIXELS_ABGR; order <= PIXELS_RGBA; order++) {
+            u32 palette[256];
+            buildPixelPalette(palette, &mode, (PixelOrder)order);
+            for (u32 width = 1; width <= 67; width++) {
+                for (u32 offset = 0; offset < 3; offset++) {
+                    // A guard word past the row catches stores beyond it
+                    memset(out, 0xA5, width * 4 + 4);
+                    convertPixels(kernels[k].layout, (PixelOrder)order, out, in + offset, width, palette);
+                    convertPixelsReference(kernels[k].layout, (PixelOrder)order, reference, in + offset, width, &mode);
+                    for (u32 i = 0; i < width * 4; i++) {
+                        if (out[i] != reference[i] && !(kernels[k].layout == PIXELS_PALETTE8 &&
+                                                         in[offset + i / 4] >= 200)) {
+                            fprintf(stderr, "pixels: %s kernel differs at width %u, byte %u\n", kernels[k].name,
+                                    (unsigned)width, (unsigned)i);
+                            exit(1);
+                        }
+                    }
+                    if (out[width * 4] != 0xA5) {
+                        fprintf(stderr, "pixels: %s kernel writes past width %u\n", kernels[k].name, (unsigned)width);
+                        exit(1);
+                    }
+                }
+            }
+        }
+
+        // Indices past the palette decode to opaque black, like lodepng
+        const u8 index = 250;
+        u32 palette[256], texel;
+        buildPixelPalette(palette, &mode, PIXELS_RGBA);
+        convertPixels(PIXELS_PALETTE8, PIXELS_RGBA, &texel, &index, 1, palette);
+        if (kernels[k].layout == PIXELS_PALETTE8 && texel != 0xFF000000) {
+            fprintf(stderr, "pixels: index past the palette is %08x\n", (unsigned)texel);
+            exit(1);
+        }
+
+        double genericMs = 0.0, kernelMs = 0.0;
+        for (int n = 0; n < iterations; n++) {
+            double start = nowMs();
+            lodepng_convert(reference, in, &rgba, &mode, PIXELS, 1);
+            for (u32 i = 0; i < PIXELS; i++) {
+                u32 pixel;
+                memcpy(&pixel, reference + i * 4, 4);
+                pixel = __builtin_bswap32(pixel);
+                memcpy(reference + i * 4, &pixel, 4);
+            }
+            genericMs += nowMs() - start;
+
+            start = nowMs();
+            convertPixels(kernels[k].layout, PIXELS_ABGR, out, in, PIXELS, palette);
+            kernelMs += nowMs() - start;
+        }
+        buildPixelPalette(palette, &mode, PIXELS_ABGR);
+        convertPixels(kernels[k].layout, PIXELS_ABGR, out, in, PIXELS, palette);
+        if (memcmp(out, reference, PIXELS * 4)) {
+            fprintf(stderr, "pixels: %s kernel differs from lodepng_convert\n", kernels[k].name);
+            exit(1);
+        }
+
+        const double mb = (double)PIXELS * 4 * iterations / (1024.0 * 1024.0);
+        char label[40];
+        snprintf(label, sizeof(label), "convert %s generic", kernels[k].name);
+        printf("%-28s %-10s %4d %10.3f %10.2f %10s %10s\n", label, "random", 1, genericMs / iterations,
+               mb / (genericMs / 1000.0), "-", "-");
+        snprintf(label, sizeof(label), "convert %s kernel", kernels[k].name);
+        printf("%-28s %-10s %4d %10.3f %10.2f %10s %10s  %.2fx\n", label, "random", 1, kernelMs / iterations,
+               mb / (kernelMs / 1000.0), "-", "-", genericMs / kernelMs);
+
+        lodepng_color_mode_cleanup(&mode);
+        lodepng_color_mode_cleanup(&rgba);
+    }
+
+    free(in);
+    free(out);
+    free(reference);
+}
+
+// Decodes every image of the set with convertPNGBufferToC2DImageWithOptions and checks it against the whole
+// image swizzled in one go. TEXTURE_FORMAT_AUTO has to settle on the same format, and without building the
+// RGBA image: its decode may take no more heap than one in the format it settles on, give or take a band
+// of RGBA rows.
+static void checkBandDecode(const char* label, const BenchCorpus* corpus, GPU_TEXCOLOR format, bool dither) {
+    const TextureOptions options = { format, dither };
+
+    for (int i = 0; i < corpus->count; i++) {
+        const BenchImage* image = &corpus->images[i];
+        if (image->width > MAX_TEXTURE_SIZE || image->height > MAX_TEXTURE_SIZE) continue;
+
+        size_t baseline = heapCurrent;
+        heapPeak = heapCurrent;
+        C2D_Image img = convertPNGBufferToC2DImageWithOptions(image->png, image->pngsize, &options);
+        const size_t peak = heapPeak - baseline;
+
+        GPU_TEXCOLOR expectedFormat;
+        void* expected = wholeImageTexture(image, &options, img.tex->width, img.tex->height, &expectedFormat);
+        const int tileY = differingTileRow(img.tex->data, expected, img.tex->width, image->width, image->height,
+                                           expectedFormat);
+        if (img.tex->fmt != expectedFormat || tileY >= 0) {
+            fprintf(stderr, "%s: %s differs from the whole-image decode (format %d, tile row %d)\n", label, image->name,
+                    (int)img.tex->fmt, tileY);
+            exit(1);
+        }
+        free(expected);
+        freeC2DImage(&img);
+
+        if (format == TEXTURE_FORMAT_AUTO) {
+            const TextureOptions settled = { expectedFormat, dither };
+            baseline = heapCurrent;
+            heapPeak = heapCurrent;
+            img = convertPNGBufferToC2DImageWithOptions(image->png, image->pngsize, &settled);
+            freeC2DImage(&img);
+            if (peak > heapPeak - baseline + (size_t)image->width * 8 * 4) {
+                fprintf(stderr, "%s: %s took %zu bytes of heap, %zu in its own format\n", label, image->name, peak,
+                        heapPeak - baseline);
+                exit(1);
+            }
+        }
+    }
+}
+
+// Decodes a PNG to the end, sliced or in one go, and returns how the result was classified
+static ImageOpacity decodedOpacity(const BenchImage* image, const TextureOptions* options, bool sliced,
+                                   GPU_TEXCOLOR* format) {
+    TextureData data;
+    bool decoded;
+
+    if (sliced) {
+        PNGDecode* decode = beginPNGDecode(image->png, image->pngsize, options, &data, allocateTextureData, NULL);
+        PNGDecodeStatus status = decode ? PNG_DECODE_PENDING : PNG_DECODE_FAILED;
+        while (status == PNG_DECODE_PENDING) status = advancePNGDecode(decode, 1000);
+        endPNGDecode(decode);
+        decoded = status == PNG_DECODE_DONE;
+    } else {
+        decoded = decodePNGToTexture(image->png, image->pngsize, options, &data, allocateTextureData, NULL);
+    }
+
+    if (!decoded) {
+        fprintf(stderr, "opacity: cannot decode %s\n", image->name);
+        exit(1);
+    }
+    *format = data.format;
+    freeTextureData(&data);
+    return data.opacity;
+}
+
+static void runOpacityCase(const BenchCorpus* corpus) {
+    static const char* names[] = { "unknown", "opaque", "binary alpha", "translucent" };
+    static const TextureOptions auto_ = { TEXTURE_FORMAT_AUTO, true };
+    static const TextureOptions rgba8 = { GPU_RGBA8, false };
+    u32 fromHeader = 0, counts[4] = { 0 };
+    double headerMs = 0;
+
+    for (int i = 0; i < corpus->count; i++) {
+        const BenchImage* image = &corpus->images[i];
+
+        const double start = nowMs();
+        const ImageOpacity header = pngOpacity(image->png, image->pngsize);
+        headerMs += nowMs() - start;
+
+        unsigned char* rgba;
+        unsigned width, height;
+        lodepng_decode32(&rgba, &width, &height, image->png, image->pngsize);
+        const ImageOpacity scanned = imageOpacity(rgba, width, height);
+        free(rgba);
+
+        // The header may only err towards blending, e.g. for palette entries no pixel uses
+        if (header != IMAGE_OPACITY_UNKNOWN && header < scanned) {
+            fprintf(stderr, "opacity: %s is %s but its header says %s\n", image->name, names[scanned], names[header]);
+            exit(1);
+        }
+
+        const ImageOpacity expected = header != IMAGE_OPACITY_UNKNOWN ? header : scanned;
+        const bool oversized = width > MAX_TEXTURE_SIZE || height > MAX_TEXTURE_SIZE;
+        for (int pass = 0; pass < 4; pass++) {
+            const TextureOptions* options = pass & 1 ? &rgba8 : &auto_;
+            GPU_TEXCOLOR format;
+            const ImageOpacity opacity = decodedOpacity(image, options, pass >= 2, &format);
+
+            // Downscaling may soften binary alpha, the rest has to match exactly
+            const bool matches = oversized && expected == IMAGE_BINARY_ALPHA ? opacity >= expected : opacity == expected;
+            if (!matches || format != textureFormatFor(options->format, opacity)) {
+                fprintf(stderr, "opacity: %s decoded as %s (format %d), expected %s\n", image->name, names[opacity],
+                        (int)format, names[expected]);
+                exit(1);
+            }
+            if (pass == 0) counts[opacity]++;
+        }
+        if (header != IMAGE_OPACITY_UNKNOWN) fromHeader++;
+    }
+
+    printf("%-28s %-10s %4d %10.4f %10s %10s %10s  %u of %d from the header; %u opaque, %u binary, %u translucent\n",
+           "opacity (header)", corpus->name, corpus->count, headerMs / corpus->count, "-", "-", "-",
+           (unsigned)fromHeader, corpus->count, (unsigned)counts[IMAGE_OPAQUE], (unsigned)counts[IMAGE_BINARY_ALPHA],
+           (unsigned)counts[IMAGE_TRANSLUCENT]);
+}
+
+// Fails the allocation of the scaled-down copy of each oversized image and checks that the
+// decode reports the failure instead of writing through a NULL pointer
+static void checkDownscaleFailure(const BenchCorpus* corpus) {
+    static const TextureOptions options = { GPU_RGBA8, false };
+
+    for (int i = 0; i < corpus->count; i++) {
+        const BenchImage* image = &corpus->images[i];
+        const u32 largest = image->width > image->height ? image->width : image->height;
+        const u32 factor  = (largest + MAX_TEXTURE_SIZE - 1) / MAX_TEXTURE_SIZE;
+        if (factor < 2) continue;
+
+        TextureData data;
+        heapFailSize = (size_t)(image->width / factor) * (image->height / factor) * 4;
+        const bool decoded = decodePNGToTexture(image->png, image->pngsize, &options, &data, allocateTextureData, NULL);
+        heapFailSize = 0;
+        if (decoded) {
+            fprintf(stderr, "downscale: %s decoded without memory for the scaled image\n", image->name);
+            exit(1);
+        }
+    }
+    printf("%-28s %-10s %4d %10s %10s %10s %10s  out of memory reported\n", "downscale, no memory", corpus->name,
+           corpus->count, "-", "-", "-", "-");
+}
+
+static void runTiledImageCase(const char* label, const BenchCorpus* corpus, const TextureOptions* options,
+                              int iterations) {
+    double totalMs = 0.0, totalBytes = 0.0, texBytes = 0.0;
+    size_t peak = 0;
+    u32 tiles = 0;
+
+    for (int i = 0; i < corpus->count; i++) {
+        const BenchImage* image = &corpus->images[i];
+
+        for (int n = 0; n < iterations; n++) {
+            TiledImage tiled;
+            const size_t baseline = heapCurrent;
+            heapPeak = heapCurrent;
+
+            const double start = nowMs();
+            const bool loaded = loadTiledImage(&tiled, image->png, image->pngsize, options);
+            totalMs += nowMs() - start;
+
+            if (heapPeak - baseline > peak) peak = heapPeak - baseline;
+            if (!loaded || tiled.width != image->width || tiled.height != image->height) {
+                fprintf(stderr, "%s: failed to load %s\n", label, image->name);
+                exit(1);
+            }
+
+            const u32 draws = hostImageDraws;
+            drawTiledImage(&tiled, 0.0f, 0.0f, 0.5f, 1.0f, 1.0f);
+            if (hostImageDraws - draws != (u32)tiled.columns * tiled.rows) {
+                fprintf(stderr, "%s: %s drew %u of %u tiles\n", label, image->name, (unsigned)(hostImageDraws - draws),
+                        (unsigned)tiled.columns * tiled.rows);
+                exit(1);
+            }
+
+            // Every tile has to match its part of the whole image swizzled on its own
+            if (n == 0) {
+                unsigned char* rgba;
+                unsigned width, height;
+                lodepng_decode32(&rgba, &width, &height, image->png, image->pngsize);
+                u8* part = malloc((size_t)TILED_IMAGE_TILE_SIZE * TILED_IMAGE_TILE_SIZE * 4);
+
+                for (u32 t = 0; t < (u32)tiled.columns * tiled.rows; t++) {
+                    const C2D_Image* tile = &tiled.tiles[t];
+                    const u32 x0 = t % tiled.columns * TILED_IMAGE_TILE_SIZE;
+                    const u32 y0 = t / tiled.columns * TILED_IMAGE_TILE_SIZE;
+                    const u32 w = tile->subtex->width, h = tile->subtex->height;
+
+                    for (u32 y = 0; y < h; y++) {
+                        memcpy(part + (size_t)y * w * 4, rgba + ((size_t)(y0 + y) * width + x0) * 4, (size_t)w * 4);
+                    }
+                    void* expected = calloc(1, tile->tex->size);
+                    swizzleToFormat(tiled.format, expected, tile->tex->width, tile->tex->height, part, w, h,
+                                    options->dither);
+
+                    const int tileY = differingTileRow(tile->tex->data, expected, tile->tex->width, w, h, tiled.format);
+                    if (tileY >= 0) {
+                        fprintf(stderr, "%s: %s tile %u differs in tile row %d\n", label, image->name, (unsigned)t, tileY);
+                        exit(1);
+                    }
+                    free(expected);
+                }
+                free(part);
+                free(rgba);
+                tiles += (u32)tiled.columns * tiled.rows;
+            }
+
+            for (u32 t = 0; t < (u32)tiled.columns * tiled.rows; t++) texBytes += tiled.tiles[t].tex->size;
+            totalBytes += (double)image->width * image->height * 4;
+            freeTiledImage(&tiled);
+        }
+    }
+
+    const int runs = corpus->count * iterations;
+    printf("%-28s %-10s %4d %10.3f %10.2f %10zu %10.0f  %u tiles\n", label, corpus->name, corpus->count,
+           totalMs / runs, totalBytes / (1024.0 * 1024.0) / (totalMs / 1000.0), peak / 1024, texBytes / runs / 1024,
+           (unsigned)tiles);
+}
+
+#define CAROUSEL_BOX       128
+#define CAROUSEL_HEIGHT    130
+#define CAROUSEL_SPACING   10
+#define CAROUSEL_TOP       20
+#define CAROUSEL_VIEW      400
+#define CAROUSEL_THRESHOLD 30.0f
+#define CAROUSEL_STEPS     200
+
+#define CAROUSEL_MARGIN    24
+
+// Left edge of an item in the reference model, where every item has a position of its own and
+// 'scroll' px of the ring have moved past the left edge of the view. The occurrence reaching
+// into the left margin is returned in preference to the one past the right edge.
+static long long carouselReferenceX(int index, int count, long long scroll, int margin) {
+    const long long pitch = CAROUSEL_BOX + CAROUSEL_SPACING;
+    const long long ring  = (long long)count * pitch;
+    long long x = ((index * pitch - scroll) % ring + ring) % ring;
+    if (x + CAROUSEL_BOX + margin > ring) x -= ring;
+    return x;
+}
+
+// Scrolls carousels of a few and of a million titles by random steps and checks the culled
+// layout, with and without a margin, the selection and hit tests against a per-item model. Then times a frame of scrolling and
+// laying out, which should not depend on the size of the library, next to moving every box.
+static void runCarouselCase(void) {
+    const int counts[] = { 5, 1000000 };
+    double frameMs[2], perBoxMs[2];
+    int mostDrawn[2] = { 0, 0 };
+    int selectionChanges = 0;
+
+    for (int c = 0; c < 4; c++) {
+        const int count  = counts[c / 2];
+        const int margin = c % 2 ? CAROUSEL_MARGIN : 0;
+        Carousel carousel;
+        carouselInit(&carousel, count, CAROUSEL_BOX, CAROUSEL_HEIGHT, CAROUSEL_SPACING, CAROUSEL_TOP, CAROUSEL_VIEW);
+        carousel.margin = margin;
+
+        CarouselSelection selection;
+        carouselSelectionInit(&selection);
+        int lastSelected = -1;
+
+        long long scroll = 0;
+        u32 seed = 777;
+        for (int step = 0; step < CAROUSEL_STEPS; step++) {
+            seed = seed * 1664525u + 1013904223u;
+            // Mostly D-pad steps, now and then a jump across many titles
+            const int dx = (seed >> 28) ? (int)((seed >> 8) % 9) * 4 - 16 : (int)((seed >> 8) % 200001) - 100000;
+            carouselScroll(&carousel, (float)dx);
+            scroll -= dx;
+
+            CarouselSlot slots[8];
+            const int visible = carouselVisible(&carousel, slots, 8);
+            if (visible > mostDrawn[c / 2]) mostDrawn[c / 2] = visible;
+            int expected = 0, selected = -1;
+            for (int i = 0; i < count; i++) {
+                const long long x = carouselReferenceX(i, count, scroll, margin);
+                if (x >= CAROUSEL_VIEW + margin || x + CAROUSEL_BOX <= -margin) continue;
+                expected++;
+                if (fabsf((float)x + CAROUSEL_BOX / 2 - CAROUSEL_VIEW / 2) < CAROUSEL_THRESHOLD) selected = i;
+
+                int found = -1;
+                for (int k = 0; k < visible; k++) {
+                    if (slots[k].index == i) found = k;
+                }
+                if (found < 0 || slots[found].x != (float)x || slots[found].y != CAROUSEL_TOP) {
+                    fprintf(stderr, "carousel: %d titles, margin %d, step %d lays out title %d wrongly\n", count,
+                            margin, step, i);
+                    exit(1);
+                }
+            }
+            if (visible != expected) {
+                fprintf(stderr, "carousel: %d titles, margin %d, step %d lays out %d titles, expected %d\n", count,
+                        margin, step, visible, expected);
+                exit(1);
+            }
+
+            if (carouselSelected(&carousel, CAROUSEL_THRESHOLD) != selected ||
+                (selected >= 0 &&
+                 carouselItemX(&carousel, selected) != (float)carouselReferenceX(selected, count, scroll, 0))) {
+                fprintf(stderr, "carousel: %d titles, step %d selects the wrong title\n", count, step);
+                exit(1);
+            }
+
+            // The per-frame selection has to agree, and report a change exactly when there is one
+            const bool changed = carouselUpdateSelection(&selection, &carousel, CAROUSEL_THRESHOLD);
+            if (selection.index != selected || changed != (selected != lastSelected) ||
+                selection.previous != lastSelected || selection.nearest != carouselNearest(&carousel)) {
+                fprintf(stderr, "carousel: %d titles, step %d updates the selection wrongly\n", count, step);
+                exit(1);
+            }
+            if (changed) selectionChanges++;
+            lastSelected = selected;
+
+            for (int probe = 0; probe < 16; probe++) {
+                seed = seed * 1664525u + 1013904223u;
+                const float px = (float)((seed >> 8) % CAROUSEL_VIEW) + 0.5f;
+                const float py = (float)((seed >> 20) % 240);
+                int hit = -1;
+                for (int k = 0; k < visible; k++) {
+                    if (px >= slots[k].x && px < slots[k].x + CAROUSEL_BOX && py >= CAROUSEL_TOP &&
+                        py < CAROUSEL_TOP + CAROUSEL_HEIGHT) {
+                        hit = slots[k].index;
+                    }
+                }
+                if (carouselItemAt(&carousel, px, py) != hit) {
+                    fprintf(stderr, "carousel: %d titles, step %d hits the wrong title at %.1f,%.1f\n", count, step,
+                            px, py);
+                    exit(1);
+                }
+            }
+        }
+    }
+
+    for (int c = 0; c < 2; c++) {
+        const int count = counts[c];
+        Carousel carousel;
+        carouselInit(&carousel, count, CAROUSEL_BOX, CAROUSEL_HEIGHT, CAROUSEL_SPACING, CAROUSEL_TOP, CAROUSEL_VIEW);
+
+        // One frame: a D-pad step and the layout the draw and residency code ask for
+        const int frames = 1000000;
+        volatile float sink = 0.0f;
+        double start = nowMs();
+        for (int frame = 0; frame < frames; frame++) {
+            CarouselSlot slots[8];
+            carouselScroll(&carousel, frame & 256 ? 4.0f : -4.0f);
+            const int visible = carouselVisible(&carousel, slots, 8);
+            sink += slots[visible - 1].x + (float)carouselNearest(&carousel);
+        }
+        frameMs[c] = (nowMs() - start) / frames;
+
+        // The per-box model moves and wraps every box each frame
+        float* boxes = malloc((size_t)count * sizeof(float));
+        for (int i = 0; i < count; i++) boxes[i] = (float)i * (CAROUSEL_BOX + CAROUSEL_SPACING);
+        const float ring = (float)count * (CAROUSEL_BOX + CAROUSEL_SPACING);
+        const int boxFrames = count > 1000 ? 20 : frames;
+        start = nowMs();
+        for (int frame = 0; frame < boxFrames; frame++) {
+            for (int i = 0; i < count; i++) {
+                boxes[i] -= 4.0f;
+                if (boxes[i] + CAROUSEL_BOX < 0.0f) boxes[i] += ring;
+            }
+            sink += boxes[frame % count];
+        }
+        perBoxMs[c] = (nowMs() - start) / boxFrames;
+        free(boxes);
+    }
+
+    for (int c = 0; c < 2; c++) {
+        printf("%-28s %-10s %4d %10.6f %10s %10s %10s  per-box model %.6f ms/frame, drew %d at most\n",
+               "carousel scroll+layout", "titles", counts[c], frameMs[c], "-", "-", "-", perBoxMs[c], mostDrawn[c]);
+    }
+    printf("%-28s %-10s %4s %10s %10s %10s %10s  %d selection changes in %d steps\n", "carousel selection", "titles",
+           "-", "-", "-", "-", "-", selectionChanges, 4 * CAROUSEL_STEPS);
+}
+
+// Records screens of covers, placeholders and text in random order and checks that submitting
+// draws every command once, the opaque ones with blending off, and leaves blending on. Then
+// times recording a screen against replaying it.
+static void runDisplayListCase(int iterations) {
+    static C3D_Tex texture;
+    const C2D_Image cover = { &texture, NULL };
+    const C2D_Text text = { 100.0f, 1 };
+    DisplayList list;
+    u32 seed = 4242;
+
+    for (int n = 0; n < 64; n++) {
+        int images = 0, rects = 0, texts = 0, blended = 0;
+        displayListClear(&list);
+
+        const int count = 1 + n % DISPLAY_LIST_MAX_COMMANDS;
+        for (int i = 0; i < count; i++) {
+            seed = seed * 1664525u + 1013904223u;
+            const int kind = (seed >> 24) % 4;
+            if (kind == 0) {
+                displayListRect(&list, i, 0.0f, 0.5f, 128.0f, 130.0f, 0xFF2E2E2E);
+                rects++;
+            } else if (kind == 3) {
+                displayListText(&list, &text, C2D_WordWrap, i, 150.0f, 0.5f, 0.5f, 0xFFFFFFFF, 180.0f);
+                texts++;
+                blended++;
+            } else {
+                const bool blend = kind == 2;
+                displayListImage(&list, cover, i, 20.0f, 0.5f, blend);
+                images++;
+                blended += blend;
+            }
+        }
+
+        const u32 imageDraws = hostImageDraws, rectDraws = hostRectDraws, textDraws = hostTextDraws;
+        const u32 blendedDraws = hostBlendedDraws;
+        displayListSubmit(&list);
+
+        if (hostImageDraws - imageDraws != (u32)images || hostRectDraws - rectDraws != (u32)rects ||
+            hostTextDraws - textDraws != (u32)texts || hostBlendedDraws - blendedDraws != (u32)blended ||
+            list.blended != blended || !hostBlending) {
+            fprintf(stderr, "display list: %d commands submitted wrongly\n", count);
+            exit(1);
+        }
+    }
+
+    // A full list must refuse more commands
+    displayListClear(&list);
+    for (int i = 0; i < DISPLAY_LIST_MAX_COMMANDS; i++) displayListImage(&list, cover, i, 0.0f, 0.5f, i & 1);
+    if (displayListImage(&list, cover, 0.0f, 0.0f, 0.5f, false) || list.count != DISPLAY_LIST_MAX_COMMANDS) {
+        fprintf(stderr, "display list: accepted more than %d commands\n", DISPLAY_LIST_MAX_COMMANDS);
+        exit(1);
+    }
+
+    // A 3x2 tiled backdrop larger than the view records only the tiles on screen, blended
+    // unless the image is opaque
+    static const Tex3DS_SubTexture full = { TILED_IMAGE_TILE_SIZE, TILED_IMAGE_TILE_SIZE },
+                                   right = { 500, TILED_IMAGE_TILE_SIZE }, bottom = { TILED_IMAGE_TILE_SIZE, 300 },
+                                   corner = { 500, 300 };
+    C2D_Image tiles[6] = { { &texture, &full }, { &texture, &full }, { &texture, &right },
+                           { &texture, &bottom }, { &texture, &bottom }, { &texture, &corner } };
+    TiledImage backdrop = { 2 * TILED_IMAGE_TILE_SIZE + 500, TILED_IMAGE_TILE_SIZE + 300, 3, 2, GPU_RGBA4,
+                            IMAGE_TRANSLUCENT, tiles };
+    static const struct { float x, y; int tiles; } views[] = {
+        { 0.0f, 0.0f, 1 }, { -1000.0f, 0.0f, 2 }, { -2100.0f, 0.0f, 1 }, { 300.0f, -1000.0f, 2 },
+        { -1000.0f, -1000.0f, 4 }, { -2548.0f, 0.0f, 0 }, { 400.0f, 0.0f, 0 }, { 0.0f, -1324.0f, 0 },
+    };
+    for (int v = 0; v < (int)(sizeof(views) / sizeof(views[0])); v++) {
+        backdrop.opacity = v & 1 ? IMAGE_OPAQUE : IMAGE_TRANSLUCENT;
+        displayListClear(&list);
+        if (!displayListTiledImage(&list, &backdrop, views[v].x, views[v].y, 0.0f, 400.0f, 240.0f) ||
+            list.count != views[v].tiles || list.blended != (v & 1 ? 0 : views[v].tiles)) {
+            fprintf(stderr, "display list: backdrop at (%.0f, %.0f) recorded %d tiles, expected %d\n", views[v].x,
+                    views[v].y, list.count, views[v].tiles);
+            exit(1);
+        }
+    }
+
+    // A screen like the carousel's: a few covers and the selected title
+    const int frames = iterations * 10000;
+    double start = nowMs();
+    for (int frame = 0; frame < frames; frame++) {
+        displayListClear(&list);
+        for (int i = 0; i < 4; i++) displayListImage(&list, cover, i * 138.0f - (frame & 127), 20.0f, 0.5f, i == 2);
+        displayListText(&list, &text, 0, 150.0f, 160.0f, 0.5f, 0.5f, 0xFF9DE44C, 0.0f);
+    }
+    const double recordMs = (nowMs() - start) / frames;
+
+    start = nowMs();
+    for (int frame = 0; frame < frames; frame++) displayListSubmit(&list);
+    const double submitMs = (nowMs() - start) / frames;
+
+    printf("%-28s %-10s %4d %10.6f %10s %10s %10s  record %.6f ms\n", "display list submit", "screen", list.count,
+           submitMs, "-", "-", "-", recordMs);
+}
+
+typedef void (*BenchSwizzle)(void* texture, u32 textureWidth, u32 textureHeight, const u8* rgba, u32 width, u32 height);
+
+static void runSwizzleCase(const char* label, const BenchCorpus* corpus, BenchSwizzle swizzle, int iterations) {
+    u8* texture   = malloc(512 * 512 * 4);
+    u8* reference = malloc(512 * 512 * 4);
+    double totalMs    = 0.0;
+    double totalBytes = 0.0;
+
+    for (int i = 0; i < corpus->count; i++) {
+        const BenchImage* image = &corpus->images[i];
+        unsigned char* rgba;
+        unsigned width, height;
+        lodepng_decode32(&rgba, &width, &height, image->png, image->pngsize);
+
+        // Every kernel has to produce the same texels as the original loop
+        swizzleRGBA8Reference(reference, 512, 512, rgba, width, height);
+        swizzle(texture, 512, 512, rgba, width, height);
+        for (u32 y = 0; y < height && y < 512; y++) {
+            for (u32 x = 0; x < width && x < 512; x++) {
+                const u32 pos = calculateTexturePosition(x, y);
+                if (memcmp(&texture[pos], &reference[pos], 4)) {
+                    fprintf(stderr, "%s: mismatch in %s at (%u, %u)\n", label, image->name, x, y);
+                    exit(1);
+                }
+            }
+        }
+
+        double start = nowMs();
+        for (int n = 0; n < iterations; n++) swizzle(texture, 512, 512, rgba, width, height);
+        totalMs += nowMs() - start;
+        totalBytes += (double)width * height * 4 * iterations;
+
+        free(rgba);
+    }
+
+    printf("%-28s %-10s %4d %10.3f %10.2f %10s %10s\n",
+           label, corpus->name, corpus->count, totalMs / (corpus->count * iterations),
+           totalBytes / (1024.0 * 1024.0) / (totalMs / 1000.0), "-", "-");
+
+    free(reference);
+    free(texture);
+}
+
+typedef void (*BenchSwizzle16)(void* texture, u32 textureWidth, u32 textureHeight, const u8* rgba, u32 width, u32 height, bool dither);
+
+// Straightforward per-texel packing used to check the 16-bit kernels without dithering
+static u16 referencePack16(GPU_TEXCOLOR format, const u8* p) {
+    #define Q(v, max) (((v) * (max) + 127) / 255)
+    switch (format) {
+        case GPU_RGB565:
+            return (u16)(Q(p[0], 31) << 11 | Q(p[1], 63) << 5 | Q(p[2], 31));
+        case GPU_RGBA5551:
+            return (u16)(Q(p[0], 31) << 11 | Q(p[1], 31) << 6 | Q(p[2], 31) << 1 | (p[3] >= 128));
+        default:
+            return (u16)(Q(p[0], 15) << 12 | Q(p[1], 15) << 8 | Q(p[2], 15) << 4 | Q(p[3], 15));
+    }
+    #undef Q
+}
+
+static u32 referenceTexelIndex(u32 x, u32 y, u32 textureWidth) {
+    return ((y >> 3) * (textureWidth >> 3) + (x >> 3)) * 64 +
+           ((x & 1) | ((y & 1) << 1) | ((x & 2) << 1) | ((y & 2) << 2) | ((x & 4) << 2) | ((y & 4) << 3));
+}
+
+static void runSwizzle16Case(const char* label, const BenchCorpus* corpus, BenchSwizzle16 swizzle,
+                             GPU_TEXCOLOR format, bool dither, int iterations) {
+    double totalMs    = 0.0;
+    double totalBytes = 0.0;
+
+    for (int i = 0; i < corpus->count; i++) {
+        const BenchImage* image = &corpus->images[i];
+        unsigned char* rgba;
+        unsigned width, height;
+        lodepng_decode32(&rgba, &width, &height, image->png, image->pngsize);
+
+        const u32 textureWidth  = textureSizeFor(width);
+        const u32 textureHeight = textureSizeFor(height);
+        u16* texture = malloc((size_t)textureWidth * textureHeight * 2);
+
+        // Without dithering every texel must match the reference rounding exactly
+        swizzle(texture, textureWidth, textureHeight, rgba, width, height, false);
+        for (u32 y = 0; y < height && y < textureHeight; y++) {
+            for (u32 x = 0; x < width && x < textureWidth; x++) {
+                const u16 expected = referencePack16(format, &rgba[((size_t)y * width + x) * 4]);
+                if (texture[referenceTexelIndex(x, y, textureWidth)] != expected) {
+                    fprintf(stderr, "%s: mismatch in %s at (%u, %u)\n", label, image->name, x, y);
+                    exit(1);
+                }
+            }
+        }
+
+        double start = nowMs();
+        for (int n = 0; n < iterations; n++) swizzle(texture, textureWidth, textureHeight, rgba, width, height, dither);
+        totalMs += nowMs() - start;
+        totalBytes += (double)width * height * 4 * iterations;
+
+        free(texture);
+        free(rgba);
+    }
+
+    printf("%-28s %-10s %4d %10.3f %10.2f %10s %10s\n",
+           label, corpus->name, corpus->count, totalMs / (corpus->count * iterations),
+           totalBytes / (1024.0 * 1024.0) / (totalMs / 1000.0), "-", "-");
+}
+
+// Builds an in-memory .etc file for an RGBA image, choosing ETC1A4 only when alpha is used
+static u8* buildETC1File(const u8* rgba, u32 width, u32 height, size_t* size) {
+    const GPU_TEXCOLOR format = imageHasAlpha(rgba, width, height) ? GPU_ETC1A4 : GPU_ETC1;
+    ETC1FileHeader header = { { 0 } };
+
+    memcpy(header.magic, ETC1_FILE_MAGIC, 4);
+    header.version       = ETC1_FILE_VERSION;
+    header.format        = (u8)format;
+    header.width         = (u16)width;
+    header.height        = (u16)height;
+    header.textureWidth  = (u16)textureSizeFor(width);
+    header.textureHeight = (u16)textureSizeFor(height);
+    header.dataSize      = (u32)etc1TextureSize(format, header.textureWidth, header.textureHeight);
+
+    u8* file = malloc(sizeof(header) + header.dataSize);
+    memcpy(file, &header, sizeof(header));
+    etc1EncodeTexture(file + sizeof(header), format, header.textureWidth, header.textureHeight, rgba, width, height);
+
+    *size = sizeof(header) + header.dataSize;
+    return file;
+}
+
+// Peak signal-to-noise ratio of the decoded texture against the source image, over all four channels
+static double etc1PSNR(const u8* file, const u8* rgba, u32 width, u32 height) {
+    ETC1FileHeader header;
+    memcpy(&header, file, sizeof(header));
+
+    u8* decoded = malloc((size_t)header.textureWidth * header.textureHeight * 4);
+    etc1DecodeTexture(decoded, (GPU_TEXCOLOR)header.format, header.textureWidth, header.textureHeight, file + sizeof(header));
+
+    double error = 0.0;
+    for (u32 y = 0; y < height; y++) {
+        for (u32 x = 0; x < width; x++) {
+            for (u32 c = 0; c < 4; c++) {
+                const double d = (double)decoded[((size_t)y * header.textureWidth + x) * 4 + c] - rgba[((size_t)y * width + x) * 4 + c];
+                error += d * d;
+            }
+        }
+    }
+    free(decoded);
+
+    const double mse = error / ((double)width * height * 4);
+    return mse > 0.0 ? 10.0 * log10(255.0 * 255.0 / mse) : 99.0;
+}
+
+static void runETC1Case(const BenchCorpus* corpus, int iterations) {
+    double encodeMs   = 0.0;
+    double totalMs    = 0.0;
+    double totalBytes = 0.0;
+    double texBytes   = 0.0;
+    double minPSNR    = 99.0;
+    size_t peak       = 0;
+
+    for (int i = 0; i < corpus->count; i++) {
+        const BenchImage* image = &corpus->images[i];
+        unsigned char* rgba;
+        unsigned width, height;
+        lodepng_decode32(&rgba, &width, &height, image->png, image->pngsize);
+        if (width > MAX_TEXTURE_SIZE || height > MAX_TEXTURE_SIZE) {
+            free(rgba);
+            continue;
+        }
+
+        size_t size;
+        double start = nowMs();
+        u8* file = buildETC1File(rgba, width, height, &size);
+        encodeMs += nowMs() - start;
+
+        // The encoder has to round-trip within a sane quality bound
+        const double psnr = etc1PSNR(file, rgba, width, height);
+        if (psnr < 20.0) {
+            fprintf(stderr, "etc1: %s decodes at %.1f dB\n", image->name, psnr);
+            exit(1);
+        }
+        if (psnr < minPSNR) minPSNR = psnr;
+
+        for (int n = 0; n < iterations; n++) {
+            size_t baseline = heapCurrent;
+            heapPeak = heapCurrent;
+
+            start = nowMs();
+            C2D_Image img = convertETC1BufferToC2DImage(file, size);
+            totalMs += nowMs() - start;
+
+            if (heapPeak - baseline > peak) peak = heapPeak - baseline;
+            texBytes += img.tex->size;
+            freeC2DImage(&img);
+            totalBytes += (double)width * height * 4;
+        }
+
+        free(file);
+        free(rgba);
+    }
+
+    const int runs = corpus->count * iterations;
+    printf("%-28s %-10s %4d %10.3f %10.2f %10zu %10.0f\n",
+           "convertETC1BufferToC2DImage", corpus->name, corpus->count, totalMs / runs,
+           totalBytes / (1024.0 * 1024.0) / (totalMs / 1000.0), peak / 1024, texBytes / runs / 1024);
+    printf("%-28s %-10s %4d %10.3f %10s %10s %10s  min PSNR %.1f dB\n",
+           "etc1 encode (host)", corpus->name, corpus->count, encodeMs / corpus->count, "-", "-", "-", minPSNR);
+}
+
+// Fails if two live atlas entries overlap or an entry leaves its page
+static void checkAtlas(const Atlas* atlas) {
+    // Nothing separates neighbouring entries, so filtering must not reach across them
+    for (int i = 0; i < atlas->pageCount; i++) {
+        if (atlas->pages[i].tex.param & 0x6u) {
+            fprintf(stderr, "atlas: page %d is sampled with linear filtering\n", i);
+            exit(1);
+        }
+    }
+
+    for (int i = 0; i < ATLAS_MAX_ENTRIES; i++) {
+        const AtlasEntry* a = &atlas->entries[i];
+        if (a->id < 0) continue;
+        if (a->rect.x + a->rect.width > atlas->pageSize || a->rect.y + a->rect.height > atlas->pageSize) {
+            fprintf(stderr, "atlas: entry %d leaves its page\n", a->id);
+            exit(1);
+        }
+
+        for (int j = i + 1; j < ATLAS_MAX_ENTRIES; j++) {
+            const AtlasEntry* b = &atlas->entries[j];
+            if (b->id < 0 || b->page != a->page) continue;
+            if (a->rect.x < b->rect.x + b->rect.width && b->rect.x < a->rect.x + a->rect.width &&
+                a->rect.y < b->rect.y + b->rect.height && b->rect.y < a->rect.y + a->rect.height) {
+                fprintf(stderr, "atlas: entries %d and %d overlap\n", a->id, b->id);
+                exit(1);
+            }
+        }
+    }
+}
+
+static void runAtlasCase(const BenchCorpus* corpus, int iterations) {
+    const TextureOptions options = { GPU_RGBA4, true };
+    C2D_Image covers[MAX_CORPUS];
+
+    for (int i = 0; i < corpus->count; i++) {
+        covers[i] = convertPNGBufferToC2DImageWithOptions(corpus->images[i].png, corpus->images[i].pngsize, &options);
+    }
+
+    // Fill a fresh atlas with the whole corpus, several copies of each cover
+    const int copies = 8;
+    double totalMs = 0.0;
+    Atlas* atlas = NULL;
+    for (int n = 0; n < iterations; n++) {
+        atlasDestroy(atlas);
+        atlas = atlasCreate(ATLAS_PAGE_SIZE, GPU_RGBA4);
+
+        double start = nowMs();
+        for (int c = 0; c < copies; c++) {
+            for (int i = 0; i < corpus->count; i++) {
+                C2D_Image packed;
+                atlasInsertImage(atlas, c * MAX_CORPUS + i, &covers[i], &packed);
+            }
+        }
+        totalMs += nowMs() - start;
+    }
+    checkAtlas(atlas);
+
+    int textures = 0;
+    for (int i = 0; i < corpus->count; i++) {
+        // Consecutive carousel boxes only cost a rebind when the page changes
+        if (!i || atlasGet(atlas, i).tex != atlasGet(atlas, i - 1).tex) textures++;
+    }
+    printf("%-28s %-10s %4d %10.3f %10s %10s %10.0f  %d pages, %.0f%% used, %d textures for the set\n",
+           "atlasInsertImage", corpus->name, corpus->count * copies, totalMs / (iterations * copies * corpus->count),
+           "-", "-", (double)atlas->pageCount * atlas->pageSize * atlas->pageSize * 2 / 1024,
+           atlas->pageCount, atlasOccupancy(atlas) * 100.0f, textures);
+
+    // Random eviction and reinsertion must never produce overlapping entries
+    u32 seed = 12345;
+    for (int n = 0; n < 2000; n++) {
+        seed = seed * 1664525u + 1013904223u;
+        const int id = (seed >> 8) % (copies * MAX_CORPUS);
+        if ((seed >> 4) & 1) {
+            atlasRemove(atlas, id);
+        } else if (id % MAX_CORPUS < corpus->count) {
+            C2D_Image packed;
+            atlasInsertImage(atlas, id, &covers[id % MAX_CORPUS], &packed);
+        }
+        checkAtlas(atlas);
+    }
+
+    atlasDestroy(atlas);
+
+    // An atlas of TEXTURE_FORMAT_AUTO keeps each cover in the format it was decoded to, on pages
+    // of that format, and gives emptied pages to whichever format needs room
+    C2D_Image opaque[MAX_CORPUS];
+    const TextureOptions opaqueOptions = { GPU_RGB565, true };
+    for (int i = 0; i < corpus->count; i++) {
+        opaque[i] = convertPNGBufferToC2DImageWithOptions(corpus->images[i].png, corpus->images[i].pngsize,
+                                                          &opaqueOptions);
+    }
+    atlas = atlasCreate(ATLAS_PAGE_SIZE, TEXTURE_FORMAT_AUTO);
+    seed = 777;
+    for (int n = 0; n < 2000; n++) {
+        seed = seed * 1664525u + 1013904223u;
+        const int id = (seed >> 8) % (copies * MAX_CORPUS);
+        const C2D_Image* source = (id & 1 ? opaque : covers) + id % MAX_CORPUS;
+        C2D_Image packed;
+        if ((seed >> 4) & 1) {
+            atlasRemove(atlas, id);
+        } else if (id % MAX_CORPUS < corpus->count && atlasInsertImage(atlas, id, source, &packed) &&
+                   (packed.tex->fmt != source->tex->fmt || atlasGet(atlas, id).subtex != packed.subtex)) {
+            fprintf(stderr, "atlas: a cover of format %d was packed into a page of format %d\n", source->tex->fmt,
+                    packed.tex->fmt);
+            exit(1);
+        }
+        checkAtlas(atlas);
+    }
+    int formats[2] = { 0, 0 };
+    for (int i = 0; i < atlas->pageCount; i++) formats[atlas->pages[i].tex.fmt == GPU_RGB565]++;
+    printf("%-28s %-10s %4d %10s %10s %10s %10s  %d RGBA4 and %d RGB565 pages\n", "atlas, mixed formats",
+           corpus->name, corpus->count * copies, "-", "-", "-", "-", formats[0], formats[1]);
+
+    atlasDestroy(atlas);
+    for (int i = 0; i < corpus->count; i++) {
+        freeC2DImage(&covers[i]);
+        freeC2DImage(&opaque[i]);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    const char* dir = "images";
+    int iterations  = DEFAULT_ITERATIONS;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+            iterations = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-d") && i + 1 < argc) {
+            dir = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [-n iterations] [-d image-dir]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (iterations < 1) iterations = 1;
+
+    static BenchCorpus images, synthetic, native, large;
+    if (!loadImageSet(&images, dir)) {
+        fprintf(stderr, "no images found in %s\n", dir);
+        return 1;
+    }
+    buildSyntheticCorpus(&synthetic);
+    buildNativeCorpus(&native);
+    buildLargeCorpus(&large);
+
+    printf("%-28s %-10s %4s %10s %10s %10s %10s\n", "case", "corpus", "imgs", "ms/image", "MB/s", "peak KiB", "tex KiB");
+    runCase("convertPNGToC2DImage", &images, convertFromFile, iterations);
+    runCase("convertPNGBufferToC2DImage", &images, convertFromMemory, iterations);
+    runCase("convertPNGBufferToC2DImage", &synthetic, convertFromMemory, iterations);
+    checkBandDecode("band decode RGBA8", &images, GPU_RGBA8, false);
+    checkBandDecode("band decode RGBA8", &synthetic, GPU_RGBA8, false);
+    checkBandDecode("band decode RGBA4", &synthetic, GPU_RGBA4, true);
+    checkBandDecode("band decode RGBA8", &native, GPU_RGBA8, false);
+    checkBandDecode("band decode RGBA4", &native, GPU_RGBA4, true);
+    checkBandDecode("band decode auto", &images, TEXTURE_FORMAT_AUTO, true);
+    checkBandDecode("band decode auto", &synthetic, TEXTURE_FORMAT_AUTO, true);
+    checkBandDecode("band decode auto", &native, TEXTURE_FORMAT_AUTO, true);
+    runCase("convertPNGBufferToC2DImage", &native, convertFromMemory, iterations);
+    runPixelKernelCase(iterations);
+    runOpacityCase(&images);
+    runOpacityCase(&synthetic);
+    runOpacityCase(&native);
+    runTiledImageCase("tiled image RGBA8", &large, &(TextureOptions){ GPU_RGBA8, false }, iterations);
+    runTiledImageCase("tiled image auto+dither", &large, &defaultTextureOptions, iterations);
+    checkDownscaleFailure(&large);
+    runCarouselCase();
+    runDisplayListCase(iterations);
+    runSlicedDecodeCase(&images, 250);
+    runSlicedDecodeCase(&images, 1000);
+    runSlicedDecodeCase(&synthetic, 2000);
+    benchOptions = (TextureOptions){ GPU_RGBA8, false };
+    runCase("options RGBA8", &images, convertWithOptions, iterations);
+    runCase("options RGBA8", &synthetic, convertWithOptions, iterations);
+    benchOptions = (TextureOptions){ GPU_RGBA4, true };
+    runCase("options RGBA4+dither", &images, convertWithOptions, iterations);
+    runCase("options RGBA4+dither", &synthetic, convertWithOptions, iterations);
+    benchOptions = (TextureOptions){ TEXTURE_FORMAT_AUTO, true };
+    runCase("options auto+dither", &images, convertWithOptions, iterations);
+    runCase("options auto+dither", &synthetic, convertWithOptions, iterations);
+    // Cold runs miss the cache and rebuild every entry, warm runs read the entries back
+    char cacheDir[] = "/tmp/slipstream-cache-XXXXXX";
+    if (mkdtemp(cacheDir)) {
+        textureCacheDirectory = cacheDir;
+        double coldStart = nowMs();
+        for (int n = 0; n < iterations; n++) {
+            clearCache(&images);
+            for (int i = 0; i < images.count; i++) {
+                C2D_Image img = convertFromCache(&images.images[i]);
+                freeC2DImage(&img);
+            }
+        }
+        printf("%-28s %-10s %4d %10.3f %10s %10s %10s\n", "texture cache (cold)", images.name, images.count,
+               (nowMs() - coldStart) / (images.count * iterations), "-", "-", "-");
+        runCase("texture cache (warm)", &images, convertFromCache, iterations);
+        runLoaderCase(&images, iterations);
+        runResidencyCase(&images, 256 * 1024, false);
+        clearCache(&images);
+        runResidencyCase(&images, 256 * 1024, true);
+        clearCache(&images);
+        runSaturatedResidencyCase(&images);
+        clearCache(&images);
+
+        const BenchCorpus* coverSets[] = { &synthetic, &native };
+        for (int set = 0; set < 2; set++) {
+            static BenchCorpus coverLibrary;
+            char coverDir[] = "/tmp/slipstream-covers-XXXXXX";
+            if (mkdtemp(coverDir) && writeCoverLibrary(&coverLibrary, coverSets[set], coverDir)) {
+                runCoverFormatCase(&coverLibrary, false);
+                clearCache(&coverLibrary);
+                runCoverFormatCase(&coverLibrary, true);
+                clearCache(&coverLibrary);
+            } else {
+                benchFailed("cover formats: cannot write the %s covers to %s\n", coverSets[set]->name, coverDir);
+            }
+            for (int i = 0; i < coverLibrary.count; i++) remove(coverLibrary.images[i].path);
+            rmdir(coverDir);
+        }
+
+        char libraryDir[] = "/tmp/slipstream-library-XXXXXX";
+        if (mkdtemp(libraryDir) && buildPrefetchLibrary(&images, libraryDir)) {
+            runPrefetchCases(false);
+            runPrefetchCases(true);
+        } else {
+            benchFailed("prefetch: cannot write the library to %s\n", libraryDir);
+        }
+        for (int i = 0; i < prefetchLibrary.count; i++) remove(prefetchLibrary.images[i].path);
+        rmdir(libraryDir);
+        rmdir(cacheDir);
+    } else {
+        benchFailed("texture cache: cannot create %s, cache and residency cases skipped\n", cacheDir);
+    }
+
+    runBundleCase(&images, iterations);
+    runIOCase();
+    runJobsCase(&synthetic, iterations);
+
+    runSwizzleCase("swizzle reference", &images, swizzleRGBA8Reference, iterations);
+    runSwizzleCase("swizzleRGBA8", &images, swizzleRGBA8, iterations);
+    runSwizzleCase("swizzle reference", &synthetic, swizzleRGBA8Reference, iterations);
+    runSwizzleCase("swizzleRGBA8", &synthetic, swizzleRGBA8, iterations);
+    runSwizzle16Case("swizzleRGB565", &images, swizzleRGB565, GPU_RGB565, false, iterations);
+    runSwizzle16Case("swizzleRGB565 dither", &images, swizzleRGB565, GPU_RGB565, true, iterations);
+    runSwizzle16Case("swizzleRGBA5551 dither", &images, swizzleRGBA5551, GPU_RGBA5551, true, iterations);
+    runSwizzle16Case("swizzleRGBA4 dither", &images, swizzleRGBA4, GPU_RGBA4, true, iterations);
+    runSwizzle16Case("swizzleRGB565 dither", &synthetic, swizzleRGB565, GPU_RGB565, true, iterations);
+    runAtlasCase(&images, iterations);
+    runETC1Case(&images, iterations);
+    runETC1Case(&synthetic, iterations);
+
+    freeCorpus(&images);
+    freeCorpus(&synthetic);
+    freeCorpus(&native);
+    freeCorpus(&large);
+
+    if (benchFailures) {
+        fprintf(stderr, "%d check%s failed\n", benchFailures, benchFailures == 1 ? "" : "s");
+        return 1;
+    }
+    return 0;
+}
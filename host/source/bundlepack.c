@@ -0,0 +1,72 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "lodepng.h"
+#include "bundle.h"
+
+/*
+    Host-side cover packer.
+
+    Packs cover files into a bundle the launcher reads instead of the loose
+    images. The cover UID is the number at the end of the file name (game7.png
+    is cover 7) and the extension picks the asset type: .png or .etc.
+
+    usage: bundlepack output.bundle cover.png|cover.etc ...
+*/
+
+// Parses "<dir>/<name><digits>.<ext>" into the id and asset type
+static bool parseCoverName(const char* path, u32* id, u32* type) {
+    const char* dot = strrchr(path, '.');
+    if (!dot || dot == path) return false;
+
+    if (!strcmp(dot, ".png")) *type = BUNDLE_PNG;
+    else if (!strcmp(dot, ".etc")) *type = BUNDLE_ETC1;
+    else return false;
+
+    const char* digits = dot;
+    while (digits > path && isdigit((unsigned char)digits[-1])) digits--;
+    if (digits == dot) return false;
+
+    *id = (u32)strtoul(digits, NULL, 10);
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s output.bundle cover.png|cover.etc ...\n", argv[0]);
+        return 1;
+    }
+
+    const u32 count = (u32)(argc - 2);
+    BundleAsset* assets = calloc(count, sizeof(BundleAsset));
+    int status = assets ? 0 : 1;
+
+    for (u32 i = 0; i < count && !status; i++) {
+        const char* path = argv[i + 2];
+        if (!parseCoverName(path, &assets[i].id, &assets[i].type)) {
+            fprintf(stderr, "%s: expected a name like game0.png or game0.etc\n", path);
+            status = 1;
+            break;
+        }
+
+        unsigned char* data;
+        unsigned error = lodepng_load_file(&data, &assets[i].size, path);
+        if (error) {
+            fprintf(stderr, "%s: error %u: %s\n", path, error, lodepng_error_text(error));
+            status = 1;
+            break;
+        }
+        assets[i].data = data;
+    }
+
+    if (!status && !bundleWrite(argv[1], assets, count)) {
+        fprintf(stderr, "%s: write failed (duplicate covers?)\n", argv[1]);
+        status = 1;
+    }
+    if (!status) printf("%s: %u assets\n", argv[1], (unsigned)count);
+
+    for (u32 i = 0; assets && i < count; i++) free((void*)assets[i].data);
+    free(assets);
+    return status;
+}
@@ -0,0 +1,314 @@
+#define _GNU_SOURCE
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <3ds.h>
+#include <citro3d.h>
+#include <citro2d.h>
+#include <tex3ds.h>
+
+/*
+    Host implementations of the ctru/citro3d stand-ins declared in host/include.
+    They keep the same contracts as the console libraries (texture sizes, return
+    values) so the shared sources behave the same way on both targets.
+*/
+
+void* linearAlloc(size_t size) {
+    return malloc(size);
+}
+
+void linearFree(void* mem) {
+    free(mem);
+}
+
+u64 osGetTime(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (u64)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+u64 svcGetSystemTick(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * SYSCLOCK_ARM11 + (u64)ts.tv_nsec * SYSCLOCK_ARM11 / 1000000000;
+}
+
+struct Thread_tag {
+    pthread_t  handle;
+    ThreadFunc entrypoint;
+    void*      arg;
+};
+
+static void* threadEntry(void* arg) {
+    Thread thread = (Thread)arg;
+    thread->entrypoint(thread->arg);
+    return NULL;
+}
+
+Thread threadCreate(ThreadFunc entrypoint, void* arg, size_t stack_size, int prio, int core_id, bool detached) {
+    (void)stack_size;
+    (void)prio;
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+
+    if (core_id >= 0) {
+        if (core_id >= sysconf(_SC_NPROCESSORS_ONLN)) {
+            pthread_attr_destroy(&attr);
+            return NULL;
+        }
+
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(core_id, &cpus);
+        pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus);
+    }
+
+    Thread thread = calloc(1, sizeof(*thread));
+    if (!thread) {
+        pthread_attr_destroy(&attr);
+        return NULL;
+    }
+
+    thread->entrypoint = entrypoint;
+    thread->arg        = arg;
+    const int error = pthread_create(&thread->handle, &attr, threadEntry, thread);
+    pthread_attr_destroy(&attr);
+    if (error) {
+        free(thread);
+        return NULL;
+    }
+    if (detached) pthread_detach(thread->handle);
+
+    return thread;
+}
+
+Result threadJoin(Thread thread, u64 timeout_ns) {
+    (void)timeout_ns;
+    return pthread_join(thread->handle, NULL) ? -1 : 0;
+}
+
+void threadFree(Thread thread) {
+    free(thread);
+}
+
+Result svcGetThreadPriority(s32* out, Handle handle) {
+    (void)handle;
+    *out = 0x30;
+    return 0;
+}
+
+void svcSleepThread(s64 ns) {
+    struct timespec ts = { ns / 1000000000, ns % 1000000000 };
+    nanosleep(&ts, NULL);
+}
+
+Result APT_CheckNew3DS(bool* out) {
+    *out = false;
+    return 0;
+}
+
+Result APT_SetAppCpuTimeLimit(u32 percent) {
+    (void)percent;
+    return 0;
+}
+
+void osSetSpeedupEnable(bool enable) {
+    (void)enable;
+}
+
+void LightEvent_Init(LightEvent* event, ResetType reset_type) {
+    pthread_mutex_init(&event->mutex, NULL);
+    pthread_cond_init(&event->cond, NULL);
+    event->signalled = false;
+    event->type      = reset_type;
+}
+
+void LightEvent_Clear(LightEvent* event) {
+    pthread_mutex_lock(&event->mutex);
+    event->signalled = false;
+    pthread_mutex_unlock(&event->mutex);
+}
+
+void LightEvent_Signal(LightEvent* event) {
+    pthread_mutex_lock(&event->mutex);
+    event->signalled = true;
+    pthread_cond_broadcast(&event->cond);
+    pthread_mutex_unlock(&event->mutex);
+}
+
+void LightEvent_Wait(LightEvent* event) {
+    pthread_mutex_lock(&event->mutex);
+    while (!event->signalled) {
+        pthread_cond_wait(&event->cond, &event->mutex);
+    }
+    if (event->type == RESET_ONESHOT) event->signalled = false;
+    pthread_mutex_unlock(&event->mutex);
+}
+
+void LightLock_Init(LightLock* lock) {
+    pthread_mutex_init(lock, NULL);
+}
+
+void LightLock_Lock(LightLock* lock) {
+    pthread_mutex_lock(lock);
+}
+
+void LightLock_Unlock(LightLock* lock) {
+    pthread_mutex_unlock(lock);
+}
+
+FS_Path fsMakePath(FS_PathType type, const void* path) {
+    if (type == PATH_EMPTY) return (FS_Path){ type, 1, "" };
+    return (FS_Path){ type, (u32)strlen(path) + 1, path };
+}
+
+Result FSUSER_OpenFileDirectly(Handle* out, FS_ArchiveID archiveId, FS_Path archivePath, FS_Path filePath,
+                               u32 openFlags, u32 attributes) {
+    (void)archivePath; (void)attributes;
+    if (archiveId != ARCHIVE_SDMC || filePath.type != PATH_ASCII || openFlags != FS_OPEN_READ) return -1;
+
+    const int fd = open(filePath.data, O_RDONLY);
+    if (fd < 0) return -1;
+    *out = (Handle)fd;
+    return 0;
+}
+
+Result FSFILE_Read(Handle handle, u32* bytesRead, u64 offset, void* buffer, u32 size) {
+    u32 total = 0;
+    while (total < size) {
+        const ssize_t got = pread((int)handle, (u8*)buffer + total, size - total, (off_t)(offset + total));
+        if (got < 0) return -1;
+        if (!got) break;
+        total += (u32)got;
+    }
+    *bytesRead = total;
+    return 0;
+}
+
+Result FSFILE_GetSize(Handle handle, u64* size) {
+    struct stat info;
+    if (fstat((int)handle, &info)) return -1;
+    *size = (u64)info.st_size;
+    return 0;
+}
+
+Result FSFILE_Close(Handle handle) {
+    return close((int)handle) ? -1 : 0;
+}
+
+static u32 formatBits(GPU_TEXCOLOR format) {
+    switch (format) {
+        case GPU_RGBA8:
+            return 32;
+        case GPU_RGB8:
+            return 24;
+        case GPU_RGBA5551:
+        case GPU_RGB565:
+        case GPU_RGBA4:
+        case GPU_LA8:
+        case GPU_HILO8:
+            return 16;
+        case GPU_L8:
+        case GPU_A8:
+        case GPU_LA4:
+        case GPU_ETC1A4:
+            return 8;
+        default:
+            return 4;
+    }
+}
+
+bool C3D_TexInit(C3D_Tex* tex, u16 width, u16 height, GPU_TEXCOLOR format) {
+    // The GPU only samples power-of-two textures between 8 and 1024 texels
+    if (width < 8 || height < 8 || width > 1024 || height > 1024 ||
+        (width & (width - 1)) || (height & (height - 1))) {
+        return false;
+    }
+
+    memset(tex, 0, sizeof(*tex));
+    tex->size   = (size_t)width * height * formatBits(format) / 8;
+    tex->data   = linearAlloc(tex->size);
+    tex->fmt    = format;
+    tex->width  = width;
+    tex->height = height;
+
+    return tex->data != NULL;
+}
+
+void C3D_TexSetFilter(C3D_Tex* tex, GPU_TEXTURE_FILTER_PARAM magFilter, GPU_TEXTURE_FILTER_PARAM minFilter) {
+    tex->param = (tex->param & ~0x6u) | (magFilter << 1) | (minFilter << 2);
+}
+
+void C3D_TexSetWrap(C3D_Tex* tex, GPU_TEXTURE_WRAP_PARAM wrapS, GPU_TEXTURE_WRAP_PARAM wrapT) {
+    tex->param = (tex->param & ~0x7700u) | (wrapS << 12) | (wrapT << 8);
+}
+
+void C3D_TexFlush(C3D_Tex* tex) {
+    (void)tex;
+}
+
+void C3D_TexDelete(C3D_Tex* tex) {
+    linearFree(tex->data);
+    tex->data = NULL;
+}
+
+Tex3DS_Texture Tex3DS_TextureImportStdio(FILE* fp, C3D_Tex* tex, C3D_TexCube* texcube, bool vram) {
+    (void)fp; (void)tex; (void)texcube; (void)vram;
+    return NULL;
+}
+
+const Tex3DS_SubTexture* Tex3DS_GetSubTexture(const Tex3DS_Texture texture, size_t index) {
+    (void)texture; (void)index;
+    return NULL;
+}
+
+void Tex3DS_TextureFree(Tex3DS_Texture texture) {
+    (void)texture;
+}
+
+u32  hostImageDraws;
+u32  hostRectDraws;
+u32  hostTextDraws;
+u32  hostBlendedDraws;
+bool hostBlending = true;
+
+bool C2D_DrawImageAt(C2D_Image img, float x, float y, float depth, const C2D_ImageTint* tint, float scaleX,
+                     float scaleY) {
+    (void)x; (void)y; (void)depth; (void)tint; (void)scaleX; (void)scaleY;
+    hostImageDraws++;
+    if (hostBlending) hostBlendedDraws++;
+    return img.tex != NULL;
+}
+
+bool C2D_DrawRectSolid(float x, float y, float z, float w, float h, u32 clr) {
+    (void)x; (void)y; (void)z; (void)w; (void)h; (void)clr;
+    hostRectDraws++;
+    if (hostBlending) hostBlendedDraws++;
+    return true;
+}
+
+void C2D_DrawText(const C2D_Text* text, u32 flags, float x, float y, float z, float scaleX, float scaleY, ...) {
+    (void)text; (void)flags; (void)x; (void)y; (void)z; (void)scaleX; (void)scaleY;
+    hostTextDraws++;
+    if (hostBlending) hostBlendedDraws++;
+}
+
+void C2D_Flush(void) {
+}
+
+void C3D_AlphaBlend(GPU_BLENDEQUATION colorEq, GPU_BLENDEQUATION alphaEq, GPU_BLENDFACTOR srcClr,
+                    GPU_BLENDFACTOR dstClr, GPU_BLENDFACTOR srcAlpha, GPU_BLENDFACTOR dstAlpha) {
+    (void)colorEq; (void)alphaEq; (void)srcClr; (void)dstClr; (void)srcAlpha; (void)dstAlpha;
+    hostBlending = true;
+}
+
+void C3D_ColorLogicOp(GPU_LOGICOP op) {
+    (void)op;
+    hostBlending = false;
+}
@@ -0,0 +1,81 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lodepng.h"
+#include "etc1.h"
+#include "texture.h"
+
+/*
+    Host-side cover compressor.
+
+    Converts a PNG into a .etc file that convertETC1ToC2DImage uploads without
+    decoding: ETC1 for opaque art, ETC1A4 when the image uses alpha (unless a
+    format is forced with -f).
+
+    usage: etc1pack [-f auto|etc1|etc1a4] input.png output.etc
+*/
+
+int main(int argc, char* argv[]) {
+    const char* mode = "auto";
+    int arg = 1;
+
+    if (argc > 2 && !strcmp(argv[1], "-f")) {
+        mode = argv[2];
+        arg  = 3;
+    }
+    if (argc - arg != 2 || (strcmp(mode, "auto") && strcmp(mode, "etc1") && strcmp(mode, "etc1a4"))) {
+        fprintf(stderr, "usage: %s [-f auto|etc1|etc1a4] input.png output.etc\n", argv[0]);
+        return 1;
+    }
+
+    unsigned char* rgba;
+    unsigned width, height;
+    unsigned error = lodepng_decode32_file(&rgba, &width, &height, argv[arg]);
+    if (error) {
+        fprintf(stderr, "%s: error %u: %s\n", argv[arg], error, lodepng_error_text(error));
+        return 1;
+    }
+    if (width > MAX_TEXTURE_SIZE || height > MAX_TEXTURE_SIZE) {
+        fprintf(stderr, "%s: %ux%u does not fit a %d texel texture\n", argv[arg], width, height, MAX_TEXTURE_SIZE);
+        free(rgba);
+        return 1;
+    }
+
+    GPU_TEXCOLOR format;
+    if (!strcmp(mode, "auto")) {
+        format = imageHasAlpha(rgba, width, height) ? GPU_ETC1A4 : GPU_ETC1;
+    } else {
+        format = strcmp(mode, "etc1") ? GPU_ETC1A4 : GPU_ETC1;
+    }
+
+    ETC1FileHeader header = { { 0 } };
+    memcpy(header.magic, ETC1_FILE_MAGIC, 4);
+    header.version       = ETC1_FILE_VERSION;
+    header.format        = (u8)format;
+    header.width         = (u16)width;
+    header.height        = (u16)height;
+    header.textureWidth  = (u16)textureSizeFor(width);
+    header.textureHeight = (u16)textureSizeFor(height);
+    header.dataSize      = (u32)etc1TextureSize(format, header.textureWidth, header.textureHeight);
+
+    u8* data = malloc(header.dataSize);
+    etc1EncodeTexture(data, format, header.textureWidth, header.textureHeight, rgba, width, height);
+
+    FILE* file = fopen(argv[arg + 1], "wb");
+    if (!file || fwrite(&header, sizeof(header), 1, file) != 1 ||
+        fwrite(data, 1, header.dataSize, file) != header.dataSize) {
+        fprintf(stderr, "%s: write failed\n", argv[arg + 1]);
+        if (file) fclose(file);
+        free(data);
+        free(rgba);
+        return 1;
+    }
+    fclose(file);
+
+    printf("%s: %ux%u %s, %u bytes\n", argv[arg + 1], width, height,
+           format == GPU_ETC1A4 ? "ETC1A4" : "ETC1", (unsigned)(sizeof(header) + header.dataSize));
+
+    free(data);
+    free(rgba);
+    return 0;
+}
@@ -0,0 +1,73 @@
+#ifndef ATLAS_H
+#define ATLAS_H
+
+#include <3ds.h>
+#include <citro2d.h>
+#include "texture.h"
+
+// Default side of an atlas page in texels
+#define ATLAS_PAGE_SIZE 512
+
+// Limits of a single atlas
+#define ATLAS_MAX_PAGES     8
+#define ATLAS_MAX_ENTRIES   256
+#define ATLAS_MAX_SKYLINE   128
+#define ATLAS_MAX_FREE      64
+
+// Rectangle inside a page, in texels. Always 8-texel aligned so whole tiles can be copied.
+typedef struct {
+    u16 x, y;
+    u16 width, height;
+} AtlasRect;
+
+typedef struct {
+    u16 x, y, width;
+} AtlasSkylineNode;
+
+typedef struct {
+    C3D_Tex          tex;                         // Holds entries of its own format only (tex.fmt)
+    bool             allocated;
+    u16              liveCount;                   // Entries currently placed on this page
+    u16              skylineCount;
+    AtlasSkylineNode skyline[ATLAS_MAX_SKYLINE];  // Top edge of the packed area, left to right
+    u16              freeCount;
+    AtlasRect        freeRects[ATLAS_MAX_FREE];   // Holes left by removed entries
+} AtlasPage;
+
+typedef struct {
+    int               id;    // Caller's key, -1 if the slot is unused
+    u8                page;
+    AtlasRect         rect;
+    Tex3DS_SubTexture subtex;
+} AtlasEntry;
+
+typedef struct {
+    u16          pageSize;
+    GPU_TEXCOLOR format;     // Format of every page, or TEXTURE_FORMAT_AUTO for pages of each format inserted
+    u8           pageCount;
+    AtlasPage    pages[ATLAS_MAX_PAGES];
+    AtlasEntry   entries[ATLAS_MAX_ENTRIES];
+} Atlas;
+
+// Creates an empty atlas whose pages use 'format'; with TEXTURE_FORMAT_AUTO each page takes the format of its first cover.
+Atlas* atlasCreate(u16 pageSize, GPU_TEXCOLOR format);
+
+// Releases every page of the atlas and the atlas itself.
+void atlasDestroy(Atlas* atlas);
+
+// Copies tiled texture data of the atlas format (any, for TEXTURE_FORMAT_AUTO) into the atlas under 'id' and returns an image that samples it.
+bool atlasInsert(Atlas* atlas, int id, const TextureData* source, C2D_Image* image);
+
+// Copies a texture of the atlas format (any, for TEXTURE_FORMAT_AUTO) into the atlas under 'id' and returns an image that samples it.
+bool atlasInsertImage(Atlas* atlas, int id, const C2D_Image* source, C2D_Image* image);
+
+// Removes the entry stored under 'id'; its space is reused by later insertions.
+void atlasRemove(Atlas* atlas, int id);
+
+// Returns the image stored under 'id', or an empty image.
+C2D_Image atlasGet(Atlas* atlas, int id);
+
+// Fraction of allocated page area covered by live entries, 0..1.
+float atlasOccupancy(const Atlas* atlas);
+
+#endif // ATLAS_H
@@ -0,0 +1,92 @@
+#ifndef BUNDLE_H
+#define BUNDLE_H
+
+#include <stdio.h>
+#include <3ds.h>
+#include "texture.h"
+#include "ioqueue.h"
+
+// Cover art packed into one file, so a cold start does one directory lookup instead of one
+// per cover. Layout: BundleHeader, 'count' BundleEntry records sorted by id and type, then
+// the payloads, each starting on a BUNDLE_ALIGNMENT boundary and padded up to the next one.
+#define BUNDLE_MAGIC     "SBDL"
+#define BUNDLE_VERSION   1
+#define BUNDLE_ALIGNMENT 4096
+
+// Bundle next to the loose images that the launcher opens when present
+#define COVER_BUNDLE_PATH "images/covers.bundle"
+
+// Kinds of asset a bundle holds for an id
+typedef enum {
+    BUNDLE_PNG  = 0, // PNG file, decoded like images/gameN.png
+    BUNDLE_ETC1 = 1, // .etc file, see etc1.h
+} BundleAssetType;
+
+typedef struct {
+    char magic[4];  // BUNDLE_MAGIC
+    u8   version;   // BUNDLE_VERSION
+    u8   reserved[3];
+    u32  count;     // Index entries following the header
+    u32  alignment; // BUNDLE_ALIGNMENT the payloads were laid out with
+} BundleHeader;
+
+typedef struct {
+    u32 id;         // Cover UID
+    u32 type;       // BundleAssetType
+    u32 offset;     // Start of the payload in the bundle, a multiple of the alignment
+    u32 size;       // Bytes of payload, without the padding
+} BundleEntry;
+
+// An asset to write with bundleWrite
+typedef struct {
+    u32         id;
+    u32         type;
+    const void* data;
+    size_t      size;
+} BundleAsset;
+
+// An open bundle. The index is read once; payloads are read (or mapped) on demand.
+typedef struct {
+    char         path[128];
+    IOQueue*     queue;       // Serves the reads when given; the bundle is then neither mapped nor in 'file'
+    IOFile       io;          // The bundle opened for 'queue'
+    FILE*        file;        // Unbuffered; NULL when the bundle is mapped or read through 'queue'
+    LightLock    lock;        // Serialises the seek and read of one payload from 'file'
+    u8*          mapped;      // Whole bundle, when mapped into memory
+    size_t       mappedSize;
+    u32          count;
+    BundleEntry* entries;
+} Bundle;
+
+// Opens a bundle and reads its index. With 'map', the file is memory-mapped where the platform
+// supports it (Linux), making payloads zero-copy; otherwise reads go through 'queue' when given.
+// Returns NULL if the file is missing or invalid.
+Bundle* bundleOpen(const char* path, bool map, IOQueue* queue);
+
+// Releases the index and closes the file.
+void bundleClose(Bundle* bundle);
+
+// Finds the asset of 'type' stored for 'id'. Returns NULL if there is none.
+const BundleEntry* bundleFind(const Bundle* bundle, u32 id, BundleAssetType type);
+
+// Returns the payload of an entry, read with one aligned read of class 'priority' or pointing into
+// the mapping. Returns NULL once 'cancel' (may be NULL) is set before the read starts. Safe to call
+// from several threads. Release with bundleRelease.
+const u8* bundleAcquire(Bundle* bundle, const BundleEntry* entry, IOPriority priority, const atomic_bool* cancel);
+
+// Releases a payload returned by bundleAcquire.
+void bundleRelease(Bundle* bundle, const u8* data);
+
+// Loads the cover 'id' from the bundle: its ETC1 texture if present, else its PNG through the
+// texture cache. Returns false, with nothing allocated, if the bundle holds neither or the load
+// was cancelled.
+bool loadBundledTexture(Bundle* bundle, u32 id, IOPriority priority, const atomic_bool* cancel,
+                        const TextureOptions* options, TextureData* data, TextureAllocator allocate, void* context);
+
+// Name under which the texture of a bundled PNG is kept in the texture cache.
+void bundleAssetName(const Bundle* bundle, u32 id, char* name, size_t size);
+
+// Writes a bundle holding 'assets' (in any order). Used by the host packer.
+bool bundleWrite(const char* path, const BundleAsset* assets, u32 count);
+
+#endif // BUNDLE_H
@@ -0,0 +1,67 @@
+#ifndef CAROUSEL_H
+#define CAROUSEL_H
+
+#include <3ds.h>
+
+// Geometry and scroll position of a wrapping row of equally sized items. Positions are
+// derived from an item's index, so nothing is stored or updated per item.
+typedef struct {
+    int   count;       // Items in the library
+    int   first;       // Item in slot 0, the slot whose left edge is at or just left of the view's
+    float shift;       // How far slot 0 has scrolled past the left edge of the view, 0 <= shift < pitch
+    float pitch;       // Distance between the left edges of neighbouring slots
+    float itemWidth;   // Size of an item in px
+    float itemHeight;
+    float top;         // Vertical position of every item
+    float viewWidth;   // Width of the view the items scroll through
+    float margin;      // Extra px on either side of the view that still count as visible, 0 by default
+} Carousel;
+
+// An item laid out in a slot
+typedef struct {
+    int   slot;        // Slot number, relative to slot 0; negative to the left of it
+    int   index;       // Item shown in the slot, 0..count-1
+    float x, y;        // Top-left corner in px
+} CarouselSlot;
+
+// Selection of a carousel, derived from its scroll position once per frame
+typedef struct {
+    int  index;        // Item resting at the centre of the view, or -1 while scrolling between items
+    int  previous;     // 'index' of the frame before
+    int  nearest;      // Item closest to the centre of the view, never -1
+    bool changed;      // 'index' differs from the frame before; the selection-changed event
+} CarouselSelection;
+
+// Sets up a carousel of 'count' items with item 0 at the left edge of the view.
+void carouselInit(Carousel* carousel, int count, float itemWidth, float itemHeight, float spacing, float top,
+                  float viewWidth);
+
+// Moves every item by 'dx' px (negative moves them left), wrapping around the library.
+void carouselScroll(Carousel* carousel, float dx);
+
+// Returns the item in a slot, relative to slot 0, and where it is.
+CarouselSlot carouselSlot(const Carousel* carousel, int slot);
+
+// Fills 'slots' with the items overlapping the view and its margin, left to right, each item at most once.
+// Returns how many.
+int carouselVisible(const Carousel* carousel, CarouselSlot* slots, int max);
+
+// Returns the item whose centre is closest to the centre of the view.
+int carouselNearest(const Carousel* carousel);
+
+// Returns the item whose centre is within 'threshold' px of the centre of the view, or -1.
+int carouselSelected(const Carousel* carousel, float threshold);
+
+// Clears a selection to nothing selected.
+void carouselSelectionInit(CarouselSelection* selection);
+
+// Derives this frame's selection from the scroll position. Returns whether it changed.
+bool carouselUpdateSelection(CarouselSelection* selection, const Carousel* carousel, float threshold);
+
+// Returns the item drawn at (x, y), or -1 when the point is between or outside the items.
+int carouselItemAt(const Carousel* carousel, float x, float y);
+
+// Returns the left edge of the occurrence of an item nearest to the centre of the view.
+float carouselItemX(const Carousel* carousel, int index);
+
+#endif // CAROUSEL_H
@@ -0,0 +1,65 @@
+#ifndef DISPLAYLIST_H
+#define DISPLAYLIST_H
+
+#include <3ds.h>
+#include <citro2d.h>
+#include "tiledimage.h"
+
+// Commands a display list holds at most; main.c checks that its lists fit at compile time
+#define DISPLAY_LIST_MAX_COMMANDS 32
+
+typedef enum {
+    DRAW_IMAGE,
+    DRAW_RECT,
+    DRAW_TEXT,
+} DrawCommandType;
+
+// One recorded draw call
+typedef struct {
+    DrawCommandType type;
+    bool            blend;  // Reads the color buffer, so it is drawn after every command that does not
+    float           x, y, depth;
+    union {
+        C2D_Image image;
+        struct {
+            float width, height;
+            u32   color;
+        } rect;
+        struct {
+            const C2D_Text* text;   // Parsed text, kept alive by the caller while the list is used
+            u32             flags;  // C2D_DrawText flags besides C2D_WithColor
+            float           scale;
+            u32             color;
+            float           wrapWidth;  // For C2D_WordWrap
+        } text;
+    };
+} DrawCommand;
+
+// Draw calls of one screen, recorded when the layout changes and submitted every frame
+typedef struct {
+    int         count;
+    int         blended;   // Commands with 'blend' set
+    DrawCommand commands[DISPLAY_LIST_MAX_COMMANDS];
+} DisplayList;
+
+// Empties a display list.
+void displayListClear(DisplayList* list);
+
+// Records an image; 'blend' unless the image is opaque. Returns false when the list is full.
+bool displayListImage(DisplayList* list, C2D_Image image, float x, float y, float depth, bool blend);
+
+// Records the tiles of a tiled image that overlap a view of the given size. Returns false when the list is full.
+bool displayListTiledImage(DisplayList* list, const TiledImage* image, float x, float y, float depth, float viewWidth,
+                           float viewHeight);
+
+// Records an opaque rectangle. Returns false when the list is full.
+bool displayListRect(DisplayList* list, float x, float y, float depth, float width, float height, u32 color);
+
+// Records a colored text. Returns false when the list is full.
+bool displayListText(DisplayList* list, const C2D_Text* text, u32 flags, float x, float y, float depth, float scale,
+                     u32 color, float wrapWidth);
+
+// Draws the list into the current scene: opaque commands unblended first, then the blended ones.
+void displayListSubmit(const DisplayList* list);
+
+#endif // DISPLAYLIST_H
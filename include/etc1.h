@@ -0,0 +1,50 @@
+#ifndef ETC1_H
+#define ETC1_H
+
+#include <3ds.h>
+#include <citro2d.h>
+#include "texture.h"
+
+// Header of a pre-compressed cover (.etc). The texture data that follows is already in
+// the GPU's tiled block order and is copied into the texture as-is.
+#define ETC1_FILE_MAGIC   "SETC"
+#define ETC1_FILE_VERSION 1
+
+typedef struct {
+    char magic[4];      // ETC1_FILE_MAGIC
+    u8   version;       // ETC1_FILE_VERSION
+    u8   format;        // GPU_ETC1 or GPU_ETC1A4
+    u16  width;         // Image size in pixels
+    u16  height;
+    u16  textureWidth;  // Texture size in texels
+    u16  textureHeight;
+    u16  reserved;
+    u32  dataSize;      // Bytes of texture data following the header
+} ETC1FileHeader;
+
+// Size in bytes of a tiled ETC1 or ETC1A4 texture.
+size_t etc1TextureSize(GPU_TEXCOLOR format, u32 textureWidth, u32 textureHeight);
+
+// Compresses an RGBA image into a tiled ETC1/ETC1A4 texture. Texels outside the image repeat its edge.
+void etc1EncodeTexture(void* texture, GPU_TEXCOLOR format, u32 textureWidth, u32 textureHeight,
+                       const u8* rgba, u32 width, u32 height);
+
+// Expands a tiled ETC1/ETC1A4 texture back into a linear RGBA image of textureWidth x textureHeight.
+void etc1DecodeTexture(u8* rgba, GPU_TEXCOLOR format, u32 textureWidth, u32 textureHeight, const void* texture);
+
+// Returns true if any pixel of the RGBA image is not fully opaque.
+bool imageHasAlpha(const u8* rgba, u32 width, u32 height);
+
+// Loads a .etc file straight into a compressed GPU texture. Returns an empty image if the file is missing or invalid.
+C2D_Image convertETC1ToC2DImage(const char* filename);
+
+// Reads a .etc file into memory from 'allocate'; usable off the GPU thread. Returns false if the file is missing or invalid.
+bool loadETC1Texture(const char* filename, TextureData* data, TextureAllocator allocate, void* context);
+
+// Copies a .etc file held in memory into memory from 'allocate'; usable off the GPU thread.
+bool decodeETC1ToTexture(const u8* buffer, size_t size, TextureData* data, TextureAllocator allocate, void* context);
+
+// Same as convertETC1ToC2DImage, but reads a .etc file that is already in memory.
+C2D_Image convertETC1BufferToC2DImage(const u8* data, size_t size);
+
+#endif // ETC1_H
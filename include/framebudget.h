@@ -0,0 +1,32 @@
+#ifndef FRAMEBUDGET_H
+#define FRAMEBUDGET_H
+
+#include <3ds.h>
+
+// Frame time the carousel has to hold, 60 fps
+#define FRAME_TARGET_US 16667
+
+// Part of each frame left free for jitter in the frame's own work
+#define FRAME_BUDGET_MARGIN_US 2000
+
+// Limits of the time handed to sliced work per frame
+#define FRAME_BUDGET_MIN_US 250
+#define FRAME_BUDGET_MAX_US 8000
+
+// Time per frame that work spread over frames (like decoding covers) may take, adapted to
+// how busy the frames themselves are
+typedef struct {
+    u32 budgetUs; // Time the sliced work may take in the coming frame
+    u32 frameUs;  // Estimate of a frame's own busy time, sliced work excluded
+} FrameBudget;
+
+// Starts with the minimum budget until frames have been measured.
+void frameBudgetInit(FrameBudget* budget);
+
+// Records a finished frame: 'busyUs' of CPU time outside vsync waits, 'slicedUs' of it spent on sliced work.
+void frameBudgetUpdate(FrameBudget* budget, u32 busyUs, u32 slicedUs);
+
+// Converts a difference of svcGetSystemTick values to microseconds.
+u32 ticksToMicroseconds(u64 ticks);
+
+#endif // FRAMEBUDGET_H
@@ -0,0 +1,9 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <3ds.h>
+
+// 64-bit non-cryptographic hash of a buffer (XXH64).
+u64 hash64(const void* data, size_t size, u64 seed);
+
+#endif // HASH_H
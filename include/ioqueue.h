@@ -0,0 +1,91 @@
+#ifndef IOQUEUE_H
+#define IOQUEUE_H
+
+#include <stdatomic.h>
+#include <3ds.h>
+
+// Stack size of the I/O thread; it only issues reads
+#define IO_STACK_SIZE (16 * 1024)
+
+// Largest read made by merging adjacent requests into one
+#define IO_MAX_COALESCE (256 * 1024)
+
+// Requests merged into one read at most
+#define IO_MAX_RUN 16
+
+// Background reads are issued in pieces of this size, so a more urgent request waits for
+// at most one piece instead of a whole cache rebuild
+#define IO_BACKGROUND_CHUNK (32 * 1024)
+
+// Priority classes, most urgent first. A request is only started while no request of a
+// more urgent class is queued.
+typedef enum {
+    IO_PRIORITY_VISIBLE    = 0, // Art on screen now
+    IO_PRIORITY_PREFETCH   = 1, // Art expected to scroll into view
+    IO_PRIORITY_BACKGROUND = 2, // Cache rebuilds and other reads nobody is waiting on
+    IO_PRIORITY_COUNT
+} IOPriority;
+
+typedef enum {
+    IO_QUEUED    = 0,
+    IO_READING   = 1,
+    IO_DONE      = 2, // 'read' holds the bytes read, fewer than 'size' at the end of the file
+    IO_FAILED    = 3,
+    IO_CANCELLED = 4, // Dropped before it started; nothing was read
+} IOState;
+
+// A file opened for scheduled reads
+typedef struct {
+    Handle handle;
+    u64    size;
+} IOFile;
+
+// One read. Lives in the submitter's memory until ioWait returns.
+typedef struct IORequest {
+    IOFile*            file;
+    u64                offset;
+    u32                size;
+    void*              buffer;     // Receives 'size' bytes
+    IOPriority         priority;
+    const atomic_bool* cancel;     // The read is dropped if this is set before it starts, may be NULL
+    u32                read;       // Bytes read once done
+    atomic_int         state;      // IOState
+    LightEvent         done;       // Signalled once the state is final
+    struct IORequest*  next;       // Next request of the same class (I/O thread lock)
+} IORequest;
+
+// Thread that serves reads in priority order, merging adjacent ones
+typedef struct {
+    Thread      thread;
+    LightEvent  wake;                        // Signalled when a request is queued or on shutdown
+    LightLock   lock;                        // Guards the queues
+    atomic_bool quit;
+    IORequest*  head[IO_PRIORITY_COUNT];     // Queued requests of each class, oldest first
+    IORequest*  tail[IO_PRIORITY_COUNT];
+    atomic_uint reads;                       // File reads issued
+    atomic_uint served;                      // Requests completed by them
+    atomic_uint cancelled;                   // Requests dropped before they started
+} IOQueue;
+
+// Starts the I/O thread. Returns NULL on failure.
+IOQueue* ioQueueCreate(void);
+
+// Stops the I/O thread. Requests still queued are cancelled.
+void ioQueueDestroy(IOQueue* queue);
+
+// Opens a file on the SD card for reading; relative paths are resolved against the working directory.
+bool ioOpen(IOFile* file, const char* path);
+
+// Closes a file opened with ioOpen.
+void ioClose(IOFile* file);
+
+// Queues a read. Fill in file, offset, size, buffer, priority and cancel first.
+void ioSubmit(IOQueue* queue, IORequest* request);
+
+// Drops a request that has not started. Returns false if it is already being read or finished.
+bool ioCancel(IOQueue* queue, IORequest* request);
+
+// Blocks until the request is done, failed or cancelled and returns that state.
+IOState ioWait(IORequest* request);
+
+#endif // IOQUEUE_H
@@ -0,0 +1,70 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <stdatomic.h>
+#include <3ds.h>
+
+// Worker threads besides the thread that owns the job system
+#define JOB_MAX_WORKERS 3
+
+// Jobs a deque can hold; a power of two so indices wrap with a mask
+#define JOB_DEQUE_CAPACITY 256
+
+// Share of the system core the application may use, needed to run a worker on core 1
+#define JOB_SYSCORE_TIME_LIMIT 30
+
+// Stack size of a worker thread
+#define JOB_STACK_SIZE (32 * 1024)
+
+typedef void (*JobFunc)(void* arg);
+
+// Jobs that are waited for together
+typedef struct {
+    atomic_int pending;
+} JobGroup;
+
+// A unit of work. Lives in the submitter's memory until its group completes.
+typedef struct {
+    JobFunc   func;
+    void*     arg;
+    JobGroup* group;
+} Job;
+
+// Chase-Lev work-stealing deque. The owner pushes and pops at the bottom, other threads
+// steal from the top.
+typedef struct {
+    atomic_int   top;
+    atomic_int   bottom;
+    _Atomic(Job*) slots[JOB_DEQUE_CAPACITY];
+} JobDeque;
+
+typedef struct JobSystem JobSystem;
+
+// Per-thread state handed to a worker
+typedef struct {
+    JobSystem* system;
+    u32        index;   // Deque owned by this thread
+} JobWorker;
+
+struct JobSystem {
+    u32         workerCount;
+    Thread      threads[JOB_MAX_WORKERS];
+    JobWorker   workers[JOB_MAX_WORKERS];
+    JobDeque    deques[JOB_MAX_WORKERS + 1];  // deques[0] belongs to the owner thread
+    LightEvent  wake;                         // Set while there may be work to steal
+    atomic_bool quit;
+};
+
+// Creates a job system owned by the calling thread, with up to 'maxWorkers' threads pinned to the other cores.
+JobSystem* jobSystemCreate(u32 maxWorkers);
+
+// Stops the workers. Every submitted group must have been waited for.
+void jobSystemDestroy(JobSystem* system);
+
+// Queues a job (owner thread only). Runs it right away if the deque is full.
+void jobSubmit(JobSystem* system, Job* job);
+
+// Runs and steals jobs on the owner thread until every job of 'group' has finished.
+void jobWait(JobSystem* system, JobGroup* group);
+
+#endif // JOBS_H
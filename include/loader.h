@@ -0,0 +1,70 @@
+#ifndef LOADER_H
+#define LOADER_H
+
+#include <stdatomic.h>
+#include <3ds.h>
+#include "texture.h"
+#include "spsc.h"
+#include "jobs.h"
+#include "bundle.h"
+
+// Stack size of the loader thread; lodepng keeps its state on the heap
+#define LOADER_STACK_SIZE (32 * 1024)
+
+// Requests that can be in flight at once
+#define LOADER_MAX_PENDING SPSC_QUEUE_CAPACITY
+
+// Covers decoded in parallel before their results are handed back
+#define LOADER_BATCH_SIZE (JOB_MAX_WORKERS + 1)
+
+// One cover to load. Allocated by loaderRequest, passed to the loader thread and back.
+typedef struct {
+    int            id;            // Caller's key
+    Bundle*        bundle;        // Searched for the cover first; NULL to skip
+    char           etcPath[128];  // Pre-compressed cover, tried first; empty to skip
+    char           pngPath[128];  // PNG loaded through the texture cache otherwise
+    TextureOptions options;
+    IOPriority     priority;      // Class of the bundle reads
+    atomic_bool    cancel;        // Set by loaderCancel; the job or its queued reads are skipped if not started
+    bool           skipped;       // The loader thread skipped the job because it was cancelled
+    bool           loaded;
+    TextureData    data;          // Tiled texels in heap memory, filled by the loader thread
+} LoaderJob;
+
+// A finished load handed back to the main thread
+typedef struct {
+    int         id;
+    bool        loaded;     // false if neither file could be read
+    bool        cancelled;  // Skipped after loaderCancel; nothing was loaded
+    TextureData data;       // Owned by the caller; release with freeTextureData
+} LoaderResult;
+
+// Background thread that decodes cover art while the main thread keeps drawing
+typedef struct {
+    Thread      thread;
+    LightEvent  wake;      // Signalled when a request is queued or on shutdown
+    atomic_bool quit;
+    SPSCQueue   requests;  // Main thread -> loader thread
+    SPSCQueue   results;   // Loader thread -> main thread
+    u32         pending;   // Requests not yet returned by loaderPoll (main thread only)
+    LoaderJob*  inflight[LOADER_MAX_PENDING]; // Those requests, for loaderCancel (main thread only)
+    atomic_uint workers;   // Job system workers helping the loader thread, once it has started
+} Loader;
+
+// Starts the loader thread at a lower priority than the caller. Returns NULL on failure.
+Loader* loaderCreate(void);
+
+// Stops the loader thread and releases every queued request and result.
+void loaderDestroy(Loader* loader);
+
+// Queues a cover for loading, its reads at 'priority'. Returns false if LOADER_MAX_PENDING requests are in flight.
+bool loaderRequest(Loader* loader, int id, Bundle* bundle, const char* etcPath, const char* pngPath,
+                   const TextureOptions* options, IOPriority priority);
+
+// Asks the loader to skip the request for 'id' if it has not started. Its result still arrives, marked cancelled.
+bool loaderCancel(Loader* loader, int id);
+
+// Takes one finished load, if any. Never blocks.
+bool loaderPoll(Loader* loader, LoaderResult* result);
+
+#endif // LOADER_H
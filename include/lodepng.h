@@ -789,6 +789,45 @@ unsigned lodepng_decode(unsigned char** out, unsigned* w, unsigned* h,
                         LodePNGState* state,
                         const unsigned char* in, size_t insize);
 
+/*
+Receives finished rows from lodepng_decode_rows: 'rows' holds 'count' consecutive rows of
+'w' pixels in the color type of state->info_raw, the first one being row 'y'. The rows are
+only valid during the call. Return 0 to continue, or an error code to abort decoding.
+*/
+typedef unsigned (*LodePNGRowCallback)(void* user, const unsigned char* rows,
+                                       unsigned y, unsigned count, unsigned w);
+
+/*
+Same as lodepng_decode, but instead of returning the whole image, hands finished rows
+(unfiltered and color converted) to 'callback' in groups of 'rows_per_call', top to bottom.
+The inflated data is consumed while it is being inflated, so only a small window of it is
+held in memory and the full image is never built. A PNG whose image data is in a single
+IDAT chunk is read in place. Interlaced images, and decoders with a custom zlib or inflate,
+are decoded whole and then delivered the same way.
+*/
+unsigned lodepng_decode_rows(unsigned* w, unsigned* h,
+                             LodePNGState* state,
+                             const unsigned char* in, size_t insize,
+                             unsigned rows_per_call, LodePNGRowCallback callback, void* user);
+
+/*
+Incremental form of lodepng_decode_rows, for decoding a PNG a little at a time, e.g. spread
+over several frames. lodepng_row_decoder_new reads the header and chunks and returns the
+decoder, or NULL with state->error set. Each lodepng_row_decoder_step then inflates about
+'budget' more bytes of image data (a deflate block header or symbol is never split) and hands
+the rows that became complete to the callback; *done becomes 1 once every row was delivered.
+'in' and 'state' must stay valid until lodepng_row_decoder_free. Interlaced images, and
+decoders with a custom zlib or inflate, are decoded whole by lodepng_row_decoder_new and
+each step then delivers about 'budget' bytes of rows.
+*/
+typedef struct LodePNGRowDecoder LodePNGRowDecoder;
+LodePNGRowDecoder* lodepng_row_decoder_new(unsigned* w, unsigned* h,
+                                           LodePNGState* state,
+                                           const unsigned char* in, size_t insize,
+                                           unsigned rows_per_call, LodePNGRowCallback callback, void* user);
+unsigned lodepng_row_decoder_step(LodePNGRowDecoder* decoder, size_t budget, unsigned* done);
+void lodepng_row_decoder_free(LodePNGRowDecoder* decoder);
+
 /*
 Read the PNG header, but not the actual data. This returns only the information
 that is in the IHDR chunk of the PNG, such as width, height and color type. The
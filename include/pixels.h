@@ -0,0 +1,34 @@
+#ifndef PIXELS_H
+#define PIXELS_H
+
+#include <3ds.h>
+#include "lodepng.h"
+
+// Layouts of decoded PNG rows the conversion kernels read, all 8 bits per sample
+typedef enum {
+    PIXELS_RGB8,
+    PIXELS_RGBA8,
+    PIXELS_GRAY8,
+    PIXELS_GRAY_ALPHA8,
+    PIXELS_PALETTE8,        // Indices into a lookup table from buildPixelPalette
+    PIXELS_UNSUPPORTED = -1,
+} PixelLayout;
+
+// Byte order of the 32-bit pixels the kernels write
+typedef enum {
+    PIXELS_ABGR, // A,B,G,R in memory: texels of a GPU_RGBA8 texture
+    PIXELS_RGBA, // R,G,B,A in memory: what the 16-bit swizzles read
+} PixelOrder;
+
+// Returns the layout of rows decoded in a PNG's own color mode, or PIXELS_UNSUPPORTED when
+// lodepng has to convert them (16-bit samples, packed sub-byte pixels, a tRNS color key).
+PixelLayout pixelLayoutFor(const LodePNGColorMode* mode);
+
+// Fills the 256-entry lookup table PIXELS_PALETTE8 pixels go through, from a PNG palette.
+void buildPixelPalette(u32* lut, const LodePNGColorMode* mode, PixelOrder order);
+
+// Converts 'count' pixels of 'layout' into 32-bit pixels of 'order' in one pass. 'palette' is
+// only read for PIXELS_PALETTE8.
+void convertPixels(PixelLayout layout, PixelOrder order, void* out, const u8* in, u32 count, const u32* palette);
+
+#endif // PIXELS_H
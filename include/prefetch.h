@@ -0,0 +1,39 @@
+#ifndef PREFETCH_H
+#define PREFETCH_H
+
+#include <3ds.h>
+
+// Frames a cover is first assumed to take from being requested to being resident
+#define PREFETCH_LEAD_FRAMES 8
+
+// Longest lead the prefetcher grows to after covers arrive late
+#define PREFETCH_MAX_LEAD_FRAMES 60
+
+// Carousel speed in px per frame below which it counts as standing still
+#define PREFETCH_MIN_SPEED 0.5f
+
+// Predicts which covers the carousel scrolls into view next, so they can be requested
+// early enough to be resident when they enter the viewport
+typedef struct {
+    float velocity;      // Smoothed carousel movement in px per frame; negative moves covers left
+    int   direction;     // Side new covers enter from: 1 right, -1 left, 0 while standing still
+    int   lastDirection; // Last nonzero direction, to notice a reversal after a pause
+    u32   leadFrames;    // Frames ahead of the viewport edge covers are requested
+    u32   hits;          // Covers that were resident when they entered the viewport
+    u32   misses;        // Covers that entered the viewport still loading
+    u32   reversals;     // Scroll direction changes, each cancelling the queued prefetches
+} Prefetcher;
+
+// Starts standing still with a lead of PREFETCH_LEAD_FRAMES.
+void prefetchInit(Prefetcher* prefetcher);
+
+// Feeds the carousel movement of the last frame in px. Returns true when the scroll direction reversed.
+bool prefetchObserve(Prefetcher* prefetcher, float dx);
+
+// Whether a cover 'distance' px outside the viewport on 'side' (1 right, -1 left) should be loaded now.
+bool prefetchWanted(const Prefetcher* prefetcher, float distance, int side);
+
+// Counts a cover entering the viewport; a miss lengthens the lead.
+void prefetchRecord(Prefetcher* prefetcher, bool resident);
+
+#endif // PREFETCH_H
@@ -0,0 +1,96 @@
+#ifndef RESIDENCY_H
+#define RESIDENCY_H
+
+#include <3ds.h>
+#include <citro2d.h>
+#include "texture.h"
+#include "atlas.h"
+#include "loader.h"
+#include "bundle.h"
+
+// Covers that can be tracked at once (resident, loading or recently seen)
+#define RESIDENCY_MAX_ENTRIES 256
+
+// Finished loads moved into textures per residencyUpdate, so a burst never stalls a frame
+#define RESIDENCY_UPLOADS_PER_UPDATE 2
+
+// Fills in the files a cover is loaded from. 't3xPath' and 'etcPath' may be left empty.
+typedef void (*ResidencyPaths)(int id, char* t3xPath, char* etcPath, char* pngPath, size_t size);
+
+typedef struct {
+    int       id;           // Caller's key, -1 if the slot is unused
+    C2D_Image image;        // Empty while the cover is not resident
+    bool      opaque;       // The art has no transparent pixels, so it can be drawn without blending
+    int       texture;      // Shared texture the image samples, valid while it is resident
+    bool      loading;      // A request is with the loader, or waits for its time slice
+    u64       hash;         // Content hash of the cover's art once loaded, 0 before
+    u32       lastWanted;   // Last update that asked for this cover
+} ResidentTexture;
+
+// Texture shared by every resident cover whose art has the same content hash, so covers
+// with identical art (regional variants, placeholders) are loaded and stored once
+typedef struct {
+    u64       hash;         // hash64 of the source art, 0 if unknown (then never shared)
+    u32       refs;         // Covers sampling the texture, 0 if the slot is unused
+    C2D_Image image;
+    bool      packed;       // The image samples the atlas rather than its own texture
+    ImageOpacity opacity;   // How the art uses alpha
+    size_t    bytes;        // Texture memory held by the image
+    u32       lastWanted;   // Last update that asked for any of its covers
+} SharedTexture;
+
+// Cover decoded a slice of time per update when there is no loader
+typedef struct {
+    int            id;             // Cover being decoded, -1 if none
+    PNGDecode*           decode;
+    const unsigned char* png;      // PNG being decoded, needed until the decode ends
+    size_t               pngSize;
+    u64                  hash;     // hash64 of png
+    bool                 bundled;  // png came from the bundle rather than the file at pngPath
+    TextureData          data;
+    char                 pngPath[160]; // PNG file, or bundleAssetName of a bundled PNG
+} ResidencySlice;
+
+typedef struct {
+    size_t          budget;      // Bytes of cover textures kept in all, wanted ones included
+    size_t          used;        // Bytes held by shared textures, each counted once
+    size_t          peak;
+    u32             update;      // Counts residencyUpdate calls
+    u32             loads;       // Covers made resident
+    u32             shared;      // Covers made resident with the texture of identical art
+    u32             evictions;   // Covers dropped to stay within the budget
+    u32             cancelled;   // Loads cancelled by residencyCancel
+    u32             changes;     // Covers made resident or dropped; unchanged while every residencyGet result is
+    TextureOptions  options;
+    ResidencyPaths  paths;
+    Atlas*          atlas;
+    Loader*         loader;
+    Bundle*         bundle;
+    u32             timeSlice;   // Microseconds per update for decoding covers without a loader, 0 loads them at once
+    ResidencySlice  slice;
+    ResidentTexture entries[RESIDENCY_MAX_ENTRIES];
+    SharedTexture   textures[RESIDENCY_MAX_ENTRIES]; // Indexed by ResidentTexture.texture, also the atlas ids
+} Residency;
+
+// Creates a residency manager. 'atlas', 'loader' and 'bundle' may be NULL (own textures / loads on
+// the calling thread / loose files only).
+Residency* residencyCreate(size_t budget, Atlas* atlas, Loader* loader, Bundle* bundle, ResidencyPaths paths,
+                           const TextureOptions* options);
+
+// Releases every resident cover and the manager itself. Destroy the loader first.
+void residencyDestroy(Residency* residency);
+
+// Makes the wanted covers (most important first) resident and evicts the least recently wanted ones over budget.
+// The last 'prefetched' of them are read after the rest.
+void residencyUpdate(Residency* residency, const int* wanted, int count, int prefetched);
+
+// Cancels queued loads of covers the last update did not want, e.g. when the scroll direction reverses.
+void residencyCancel(Residency* residency);
+
+// Returns the cover stored under 'id', or an empty image if it is not resident.
+C2D_Image residencyGet(const Residency* residency, int id);
+
+// Tells whether the cover stored under 'id' is resident and fully opaque, so it can be drawn with blending off.
+bool residencyOpaque(const Residency* residency, int id);
+
+#endif // RESIDENCY_H
@@ -0,0 +1,28 @@
+#ifndef SPSC_H
+#define SPSC_H
+
+#include <stdatomic.h>
+#include <3ds.h>
+
+// Slots in a queue; a power of two so indices wrap with a mask
+#define SPSC_QUEUE_CAPACITY 64
+
+// Lock-free queue of pointers between exactly one producer and one consumer thread.
+// Each index is only written by its own side, so no locks or atomic read-modify-write
+// instructions are needed.
+typedef struct {
+    _Atomic u32 head;                       // Next slot to pop, written by the consumer
+    _Atomic u32 tail;                       // Next slot to push, written by the producer
+    void*       slots[SPSC_QUEUE_CAPACITY];
+} SPSCQueue;
+
+// Empties the queue. Not thread safe; call before either side starts using it.
+void spscInit(SPSCQueue* queue);
+
+// Appends an item (producer only). Returns false if the queue is full.
+bool spscPush(SPSCQueue* queue, void* item);
+
+// Removes the oldest item (consumer only). Returns NULL if the queue is empty.
+void* spscPop(SPSCQueue* queue);
+
+#endif // SPSC_H
@@ -0,0 +1,68 @@
+#ifndef TEXCACHE_H
+#define TEXCACHE_H
+
+#include <3ds.h>
+#include <citro2d.h>
+#include "texture.h"
+
+// Directory that holds converted textures, relative to the launcher like images/
+#define TEXTURE_CACHE_DIR "cache"
+
+#define TEXTURE_CACHE_MAGIC   "STXC"
+#define TEXTURE_CACHE_VERSION 2
+
+// Header of a cache entry. The tiled texture data follows it and is read straight into
+// the texture. The sub-texture is derived from the image and texture dimensions.
+typedef struct {
+    char magic[4];        // TEXTURE_CACHE_MAGIC
+    u8   version;         // TEXTURE_CACHE_VERSION
+    u8   format;          // GPU_TEXCOLOR of the texture data
+    u8   requestedFormat; // TextureOptions the entry was built with
+    u8   dither;
+    u16  width;           // Image size in pixels
+    u16  height;
+    u16  textureWidth;    // Texture size in texels
+    u16  textureHeight;
+    u32  dataSize;        // Bytes of texture data following the header
+    u8   opacity;         // ImageOpacity of the source image
+    u8   reserved[3];
+    u64  sourceSize;      // Size, modification time and hash of the PNG the entry was built from
+    s64  sourceMtime;
+    u64  sourceHash;
+} TextureCacheHeader;
+
+// Directory used for cache entries; defaults to TEXTURE_CACHE_DIR.
+extern const char* textureCacheDirectory;
+
+// Loads a PNG through the texture cache using defaultTextureOptions.
+C2D_Image convertPNGToC2DImageCached(const char* filename);
+
+// Loads a PNG through the texture cache. Falls back to decoding (and refreshes the entry) when the source changed.
+C2D_Image convertPNGToC2DImageCachedWithOptions(const char* filename, const TextureOptions* options);
+
+// Loads a PNG through the texture cache into memory from 'allocate'; usable off the GPU thread.
+bool loadPNGCached(const char* filename, const TextureOptions* options, TextureData* data,
+                   TextureAllocator allocate, void* context);
+
+// Reads a current cache entry for a PNG; never decodes. Returns false on a miss.
+bool loadPNGCacheEntry(const char* filename, const TextureOptions* options, TextureData* data,
+                       TextureAllocator allocate, void* context);
+
+// Writes the cache entry for a texture decoded from 'png', the contents of 'filename'.
+void storePNGCacheEntry(const char* filename, const TextureOptions* options, const TextureData* data,
+                        const unsigned char* png, size_t pngsize);
+
+// Loads a PNG held in memory through the texture cache, keyed by 'name' and validated by the data's hash.
+bool loadPNGBufferCached(const char* name, const unsigned char* png, size_t pngsize, const TextureOptions* options,
+                         TextureData* data, TextureAllocator allocate, void* context);
+
+// Reads a current cache entry for a PNG held in memory; never decodes. Returns false on a miss.
+bool loadPNGBufferCacheEntry(const char* name, const unsigned char* png, size_t pngsize,
+                             const TextureOptions* options, TextureData* data, TextureAllocator allocate,
+                             void* context);
+
+// Writes the cache entry under 'name' for a texture decoded from a PNG held in memory.
+void storePNGBufferCacheEntry(const char* name, const TextureOptions* options, const TextureData* data,
+                              const unsigned char* png, size_t pngsize);
+
+#endif // TEXCACHE_H
@@ -0,0 +1,150 @@
+#ifndef TEXTURE_H
+#define TEXTURE_H
+
+#include <3ds.h>
+#include <citro2d.h>
+
+// Smallest and largest texture dimension the GPU can sample
+#define MIN_TEXTURE_SIZE 8
+#define MAX_TEXTURE_SIZE 1024
+
+// Lets the loader pick a 16-bit format from the image's alpha channel
+#define TEXTURE_FORMAT_AUTO ((GPU_TEXCOLOR)0xFF)
+
+// How the PNG loader stores decoded art
+typedef struct {
+    GPU_TEXCOLOR format; // GPU_RGBA8, GPU_RGB565, GPU_RGBA5551, GPU_RGBA4 or TEXTURE_FORMAT_AUTO
+    bool         dither; // Ordered dithering when reducing to a 16-bit format
+} TextureOptions;
+
+// How an image uses its alpha channel, from least to most blending needed
+typedef enum {
+    IMAGE_OPACITY_UNKNOWN, // Not classified; drawn as if translucent
+    IMAGE_OPAQUE,       // Every pixel has alpha 255
+    IMAGE_BINARY_ALPHA, // Alpha is only 0 or 255
+    IMAGE_TRANSLUCENT,  // Alpha has intermediate values
+} ImageOpacity;
+
+// Tiled texel data and the texture it belongs to, independent of the GPU
+typedef struct {
+    GPU_TEXCOLOR format;
+    u16          width;         // Image size in pixels
+    u16          height;
+    u16          textureWidth;  // Texture size in texels
+    u16          textureHeight;
+    size_t       size;          // Bytes of texel data
+    void*        data;          // Tiled texel data
+    u64          sourceHash;    // hash64 of the art the texels came from, 0 if unknown
+    ImageOpacity opacity;       // How the art uses alpha; opaque art can be drawn without blending
+} TextureData;
+
+// Inflated bytes a PNGDecode step handles before it looks at the clock again
+#define PNG_DECODE_STEP_BYTES 1024
+
+// Outcome of advancePNGDecode
+typedef enum {
+    PNG_DECODE_PENDING, // More work remains
+    PNG_DECODE_DONE,    // The texture is complete
+    PNG_DECODE_FAILED,  // The PNG could not be decoded; data may still hold allocated memory
+} PNGDecodeStatus;
+
+// A PNG decode that is advanced a slice of time at a time, see beginPNGDecode
+typedef struct PNGDecode PNGDecode;
+
+// Provides the memory a loader writes texels into, once the texture's format and size are
+// known. Returns NULL to abort the load. When TEXTURE_FORMAT_AUTO has to look at the pixels,
+// the format is a first guess among the 16-bit formats, which all take the same memory; the
+// final one is in data->format once the decode is done.
+typedef void* (*TextureAllocator)(const TextureData* data, void* context);
+
+// Options used by convertPNGToC2DImage and convertPNGBufferToC2DImage, and for the cover art in main.c.
+extern TextureOptions defaultTextureOptions;
+
+// Calculates the byte offset of pixel (x, y) inside a 512x512 RGBA8 tiled texture.
+u32 calculateTexturePosition(u32 x, u32 y);
+
+// Returns the size of one texel of 'format' in bits.
+u32 textureFormatBits(GPU_TEXCOLOR format);
+
+// Returns the smallest legal power-of-two texture dimension that holds 'size' pixels.
+u32 textureSizeFor(u32 size);
+
+// Copies an RGBA image into the tiled layout of an RGBA8 texture, clipping to the texture size.
+void swizzleRGBA8(void* texture, u32 textureWidth, u32 textureHeight, const u8* rgba, u32 width, u32 height);
+
+// Same tile walk as swizzleRGBA8 for texels already in the GPU's A,B,G,R byte order (see pixels.h).
+void swizzleABGR8(void* texture, u32 textureWidth, u32 textureHeight, const u32* abgr, u32 width, u32 height);
+
+// Same tile walk as swizzleRGBA8, packing to a 16-bit format with optional 4x4 ordered dithering.
+void swizzleRGB565(void* texture, u32 textureWidth, u32 textureHeight, const u8* rgba, u32 width, u32 height, bool dither);
+void swizzleRGBA5551(void* texture, u32 textureWidth, u32 textureHeight, const u8* rgba, u32 width, u32 height, bool dither);
+void swizzleRGBA4(void* texture, u32 textureWidth, u32 textureHeight, const u8* rgba, u32 width, u32 height, bool dither);
+
+// Swizzles an RGBA image into a texture of 'format' (GPU_RGBA8 or one of the 16-bit formats above).
+void swizzleToFormat(GPU_TEXCOLOR format, void* texture, u32 textureWidth, u32 textureHeight, const u8* rgba,
+                     u32 width, u32 height, bool dither);
+
+// Classifies the alpha channel of an RGBA image.
+ImageOpacity imageOpacity(const u8* rgba, u32 width, u32 height);
+
+// Classifies a PNG from its color type and tRNS chunk, without decoding it. IMAGE_OPACITY_UNKNOWN
+// when that takes a look at the pixels (an alpha channel) or the PNG is invalid.
+ImageOpacity pngOpacity(const unsigned char* png, size_t pngsize);
+
+// Returns the opacity every texture of 'format' has: opaque for formats without alpha.
+ImageOpacity formatOpacity(GPU_TEXCOLOR format);
+
+// Resolves TEXTURE_FORMAT_AUTO for an image of known opacity; other formats are returned unchanged.
+GPU_TEXCOLOR textureFormatFor(GPU_TEXCOLOR requested, ImageOpacity opacity);
+
+// Resolves TEXTURE_FORMAT_AUTO against the image's alpha channel; other formats are returned unchanged.
+GPU_TEXCOLOR chooseTextureFormat(GPU_TEXCOLOR requested, const u8* rgba, u32 width, u32 height);
+
+// Allocates a texture and sub-texture for a width x height image; the texture data is left unset.
+bool createC2DImage(C2D_Image* img, u32 width, u32 height, u32 textureWidth, u32 textureHeight, GPU_TEXCOLOR format);
+
+// TextureAllocator that creates the C2D_Image pointed to by 'context' (GPU thread only).
+void* allocateC2DImageTexture(const TextureData* data, void* context);
+
+// Gives a texture from allocateC2DImageTexture the format the decode settled on and flushes it.
+void finishC2DImageTexture(C2D_Image* img, const TextureData* data);
+
+// TextureAllocator that uses heap memory; safe on any thread. Release with freeTextureData.
+void* allocateTextureData(const TextureData* data, void* context);
+
+// Decodes a PNG into tiled texels written to memory from 'allocate'.
+bool decodePNGToTexture(const unsigned char* png, size_t pngsize, const TextureOptions* options,
+                        TextureData* data, TextureAllocator allocate, void* context);
+
+// Starts decoding a PNG into texture memory from 'allocate' without doing any decoding work yet.
+PNGDecode* beginPNGDecode(const unsigned char* png, size_t pngsize, const TextureOptions* options,
+                          TextureData* data, TextureAllocator allocate, void* context);
+
+// Continues a decode for about 'budgetUs' microseconds.
+PNGDecodeStatus advancePNGDecode(PNGDecode* decode, u32 budgetUs);
+
+// Releases a decode, finished or not. The texture data is left to the caller.
+void endPNGDecode(PNGDecode* decode);
+
+// Creates a C2D_Image holding a copy of heap texture data (GPU thread only).
+C2D_Image uploadTextureData(const TextureData* data);
+
+// Releases texture data obtained from allocateTextureData.
+void freeTextureData(TextureData* data);
+
+// Reads a .t3x texture baked by tex3ds into memory from an allocator (GPU thread only). False if the file is missing.
+bool loadT3XTexture(const char* filename, TextureData* data, TextureAllocator allocate, void* context);
+
+// Loads the PNG at 'filename' and converts it into a GPU texture. Returns an empty image on error.
+C2D_Image convertPNGToC2DImage(const char* filename);
+
+// Same as convertPNGToC2DImage, but decodes a PNG that is already in memory.
+C2D_Image convertPNGBufferToC2DImage(const unsigned char* png, size_t pngsize);
+
+// Same as convertPNGBufferToC2DImage, with an explicit texture format and dithering choice.
+C2D_Image convertPNGBufferToC2DImageWithOptions(const unsigned char* png, size_t pngsize, const TextureOptions* options);
+
+// Releases the texture owned by an image returned by one of the converters above.
+void freeC2DImage(C2D_Image* image);
+
+#endif // TEXTURE_H
@@ -0,0 +1,34 @@
+#ifndef TILEDIMAGE_H
+#define TILEDIMAGE_H
+
+#include <3ds.h>
+#include <citro2d.h>
+#include "texture.h"
+
+// Side of a full tile in pixels; tiles on the right and bottom edges hold the remainder
+#define TILED_IMAGE_TILE_SIZE MAX_TEXTURE_SIZE
+
+// Image of any size, stored as a grid of textures and drawn as one
+typedef struct {
+    u32          width;    // Image size in pixels
+    u32          height;
+    u16          columns;  // Grid of tiles
+    u16          rows;
+    GPU_TEXCOLOR format;   // Format of every tile
+    ImageOpacity opacity;  // How the art uses alpha
+    C2D_Image*   tiles;    // columns x rows, row by row; tile (c, r) starts at pixel (c, r) * TILED_IMAGE_TILE_SIZE
+} TiledImage;
+
+// Decodes a PNG of any size into a grid of textures, filling the tiles as rows are decoded.
+bool loadTiledImage(TiledImage* image, const unsigned char* png, size_t pngsize, const TextureOptions* options);
+
+// Same as loadTiledImage for the PNG at 'filename'.
+bool loadTiledImageFile(TiledImage* image, const char* filename, const TextureOptions* options);
+
+// Draws every tile so the grid appears as one image with its top-left corner at (x, y).
+void drawTiledImage(const TiledImage* image, float x, float y, float depth, float scaleX, float scaleY);
+
+// Releases the textures of a tiled image.
+void freeTiledImage(TiledImage* image);
+
+#endif // TILEDIMAGE_H
@@ -0,0 +1,469 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "atlas.h"
+
+/*
+    Texture atlas for carousel covers.
+
+    Covers are packed into a few large pages with a skyline packer, so consecutive
+    C2D_DrawImageAt calls keep sampling the same texture and citro2d does not have to
+    flush and rebind between boxes. A page holds covers of one format; an atlas created
+    with TEXTURE_FORMAT_AUTO keeps pages of each format the covers were decoded to, so
+    opaque art stays in GPU_RGB565 next to art with alpha in GPU_RGBA4. Rectangles are kept 8-texel aligned, which lets an
+    already tiled cover be copied in whole tile rows. Removed entries leave holes that
+    are reused guillotine-style; a page that becomes empty is reset completely. Pages are
+    sampled with GPU_NEAREST, as nothing separates neighbouring entries.
+*/
+
+static inline u16 alignToTile(u32 size) {
+    return (u16)((size + 7) & ~7u);
+}
+
+static void atlasResetPage(AtlasPage* page, u16 pageSize) {
+    page->liveCount    = 0;
+    page->skylineCount = 1;
+    page->skyline[0]   = (AtlasSkylineNode){ 0, 0, pageSize };
+    page->freeCount    = 0;
+}
+
+Atlas* atlasCreate (
+/*
+    SYNOPSIS
+        Creates an empty texture atlas.
+
+    DESCRIPTION
+        Pages are allocated lazily, the first one on the first insertion. With a texture
+        format, every page uses it and covers must be converted to it before insertion.
+        With TEXTURE_FORMAT_AUTO covers of any format are accepted and each goes to a
+        page of its own format, so the format chosen per cover is kept.
+
+    EXAMPLE
+        Atlas* atlas = atlasCreate(ATLAS_PAGE_SIZE, TEXTURE_FORMAT_AUTO);
+*/
+    // Side of each page in texels (a power of two up to 1024)
+    u16 pageSize,
+
+    // Format of every page, or TEXTURE_FORMAT_AUTO for pages of each format inserted
+    GPU_TEXCOLOR format
+) {
+    Atlas* atlas = (Atlas*)calloc(1, sizeof(Atlas));
+    if (!atlas) return NULL;
+
+    atlas->pageSize = pageSize;
+    atlas->format   = format;
+    for (int i = 0; i < ATLAS_MAX_ENTRIES; i++) {
+        atlas->entries[i].id = -1;
+    }
+
+    return atlas;
+}
+
+void atlasDestroy (
+/*
+    SYNOPSIS
+        Releases an atlas and all of its pages.
+
+    DESCRIPTION
+        Images handed out by the atlas become invalid.
+*/
+    // Atlas to be released
+    Atlas* atlas
+) {
+    if (!atlas) return;
+
+    for (int i = 0; i < atlas->pageCount; i++) {
+        if (atlas->pages[i].allocated) C3D_TexDelete(&atlas->pages[i].tex);
+    }
+    free(atlas);
+}
+
+static int atlasSkylineFit (
+/*
+    SYNOPSIS
+        Returns the y at which a rectangle fits when its left edge sits on skyline node 'index'.
+
+    DESCRIPTION
+        Returns -1 if the rectangle would leave the page.
+*/
+    // Page to be searched
+    const AtlasPage* page,
+
+    // Side of the page in texels
+    u16 pageSize,
+
+    // Skyline node the rectangle starts on
+    int index,
+
+    // Rectangle size in texels
+    u16 width,
+    u16 height
+) {
+    const AtlasSkylineNode* node = &page->skyline[index];
+    if (node->x + width > pageSize) return -1;
+
+    int y = 0;
+    int remaining = width;
+    for (int i = index; remaining > 0; i++) {
+        if (i >= page->skylineCount) return -1;
+        if (page->skyline[i].y > y) y = page->skyline[i].y;
+        if (y + height > pageSize) return -1;
+        remaining -= page->skyline[i].width;
+    }
+
+    return y;
+}
+
+static bool atlasSkylinePlace (
+/*
+    SYNOPSIS
+        Places a rectangle on a page with the bottom-left skyline heuristic.
+
+    DESCRIPTION
+        Picks the position with the lowest top edge (leftmost on ties), raises the skyline
+        under the rectangle and merges neighbouring nodes of equal height.
+*/
+    // Page to place the rectangle on
+    AtlasPage* page,
+
+    // Side of the page in texels
+    u16 pageSize,
+
+    // Rectangle; its width and height are set, x and y are filled in
+    AtlasRect* rect
+) {
+    int bestIndex = -1;
+    int bestY     = pageSize;
+
+    for (int i = 0; i < page->skylineCount; i++) {
+        const int y = atlasSkylineFit(page, pageSize, i, rect->width, rect->height);
+        if (y >= 0 && y < bestY) {
+            bestY     = y;
+            bestIndex = i;
+        }
+    }
+    if (bestIndex < 0 || page->skylineCount >= ATLAS_MAX_SKYLINE) return false;
+
+    rect->x = page->skyline[bestIndex].x;
+    rect->y = (u16)bestY;
+
+    // Insert the new top edge and shrink or drop the nodes it covers
+    memmove(&page->skyline[bestIndex + 1], &page->skyline[bestIndex],
+            (page->skylineCount - bestIndex) * sizeof(AtlasSkylineNode));
+    page->skyline[bestIndex] = (AtlasSkylineNode){ rect->x, (u16)(rect->y + rect->height), rect->width };
+    page->skylineCount++;
+
+    for (int i = bestIndex + 1; i < page->skylineCount; i++) {
+        AtlasSkylineNode* previous = &page->skyline[i - 1];
+        AtlasSkylineNode* node     = &page->skyline[i];
+        const int overlap = previous->x + previous->width - node->x;
+        if (overlap <= 0) break;
+
+        if (overlap < node->width) {
+            node->x     += overlap;
+            node->width -= overlap;
+            break;
+        }
+
+        memmove(node, node + 1, (page->skylineCount - i - 1) * sizeof(AtlasSkylineNode));
+        page->skylineCount--;
+        i--;
+    }
+
+    for (int i = 0; i + 1 < page->skylineCount; i++) {
+        if (page->skyline[i].y == page->skyline[i + 1].y) {
+            page->skyline[i].width += page->skyline[i + 1].width;
+            memmove(&page->skyline[i + 1], &page->skyline[i + 2],
+                    (page->skylineCount - i - 2) * sizeof(AtlasSkylineNode));
+            page->skylineCount--;
+            i--;
+        }
+    }
+
+    return true;
+}
+
+static void atlasAddFreeRect(AtlasPage* page, AtlasRect rect) {
+    if (rect.width && rect.height && page->freeCount < ATLAS_MAX_FREE) {
+        page->freeRects[page->freeCount++] = rect;
+    }
+}
+
+static bool atlasFreeListPlace (
+/*
+    SYNOPSIS
+        Places a rectangle into the best fitting hole left by removed entries.
+
+    DESCRIPTION
+        Uses the hole with the least leftover area and splits what remains into a right
+        and a bottom hole.
+*/
+    // Page to place the rectangle on
+    AtlasPage* page,
+
+    // Rectangle; its width and height are set, x and y are filled in
+    AtlasRect* rect
+) {
+    int best = -1;
+    u32 bestWaste = UINT32_MAX;
+
+    for (int i = 0; i < page->freeCount; i++) {
+        const AtlasRect* hole = &page->freeRects[i];
+        if (hole->width < rect->width || hole->height < rect->height) continue;
+
+        const u32 waste = (u32)hole->width * hole->height - (u32)rect->width * rect->height;
+        if (waste < bestWaste) {
+            bestWaste = waste;
+            best      = i;
+        }
+    }
+    if (best < 0) return false;
+
+    const AtlasRect hole = page->freeRects[best];
+    page->freeRects[best] = page->freeRects[--page->freeCount];
+
+    rect->x = hole.x;
+    rect->y = hole.y;
+    atlasAddFreeRect(page, (AtlasRect){ (u16)(hole.x + rect->width), hole.y, (u16)(hole.width - rect->width), rect->height });
+    atlasAddFreeRect(page, (AtlasRect){ hole.x, (u16)(hole.y + rect->height), hole.width, (u16)(hole.height - rect->height) });
+
+    return true;
+}
+
+static int atlasAllocate (
+/*
+    SYNOPSIS
+        Finds room for a rectangle, opening a new page if needed. Returns the page index or -1.
+
+    DESCRIPTION
+        Only pages of 'format' are searched. When every page is taken, an empty page of
+        another format is given the new format.
+*/
+    // Atlas to allocate from
+    Atlas* atlas,
+
+    // Format of the entry
+    GPU_TEXCOLOR format,
+
+    // Rectangle; its width and height are set, x and y are filled in
+    AtlasRect* rect
+) {
+    // Holes first so removed covers do not make the atlas grow
+    for (int i = 0; i < atlas->pageCount; i++) {
+        if (atlas->pages[i].tex.fmt == format && atlasFreeListPlace(&atlas->pages[i], rect)) return i;
+    }
+    for (int i = 0; i < atlas->pageCount; i++) {
+        if (atlas->pages[i].tex.fmt == format && atlasSkylinePlace(&atlas->pages[i], atlas->pageSize, rect)) return i;
+    }
+
+    int index = atlas->pageCount;
+    if (index >= ATLAS_MAX_PAGES) {
+        for (index = 0; index < atlas->pageCount && atlas->pages[index].liveCount; index++);
+        if (index == atlas->pageCount) return -1;
+        C3D_TexDelete(&atlas->pages[index].tex);
+        atlas->pages[index].allocated = false;
+    }
+
+    AtlasPage* page = &atlas->pages[index];
+    if (!C3D_TexInit(&page->tex, atlas->pageSize, atlas->pageSize, format)) {
+        printf("error: out of texture memory for atlas page\n");
+        return -1;
+    }
+    // Entries are packed edge to edge without a gutter, so bilinear filtering would blend the
+    // texels of neighbouring covers into each other's edges. Covers are drawn unscaled, where
+    // nearest sampling loses nothing.
+    C3D_TexSetFilter(&page->tex, GPU_NEAREST, GPU_NEAREST);
+    C3D_TexSetWrap(&page->tex, GPU_CLAMP_TO_EDGE, GPU_CLAMP_TO_EDGE);
+    memset(page->tex.data, 0, page->tex.size);
+
+    page->allocated = true;
+    atlasResetPage(page, atlas->pageSize);
+    if (index == atlas->pageCount) atlas->pageCount++;
+
+    return atlasSkylinePlace(page, atlas->pageSize, rect) ? index : -1;
+}
+
+bool atlasInsert (
+/*
+    SYNOPSIS
+        Copies tiled texture data into the atlas.
+
+    DESCRIPTION
+        The data must use the atlas format, or any format for an atlas created with
+        TEXTURE_FORMAT_AUTO, and goes to a page of that format. Its tiles are copied row by row into a free
+        rectangle of a page, and 'image' is set to sample that rectangle. Inserting an id
+        that is already present replaces the old entry. The source is not modified and
+        can be released afterwards.
+
+    EXAMPLE
+        C2D_Image packed;
+        if (atlasInsert(atlas, result.id, &result.data, &packed)) freeTextureData(&result.data);
+*/
+    // Atlas to insert into
+    Atlas* atlas,
+
+    // Caller's key for the entry
+    int id,
+
+    // Tiled cover
+    const TextureData* source,
+
+    // Image sampling the packed copy
+    C2D_Image* image
+) {
+    if (!source->data || (atlas->format != TEXTURE_FORMAT_AUTO && source->format != atlas->format)) return false;
+
+    atlasRemove(atlas, id);
+
+    AtlasEntry* entry = NULL;
+    for (int i = 0; i < ATLAS_MAX_ENTRIES && !entry; i++) {
+        if (atlas->entries[i].id < 0) entry = &atlas->entries[i];
+    }
+    if (!entry) return false;
+
+    const u16 width  = source->width;
+    const u16 height = source->height;
+    AtlasRect rect = { 0, 0, alignToTile(width), alignToTile(height) };
+    if (rect.width > atlas->pageSize || rect.height > atlas->pageSize) return false;
+
+    const int pageIndex = atlasAllocate(atlas, source->format, &rect);
+    if (pageIndex < 0) return false;
+    AtlasPage* page = &atlas->pages[pageIndex];
+
+    // Both textures are tiled the same way, so whole rows of tiles can be copied
+    const u32 tileBytes  = textureFormatBits(source->format) * 8;
+    const u32 rowBytes   = (rect.width >> 3) * tileBytes;
+    const u32 srcStride  = (source->textureWidth >> 3) * tileBytes;
+    const u32 dstStride  = (atlas->pageSize >> 3) * tileBytes;
+    const u8* src        = (const u8*)source->data;
+    u8* dst              = (u8*)page->tex.data + (rect.y >> 3) * dstStride + (rect.x >> 3) * tileBytes;
+
+    for (u32 row = 0; row < (u32)(rect.height >> 3); row++) {
+        memcpy(dst + row * dstStride, src + row * srcStride, rowBytes);
+    }
+    C3D_TexFlush(&page->tex);
+
+    const float size = atlas->pageSize;
+    entry->id     = id;
+    entry->page   = (u8)pageIndex;
+    entry->rect   = rect;
+    entry->subtex = (Tex3DS_SubTexture){
+        width, height,
+        rect.x / size, 1.0f - rect.y / size,
+        (rect.x + width) / size, 1.0f - (rect.y + height) / size
+    };
+    page->liveCount++;
+
+    image->tex    = &page->tex;
+    image->subtex = &entry->subtex;
+    return true;
+}
+
+bool atlasInsertImage (
+/*
+    SYNOPSIS
+        Copies a cover texture into the atlas.
+
+    DESCRIPTION
+        Same as atlasInsert, for a cover that already has its own texture.
+
+    EXAMPLE
+        C2D_Image cover = convertPNGToC2DImageCachedWithOptions("images/game0.png", &options);
+        C2D_Image packed;
+        if (atlasInsertImage(atlas, 0, &cover, &packed)) freeC2DImage(&cover);
+*/
+    // Atlas to insert into
+    Atlas* atlas,
+
+    // Caller's key for the entry
+    int id,
+
+    // Tiled cover
+    const C2D_Image* source,
+
+    // Image sampling the packed copy
+    C2D_Image* image
+) {
+    if (!source->tex) return false;
+
+    const TextureData data = {
+        source->tex->fmt,
+        source->subtex->width, source->subtex->height,
+        source->tex->width, source->tex->height,
+        source->tex->size, source->tex->data
+    };
+    return atlasInsert(atlas, id, &data, image);
+}
+
+void atlasRemove (
+/*
+    SYNOPSIS
+        Evicts an entry from the atlas.
+
+    DESCRIPTION
+        Its rectangle becomes a hole that later insertions can reuse. When the last entry
+        of a page is removed the whole page is reset. Unknown ids are ignored.
+*/
+    // Atlas to remove from
+    Atlas* atlas,
+
+    // Key of the entry
+    int id
+) {
+    for (int i = 0; i < ATLAS_MAX_ENTRIES; i++) {
+        AtlasEntry* entry = &atlas->entries[i];
+        if (entry->id != id) continue;
+
+        AtlasPage* page = &atlas->pages[entry->page];
+        entry->id = -1;
+
+        if (--page->liveCount == 0) {
+            atlasResetPage(page, atlas->pageSize);
+        } else {
+            atlasAddFreeRect(page, entry->rect);
+        }
+        return;
+    }
+}
+
+C2D_Image atlasGet (
+/*
+    SYNOPSIS
+        Looks up an entry of the atlas.
+
+    EXAMPLE
+        C2D_Image image = atlasGet(atlas, boxes[i].UID);
+*/
+    // Atlas to search
+    Atlas* atlas,
+
+    // Key of the entry
+    int id
+) {
+    for (int i = 0; i < ATLAS_MAX_ENTRIES; i++) {
+        AtlasEntry* entry = &atlas->entries[i];
+        if (entry->id == id) {
+            return (C2D_Image){ &atlas->pages[entry->page].tex, &entry->subtex };
+        }
+    }
+
+    return (C2D_Image){0};
+}
+
+float atlasOccupancy (
+/*
+    SYNOPSIS
+        Returns how much of the allocated page area holds live entries.
+*/
+    // Atlas to measure
+    const Atlas* atlas
+) {
+    if (!atlas->pageCount) return 0.0f;
+
+    u32 used = 0;
+    for (int i = 0; i < ATLAS_MAX_ENTRIES; i++) {
+        if (atlas->entries[i].id >= 0) used += (u32)atlas->entries[i].rect.width * atlas->entries[i].rect.height;
+    }
+
+    return (float)used / ((float)atlas->pageSize * atlas->pageSize * atlas->pageCount);
+}
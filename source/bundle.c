@@ -0,0 +1,469 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#include "etc1.h"
+#include "texcache.h"
+#include "bundle.h"
+
+static size_t bundleAlign(size_t size) {
+    return (size + BUNDLE_ALIGNMENT - 1) & ~(size_t)(BUNDLE_ALIGNMENT - 1);
+}
+
+static int bundleEntryCompare(const void* a, const void* b) {
+    const BundleEntry* x = a;
+    const BundleEntry* y = b;
+    if (x->id != y->id) return x->id < y->id ? -1 : 1;
+    if (x->type != y->type) return x->type < y->type ? -1 : 1;
+    return 0;
+}
+
+static bool bundleIndexValid (
+/*
+    SYNOPSIS
+        Checks that the index is sorted and every payload lies inside the bundle.
+*/
+    // Bundle whose index has been read
+    const Bundle* bundle,
+
+    // Size of the bundle file in bytes
+    size_t size
+) {
+    for (u32 i = 0; i < bundle->count; i++) {
+        const BundleEntry* entry = &bundle->entries[i];
+        if (entry->offset % BUNDLE_ALIGNMENT || entry->offset > size || entry->size > size - entry->offset) {
+            return false;
+        }
+        if (i > 0 && bundleEntryCompare(&bundle->entries[i - 1], entry) >= 0) return false;
+    }
+    return true;
+}
+
+#ifdef __linux__
+static bool bundleMap (
+/*
+    SYNOPSIS
+        Maps the whole bundle into memory.
+
+    DESCRIPTION
+        Payloads are then handed out as pointers into the mapping, with no copy and no
+        read until a page is touched.
+*/
+    // Bundle to map
+    Bundle* bundle
+) {
+    int fd = open(bundle->path, O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat info;
+    void* mapped = MAP_FAILED;
+    if (!fstat(fd, &info) && info.st_size > 0) {
+        mapped = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (mapped == MAP_FAILED) return false;
+
+    bundle->mapped     = mapped;
+    bundle->mappedSize = (size_t)info.st_size;
+    return true;
+}
+
+static void bundleUnmap(Bundle* bundle) {
+    munmap(bundle->mapped, bundle->mappedSize);
+}
+#else
+static bool bundleMap(Bundle* bundle) { (void)bundle; return false; }
+static void bundleUnmap(Bundle* bundle) { (void)bundle; }
+#endif
+
+static bool bundleRead (
+/*
+    SYNOPSIS
+        Reads a range of the bundle file.
+
+    DESCRIPTION
+        Goes through the I/O queue when the bundle has one, so the read is scheduled by
+        its priority and merged with reads of the neighbouring payloads. Otherwise it is a
+        seek and read of the unbuffered file under the bundle's lock. Returns false if
+        fewer than 'minimum' bytes could be read or the read was cancelled.
+*/
+    // Bundle to read, not mapped
+    Bundle* bundle,
+
+    // Start of the range
+    u64 offset,
+
+    // Receives the bytes
+    void* buffer,
+
+    // Bytes to read
+    size_t size,
+
+    // Bytes that have to be read for the read to succeed
+    size_t minimum,
+
+    // Class of the read on the I/O queue
+    IOPriority priority,
+
+    // Drops the read if set before it starts, may be NULL
+    const atomic_bool* cancel
+) {
+    if (bundle->queue) {
+        IORequest request = {0};
+        request.file     = &bundle->io;
+        request.offset   = offset;
+        request.size     = (u32)size;
+        request.buffer   = buffer;
+        request.priority = priority;
+        request.cancel   = cancel;
+        ioSubmit(bundle->queue, &request);
+        return ioWait(&request) == IO_DONE && request.read >= minimum;
+    }
+
+    if (cancel && atomic_load(cancel)) return false;
+
+    LightLock_Lock(&bundle->lock);
+    const bool read = !fseek(bundle->file, (long)offset, SEEK_SET) && fread(buffer, 1, size, bundle->file) >= minimum;
+    LightLock_Unlock(&bundle->lock);
+    return read;
+}
+
+Bundle* bundleOpen (
+/*
+    SYNOPSIS
+        Opens a bundle of cover art and reads its index.
+
+    DESCRIPTION
+        The header and the whole index are read once, so finding an asset later touches no
+        file at all. Without a mapping, payloads are fetched with a single read starting on
+        an aligned offset: through 'queue' when given, which opens the file with the file
+        system service, or else from the file opened unbuffered, so no stdio buffer copy or
+        small reads are involved.
+
+    EXAMPLE
+        Bundle* bundle = bundleOpen(COVER_BUNDLE_PATH, true, io);
+        if (!bundle) // fall back to the loose images
+*/
+    // Path of the bundle file
+    const char* path,
+
+    // Map the bundle into memory where supported
+    bool map,
+
+    // I/O queue that serves the reads when the bundle is not mapped, may be NULL
+    IOQueue* queue
+) {
+    Bundle* bundle = calloc(1, sizeof(Bundle));
+    if (!bundle) return NULL;
+
+    snprintf(bundle->path, sizeof(bundle->path), "%s", path);
+    LightLock_Init(&bundle->lock);
+
+    BundleHeader header;
+    size_t size = 0;
+    bool valid = false;
+
+    if (map && bundleMap(bundle)) {
+        size = bundle->mappedSize;
+        if (size >= sizeof(header)) {
+            memcpy(&header, bundle->mapped, sizeof(header));
+            valid = true;
+        }
+    } else {
+        if (queue && ioOpen(&bundle->io, path)) {
+            bundle->queue = queue;
+            size = (size_t)bundle->io.size;
+        } else if ((bundle->file = fopen(path, "rb"))) {
+            setvbuf(bundle->file, NULL, _IONBF, 0);
+            fseek(bundle->file, 0, SEEK_END);
+            size = (size_t)ftell(bundle->file);
+        }
+        valid = (bundle->queue || bundle->file) &&
+                bundleRead(bundle, 0, &header, sizeof(header), sizeof(header), IO_PRIORITY_VISIBLE, NULL);
+    }
+
+    valid = valid && !memcmp(header.magic, BUNDLE_MAGIC, 4) && header.version == BUNDLE_VERSION &&
+            header.alignment == BUNDLE_ALIGNMENT &&
+            header.count <= (size - sizeof(header)) / sizeof(BundleEntry);
+
+    if (valid) {
+        const size_t indexSize = (size_t)header.count * sizeof(BundleEntry);
+        bundle->count   = header.count;
+        bundle->entries = malloc(indexSize + 1);
+        if (!bundle->entries) {
+            valid = false;
+        } else if (bundle->mapped) {
+            memcpy(bundle->entries, bundle->mapped + sizeof(header), indexSize);
+        } else {
+            valid = bundleRead(bundle, sizeof(header), bundle->entries, indexSize, indexSize, IO_PRIORITY_VISIBLE,
+                               NULL);
+        }
+        valid = valid && bundleIndexValid(bundle, size);
+    }
+
+    if (!valid) {
+        if (bundle->mapped || bundle->file || bundle->queue) printf("error: invalid bundle %s\n", path);
+        bundleClose(bundle);
+        return NULL;
+    }
+
+    return bundle;
+}
+
+void bundleClose (
+/*
+    SYNOPSIS
+        Closes a bundle. Payloads still acquired from it become invalid.
+*/
+    // Bundle to close, may be NULL
+    Bundle* bundle
+) {
+    if (!bundle) return;
+
+    if (bundle->mapped) bundleUnmap(bundle);
+    if (bundle->file) fclose(bundle->file);
+    if (bundle->queue) ioClose(&bundle->io);
+    free(bundle->entries);
+    free(bundle);
+}
+
+const BundleEntry* bundleFind (
+/*
+    SYNOPSIS
+        Looks up an asset in the index.
+
+    DESCRIPTION
+        Binary search over the index, which is sorted by id and then type.
+
+    EXAMPLE
+        const BundleEntry* entry = bundleFind(bundle, 3, BUNDLE_PNG);
+*/
+    // Bundle to search
+    const Bundle* bundle,
+
+    // Cover UID
+    u32 id,
+
+    // Kind of asset
+    BundleAssetType type
+) {
+    const BundleEntry key = { id, (u32)type, 0, 0 };
+    return bsearch(&key, bundle->entries, bundle->count, sizeof(BundleEntry), bundleEntryCompare);
+}
+
+const u8* bundleAcquire (
+/*
+    SYNOPSIS
+        Provides the payload of an asset.
+
+    DESCRIPTION
+        A mapped bundle returns a pointer into the mapping. Otherwise the payload is read
+        into a new buffer with one read from its aligned offset, rounded up to whole
+        alignment units (the padding after each payload is part of the file). On the I/O
+        queue the read waits its turn by 'priority' and adjacent payloads requested at the
+        same time are read together; without one it is done under the bundle's lock. Either
+        way loader threads can share the bundle. Returns NULL if the read fails or was
+        cancelled through 'cancel'.
+
+    EXAMPLE
+        const u8* png = bundleAcquire(bundle, entry, IO_PRIORITY_VISIBLE, NULL);
+        // decode entry->size bytes
+        bundleRelease(bundle, png);
+*/
+    // Bundle holding the asset
+    Bundle* bundle,
+
+    // Asset from bundleFind
+    const BundleEntry* entry,
+
+    // How urgently the asset is needed
+    IOPriority priority,
+
+    // Withdraws the read if set before it starts, may be NULL
+    const atomic_bool* cancel
+) {
+    if (bundle->mapped) return bundle->mapped + entry->offset;
+
+    const size_t size = bundleAlign(entry->size);
+    u8* data = malloc(size ? size : 1);
+    if (!data) return NULL;
+
+    if (!bundleRead(bundle, entry->offset, data, size, entry->size, priority, cancel)) {
+        if (!cancel || !atomic_load(cancel)) {
+            printf("error: cannot read asset %u from %s\n", (unsigned)entry->id, bundle->path);
+        }
+        free(data);
+        return NULL;
+    }
+    return data;
+}
+
+void bundleRelease (
+/*
+    SYNOPSIS
+        Releases a payload returned by bundleAcquire.
+*/
+    // Bundle the payload came from
+    Bundle* bundle,
+
+    // Payload, may be NULL
+    const u8* data
+) {
+    if (!bundle->mapped) free((void*)data);
+}
+
+bool loadBundledTexture (
+/*
+    SYNOPSIS
+        Loads a cover from a bundle into memory from an allocator.
+
+    DESCRIPTION
+        Prefers the pre-compressed ETC1 asset and falls back to the PNG, which goes through
+        the texture cache under "<bundle path>:<id>". Does not touch the GPU when 'allocate'
+        does not, so it can run on a loader thread. Returns false with nothing allocated
+        when the bundle holds no asset for the cover or 'cancel' was set before its read
+        started; on other failures data->data may still hold memory handed out by the
+        allocator.
+
+    EXAMPLE
+        TextureData data;
+        if (!loadBundledTexture(bundle, uid, IO_PRIORITY_VISIBLE, NULL, &options, &data, allocateTextureData, NULL)) {
+            freeTextureData(&data);
+            // load the loose files instead
+        }
+*/
+    // Bundle holding the cover
+    Bundle* bundle,
+
+    // Cover UID
+    u32 id,
+
+    // How urgently the cover is needed
+    IOPriority priority,
+
+    // Withdraws the reads if set before they start, may be NULL
+    const atomic_bool* cancel,
+
+    // Texture format and dithering for a PNG
+    const TextureOptions* options,
+
+    // Description of the loaded texture
+    TextureData* data,
+
+    // Provides the texture memory once its size is known
+    TextureAllocator allocate,
+
+    // Passed to 'allocate'
+    void* context
+) {
+    memset(data, 0, sizeof(*data));
+
+    const BundleEntry* entry = bundleFind(bundle, id, BUNDLE_ETC1);
+    if (entry) {
+        const u8* etc = bundleAcquire(bundle, entry, priority, cancel);
+        const bool loaded = etc && decodeETC1ToTexture(etc, entry->size, data, allocate, context);
+        bundleRelease(bundle, etc);
+        if (loaded || data->data) return loaded;
+    }
+
+    entry = bundleFind(bundle, id, BUNDLE_PNG);
+    if (!entry) return false;
+
+    char name[160];
+    bundleAssetName(bundle, id, name, sizeof(name));
+
+    const u8* png = bundleAcquire(bundle, entry, priority, cancel);
+    const bool loaded = png && loadPNGBufferCached(name, png, entry->size, options, data, allocate, context);
+    bundleRelease(bundle, png);
+    return loaded;
+}
+
+void bundleAssetName(const Bundle* bundle, u32 id, char* name, size_t size) {
+    snprintf(name, size, "%s:%u", bundle->path, (unsigned)id);
+}
+
+bool bundleWrite (
+/*
+    SYNOPSIS
+        Writes assets into a new bundle file.
+
+    DESCRIPTION
+        Sorts the index by id and type and lays the payloads out in that order, each on a
+        BUNDLE_ALIGNMENT boundary and padded with zeros to the next one. Duplicate assets
+        (same id and type) are rejected.
+
+    EXAMPLE
+        BundleAsset assets[] = { { 0, BUNDLE_PNG, png, pngsize } };
+        bundleWrite("images/covers.bundle", assets, 1);
+*/
+    // Path of the bundle to create
+    const char* path,
+
+    // Assets to store
+    const BundleAsset* assets,
+
+    // Number of assets
+    u32 count
+) {
+    BundleEntry* entries = malloc((size_t)count * sizeof(BundleEntry) + 1);
+    const BundleAsset** order = malloc((size_t)count * sizeof(BundleAsset*) + 1);
+    if (!entries || !order) {
+        free(entries);
+        free(order);
+        return false;
+    }
+
+    // Sort the assets through their index entries; 'offset' temporarily holds the asset number
+    for (u32 i = 0; i < count; i++) {
+        entries[i] = (BundleEntry){ assets[i].id, assets[i].type, i, (u32)assets[i].size };
+    }
+    qsort(entries, count, sizeof(BundleEntry), bundleEntryCompare);
+
+    bool valid = true;
+    size_t offset = bundleAlign(sizeof(BundleHeader) + (size_t)count * sizeof(BundleEntry));
+    for (u32 i = 0; i < count; i++) {
+        if (i > 0 && !bundleEntryCompare(&entries[i - 1], &entries[i])) valid = false;
+        order[i] = &assets[entries[i].offset];
+        entries[i].offset = (u32)offset;
+        offset += bundleAlign(entries[i].size);
+    }
+
+    FILE* file = valid ? fopen(path, "wb") : NULL;
+    if (!file) {
+        free(entries);
+        free(order);
+        return false;
+    }
+
+    BundleHeader header = { { 0 } };
+    memcpy(header.magic, BUNDLE_MAGIC, 4);
+    header.version   = BUNDLE_VERSION;
+    header.count     = count;
+    header.alignment = BUNDLE_ALIGNMENT;
+
+    static const u8 padding[BUNDLE_ALIGNMENT];
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                   fwrite(entries, sizeof(BundleEntry), count, file) == count;
+
+    size_t position = sizeof(header) + (size_t)count * sizeof(BundleEntry);
+    for (u32 i = 0; i < count && written; i++) {
+        written = fwrite(padding, 1, entries[i].offset - position, file) == entries[i].offset - position &&
+                  fwrite(order[i]->data, 1, order[i]->size, file) == order[i]->size;
+        position = entries[i].offset + order[i]->size;
+    }
+    if (written) {
+        written = fwrite(padding, 1, bundleAlign(position) - position, file) == bundleAlign(position) - position;
+    }
+
+    written = !fclose(file) && written;
+    if (!written) remove(path);
+
+    free(entries);
+    free(order);
+    return written;
+}
@@ -0,0 +1,288 @@
+#include <math.h>
+#include "carousel.h"
+
+/*
+    Scroll model of the cover carousel.
+
+    The items sit in a ring of slots 'pitch' px apart. Instead of a position per item,
+    the carousel keeps the item in slot 0 and how far that slot has scrolled past the
+    left edge of the view; slot n then shows item (first + n) modulo the library size at
+    n * pitch - shift. Scrolling, wrapping and hit-testing are constant time and laying
+    out the view only touches the items in it, whatever the size of the library.
+*/
+
+// Remainder of a / b in 0..b-1, also for negative a
+static inline int wrapIndex(int a, int b) {
+    const int r = a % b;
+    return r < 0 ? r + b : r;
+}
+
+void carouselInit (
+/*
+    SYNOPSIS
+        Sets up a carousel with item 0 at the left edge of the view.
+
+    EXAMPLE
+        Carousel carousel;
+        carouselInit(&carousel, titleCount, 128.0f, 130.0f, 10.0f, 20.0f, 400.0f);
+*/
+    // Carousel to set up
+    Carousel* carousel,
+
+    // Items in the library, at least 1
+    int count,
+
+    // Size of an item in px
+    float itemWidth,
+    float itemHeight,
+
+    // Gap between neighbouring items in px
+    float spacing,
+
+    // Vertical position of the items
+    float top,
+
+    // Width of the view in px
+    float viewWidth
+) {
+    carousel->count      = count > 0 ? count : 1;
+    carousel->first      = 0;
+    carousel->shift      = 0.0f;
+    carousel->pitch      = itemWidth + spacing;
+    carousel->itemWidth  = itemWidth;
+    carousel->itemHeight = itemHeight;
+    carousel->top        = top;
+    carousel->viewWidth  = viewWidth;
+    carousel->margin     = 0.0f;
+}
+
+void carouselScroll (
+/*
+    SYNOPSIS
+        Moves every item of the carousel sideways.
+
+    DESCRIPTION
+        Whole slots that scroll past the left edge of the view move slot 0 on to the
+        next item, so 'shift' stays below one pitch and keeps its precision however far
+        the carousel travels.
+
+    EXAMPLE
+        carouselScroll(&carousel, -SCROLL_SPEED); // items move left, later ones come in from the right
+*/
+    // Carousel to scroll
+    Carousel* carousel,
+
+    // Movement in px; negative moves the items left
+    float dx
+) {
+    const float shift = carousel->shift - dx;
+    const float slots = floorf(shift / carousel->pitch);
+
+    carousel->shift = shift - slots * carousel->pitch;
+    carousel->first = wrapIndex(carousel->first + (int)fmodf(slots, (float)carousel->count), carousel->count);
+
+    // Rounding may leave the shift a hair outside its range
+    if (carousel->shift >= carousel->pitch || carousel->shift < 0.0f) carousel->shift = 0.0f;
+}
+
+CarouselSlot carouselSlot (
+/*
+    SYNOPSIS
+        Returns the item in a slot and where it is drawn.
+
+    EXAMPLE
+        CarouselSlot next = carouselSlot(&carousel, last.slot + 1);
+*/
+    // Carousel to look at
+    const Carousel* carousel,
+
+    // Slot number relative to slot 0
+    int slot
+) {
+    return (CarouselSlot){
+        slot,
+        wrapIndex(carousel->first + wrapIndex(slot, carousel->count), carousel->count),
+        slot * carousel->pitch - carousel->shift,
+        carousel->top
+    };
+}
+
+int carouselVisible (
+/*
+    SYNOPSIS
+        Lays out the items that overlap the view.
+
+    DESCRIPTION
+        This is the culling step: starts at the first slot whose right edge is inside the
+        view's left margin and stops at the first one past its right margin, so items off
+        screen are never laid out, let alone drawn. A library too small to fill the view
+        shows every item once.
+
+    EXAMPLE
+        CarouselSlot slots[8];
+        const int visible = carouselVisible(&carousel, slots, 8);
+*/
+    // Carousel to lay out
+    const Carousel* carousel,
+
+    // Receives the visible items, left to right
+    CarouselSlot* slots,
+
+    // Capacity of 'slots'
+    int max
+) {
+    const float right = carousel->viewWidth + carousel->margin;
+    int count = 0;
+    int slot  = (int)floorf((carousel->shift - carousel->itemWidth - carousel->margin) / carousel->pitch) + 1;
+
+    for (; count < max && count < carousel->count; slot++) {
+        const CarouselSlot item = carouselSlot(carousel, slot);
+        if (item.x >= right) break;
+        slots[count++] = item;
+    }
+
+    return count;
+}
+
+// Slot whose item centre is closest to the centre of the view
+static int centreSlot(const Carousel* carousel) {
+    return (int)floorf((carousel->viewWidth - carousel->itemWidth) / 2 / carousel->pitch +
+                       carousel->shift / carousel->pitch + 0.5f);
+}
+
+int carouselNearest (
+/*
+    SYNOPSIS
+        Returns the item closest to the centre of the view.
+
+    EXAMPLE
+        const int nearest = carouselNearest(&carousel);
+*/
+    // Carousel to look at
+    const Carousel* carousel
+) {
+    return carouselSlot(carousel, centreSlot(carousel)).index;
+}
+
+int carouselSelected (
+/*
+    SYNOPSIS
+        Returns the item resting at the centre of the view.
+
+    DESCRIPTION
+        An item counts as selected while its centre is within 'threshold' px of the
+        centre of the view; in between items nothing is selected.
+
+    EXAMPLE
+        const int selected = carouselSelected(&carousel, SELECTION_THRESHOLD);
+*/
+    // Carousel to look at
+    const Carousel* carousel,
+
+    // Largest distance between the centres in px
+    float threshold
+) {
+    const CarouselSlot item = carouselSlot(carousel, centreSlot(carousel));
+    const float distance = item.x + carousel->itemWidth / 2 - carousel->viewWidth / 2;
+    return fabsf(distance) < threshold ? item.index : -1;
+}
+
+void carouselSelectionInit (
+/*
+    SYNOPSIS
+        Clears a selection before its first update; nothing counts as selected until then.
+
+    EXAMPLE
+        CarouselSelection selection;
+        carouselSelectionInit(&selection);
+*/
+    // Selection to clear
+    CarouselSelection* selection
+) {
+    selection->index    = -1;
+    selection->previous = -1;
+    selection->nearest  = 0;
+    selection->changed  = false;
+}
+
+bool carouselUpdateSelection (
+/*
+    SYNOPSIS
+        Derives this frame's selection from the scroll position.
+
+    DESCRIPTION
+        Called once per frame after scrolling, so drawing, loading and launching all see
+        the same selection without testing the items again. 'changed' is set for exactly
+        the frames in which the selected item differs from the frame before, including
+        when the carousel starts or stops resting on an item.
+
+    EXAMPLE
+        carouselScroll(&carousel, dx);
+        if (carouselUpdateSelection(&selection, &carousel, SELECTION_THRESHOLD)) {
+            // a different title is selected, or none
+        }
+*/
+    // Selection to update
+    CarouselSelection* selection,
+
+    // Carousel it belongs to
+    const Carousel* carousel,
+
+    // Largest distance between the centres of the item and the view in px
+    float threshold
+) {
+    const int slot = centreSlot(carousel);
+    const CarouselSlot item = carouselSlot(carousel, slot);
+    const float distance = item.x + carousel->itemWidth / 2 - carousel->viewWidth / 2;
+    const int index = fabsf(distance) < threshold ? item.index : -1;
+
+    selection->changed  = index != selection->index;
+    selection->previous = selection->index;
+    selection->index    = index;
+    selection->nearest  = item.index;
+    return selection->changed;
+}
+
+int carouselItemAt (
+/*
+    SYNOPSIS
+        Finds the item drawn at a point of the view.
+
+    EXAMPLE
+        const int touched = carouselItemAt(&carousel, touch.px, touch.py);
+*/
+    // Carousel to look at
+    const Carousel* carousel,
+
+    // Point in px
+    float x,
+    float y
+) {
+    if (y < carousel->top || y >= carousel->top + carousel->itemHeight) return -1;
+
+    const int slot = (int)floorf((x + carousel->shift) / carousel->pitch);
+    const float inside = x + carousel->shift - slot * carousel->pitch;
+    return inside < carousel->itemWidth ? carouselSlot(carousel, slot).index : -1;
+}
+
+float carouselItemX (
+/*
+    SYNOPSIS
+        Returns where an item is drawn, choosing its occurrence nearest to the centre of
+        the view as the ring wraps.
+
+    EXAMPLE
+        const float x = carouselItemX(&carousel, selected);
+*/
+    // Carousel to look at
+    const Carousel* carousel,
+
+    // Item, 0..count-1
+    int index
+) {
+    const float ring = carousel->count * carousel->pitch;
+    float x = wrapIndex(index - carousel->first, carousel->count) * carousel->pitch - carousel->shift;
+
+    if (x + carousel->itemWidth / 2 - carousel->viewWidth / 2 > ring / 2) x -= ring;
+    return x;
+}
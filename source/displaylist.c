@@ -0,0 +1,247 @@
+#include "displaylist.h"
+
+/*
+    Retained display lists.
+
+    Laying out a screen and drawing it are separate steps: the layout records its draw
+    calls into a list per screen once, when what the screen shows changes, and each
+    frame only replays the lists after C2D_SceneBegin. Replaying also orders the calls
+    into two passes, so blending is switched at most twice per screen however the
+    layout recorded them.
+*/
+
+// Switches between citro2d's alpha blending and plain writes that leave the color buffer unread
+static void setBlending(bool enabled) {
+    C2D_Flush(); // Vertices already batched are drawn with the state they were queued under
+
+    if (enabled) {
+        C3D_AlphaBlend(GPU_BLEND_ADD, GPU_BLEND_ADD, GPU_SRC_ALPHA, GPU_ONE_MINUS_SRC_ALPHA, GPU_SRC_ALPHA, GPU_ONE_MINUS_SRC_ALPHA);
+    } else {
+        C3D_ColorLogicOp(GPU_LOGICOP_COPY);
+    }
+}
+
+// Next free command, or NULL when the list is full
+static DrawCommand* displayListAppend(DisplayList* list, DrawCommandType type, float x, float y, float depth,
+                                      bool blend) {
+    if (list->count == DISPLAY_LIST_MAX_COMMANDS) return NULL;
+
+    DrawCommand* command = &list->commands[list->count++];
+    command->type  = type;
+    command->blend = blend;
+    command->x     = x;
+    command->y     = y;
+    command->depth = depth;
+    if (blend) list->blended++;
+    return command;
+}
+
+static void drawCommand(const DrawCommand* command) {
+    switch (command->type) {
+        case DRAW_IMAGE:
+            C2D_DrawImageAt(command->image, command->x, command->y, command->depth, NULL, 1.0f, 1.0f);
+            break;
+        case DRAW_RECT:
+            C2D_DrawRectSolid(command->x, command->y, command->depth, command->rect.width, command->rect.height,
+                              command->rect.color);
+            break;
+        case DRAW_TEXT:
+            C2D_DrawText(command->text.text, command->text.flags | C2D_WithColor, command->x, command->y,
+                         command->depth, command->text.scale, command->text.scale, command->text.color,
+                         command->text.wrapWidth);
+            break;
+    }
+}
+
+void displayListClear (
+/*
+    SYNOPSIS
+        Empties a display list before a new layout is recorded into it.
+*/
+    // List to empty
+    DisplayList* list
+) {
+    list->count   = 0;
+    list->blended = 0;
+}
+
+bool displayListImage (
+/*
+    SYNOPSIS
+        Records an image drawn at its own size.
+
+    EXAMPLE
+        displayListImage(&scene.top, cover, slot.x, slot.y, 0.5f, !residencyOpaque(covers, UID));
+*/
+    // List to record into
+    DisplayList* list,
+
+    // Image to draw; it has to stay valid while the list is submitted
+    C2D_Image image,
+
+    // Position of the top-left corner and depth
+    float x,
+    float y,
+    float depth,
+
+    // Whether the image has transparent texels to blend
+    bool blend
+) {
+    DrawCommand* command = displayListAppend(list, DRAW_IMAGE, x, y, depth, blend);
+    if (!command) return false;
+
+    command->image = image;
+    return true;
+}
+
+bool displayListTiledImage (
+/*
+    SYNOPSIS
+        Records the tiles of an image larger than one texture, each at its own size.
+
+    DESCRIPTION
+        Tiles that lie entirely outside the view are left out, so an image much wider
+        than the screen costs only the commands of the part that shows. The tiles are
+        blended unless the image is opaque.
+
+    EXAMPLE
+        displayListTiledImage(&scene.top, &backdrop, -offset, 0.0f, 0.0f, TOP_SCREEN_WIDTH, TOP_SCREEN_HEIGHT);
+*/
+    // List to record into
+    DisplayList* list,
+
+    // Image to draw; its tiles have to stay valid while the list is submitted
+    const TiledImage* image,
+
+    // Position of the top-left corner and depth
+    float x,
+    float y,
+    float depth,
+
+    // Size of the view, which starts at (0, 0)
+    float viewWidth,
+    float viewHeight
+) {
+    const float step  = TILED_IMAGE_TILE_SIZE;
+    const bool  blend = image->opacity != IMAGE_OPAQUE;
+
+    for (u32 row = 0; row < image->rows; row++) {
+        for (u32 column = 0; column < image->columns; column++) {
+            const C2D_Image tile = image->tiles[row * image->columns + column];
+            const float tileX = x + column * step;
+            const float tileY = y + row * step;
+
+            if (tileX >= viewWidth || tileY >= viewHeight || tileX + tile.subtex->width <= 0.0f ||
+                tileY + tile.subtex->height <= 0.0f) {
+                continue;
+            }
+            if (!displayListImage(list, tile, tileX, tileY, depth, blend)) return false;
+        }
+    }
+    return true;
+}
+
+bool displayListRect (
+/*
+    SYNOPSIS
+        Records a solid rectangle.
+
+    EXAMPLE
+        displayListRect(&scene.top, slot.x, slot.y, 0.5f, BOX_WIDTH, BOX_HEIGHT, PLACEHOLDER_BOX_COLOR);
+*/
+    // List to record into
+    DisplayList* list,
+
+    // Position of the top-left corner and depth
+    float x,
+    float y,
+    float depth,
+
+    // Size in px
+    float width,
+    float height,
+
+    // Opaque color
+    u32 color
+) {
+    DrawCommand* command = displayListAppend(list, DRAW_RECT, x, y, depth, false);
+    if (!command) return false;
+
+    command->rect.width  = width;
+    command->rect.height = height;
+    command->rect.color  = color;
+    return true;
+}
+
+bool displayListText (
+/*
+    SYNOPSIS
+        Records a colored text. Glyphs are always blended.
+
+    EXAMPLE
+        displayListText(&scene.bottom, &box->GameDescriptionObject, C2D_WordWrap, 10.0f, 10.0f, 0.5f, 0.5f,
+                        GLOBAL_SECONDARY_TEXT_COLOR, BOTTOM_SCREEN_WIDTH / 2 - 10.0f);
+*/
+    // List to record into
+    DisplayList* list,
+
+    // Parsed text; it has to stay valid while the list is submitted
+    const C2D_Text* text,
+
+    // C2D_DrawText flags besides C2D_WithColor, e.g. C2D_WordWrap
+    u32 flags,
+
+    // Position and depth
+    float x,
+    float y,
+    float depth,
+
+    // Font scale in both directions
+    float scale,
+
+    // Color of the text
+    u32 color,
+
+    // Line width for C2D_WordWrap
+    float wrapWidth
+) {
+    DrawCommand* command = displayListAppend(list, DRAW_TEXT, x, y, depth, true);
+    if (!command) return false;
+
+    command->text.text      = text;
+    command->text.flags     = flags;
+    command->text.scale     = scale;
+    command->text.color     = color;
+    command->text.wrapWidth = wrapWidth;
+    return true;
+}
+
+void displayListSubmit (
+/*
+    SYNOPSIS
+        Draws a display list into the current scene.
+
+    DESCRIPTION
+        Opaque commands replace what is behind them, so they go first with blending off
+        and cost the GPU no color buffer reads; the blended ones follow in the order they
+        were recorded. Blending is left on, as citro2d expects.
+
+    EXAMPLE
+        C2D_SceneBegin(top);
+        displayListSubmit(&scene.top);
+*/
+    // List to draw
+    const DisplayList* list
+) {
+    if (list->count > list->blended) {
+        setBlending(false);
+        for (int i = 0; i < list->count; i++) {
+            if (!list->commands[i].blend) drawCommand(&list->commands[i]);
+        }
+        setBlending(true);
+    }
+
+    for (int i = 0; list->blended && i < list->count; i++) {
+        if (list->commands[i].blend) drawCommand(&list->commands[i]);
+    }
+}
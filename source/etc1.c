@@ -0,0 +1,628 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hash.h"
+#include "etc1.h"
+#include "texture.h"
+
+/*
+    ETC1 on the PICA200 differs from the Khronos layout in two ways: every 8x8 tile
+    holds four 4x4 blocks in Z order, and each 64-bit block is stored little-endian.
+    ETC1A4 prefixes every block with 64 bits of 4-bit alpha. Inside a block, pixel
+    (x, y) has index x * 4 + y for both the colour selectors and the alpha nibbles.
+*/
+
+// How far the encoder searches around the average colour, in quantization steps
+#define ETC1_BASE_SEARCH 2
+
+// Intensity modifiers per table; selector 0..3 picks +a, +b, -a, -b
+static const int etc1Modifiers[8][2] = {
+    { 2, 8 }, { 5, 17 }, { 9, 29 }, { 13, 42 }, { 18, 60 }, { 24, 80 }, { 33, 106 }, { 47, 183 }
+};
+
+static inline int clampColor(int value) {
+    return value < 0 ? 0 : (value > 255 ? 255 : value);
+}
+
+static inline int etc1Modifier(u32 table, u32 selector) {
+    const int modifier = etc1Modifiers[table][selector & 1];
+    return (selector & 2) ? -modifier : modifier;
+}
+
+static inline u32 blockBytes(GPU_TEXCOLOR format) {
+    return format == GPU_ETC1A4 ? 16 : 8;
+}
+
+size_t etc1TextureSize (
+/*
+    SYNOPSIS
+        Returns the size in bytes of a tiled ETC1 or ETC1A4 texture.
+
+    EXAMPLE
+        size_t size = etc1TextureSize(GPU_ETC1, 128, 256); // 16 KiB
+*/
+    // GPU_ETC1 or GPU_ETC1A4
+    GPU_TEXCOLOR format,
+
+    // Texture dimensions in texels
+    u32 textureWidth,
+    u32 textureHeight
+) {
+    return (size_t)(textureWidth / 4) * (textureHeight / 4) * blockBytes(format);
+}
+
+bool imageHasAlpha (
+/*
+    SYNOPSIS
+        Checks whether an RGBA image uses its alpha channel.
+
+    EXAMPLE
+        GPU_TEXCOLOR format = imageHasAlpha(rgba, w, h) ? GPU_ETC1A4 : GPU_ETC1;
+*/
+    // Image, 4 bytes per pixel in R,G,B,A order
+    const u8* rgba,
+
+    // Image dimensions in pixels
+    u32 width,
+    u32 height
+) {
+    return imageOpacity(rgba, width, height) != IMAGE_OPAQUE;
+}
+
+static u32 etc1FitSubblock (
+/*
+    SYNOPSIS
+        Finds the modifier table and selectors that best fit 8 pixels to a base colour.
+
+    DESCRIPTION
+        Returns the summed squared error of the best table. The table index and one
+        selector per member pixel are written to 'table' and 'selectors'.
+*/
+    // Block pixels, RGB, indexed x * 4 + y
+    const u8 (*pixels)[3],
+
+    // Indices of the 8 pixels that belong to the subblock
+    const u8* members,
+
+    // Expanded 8-bit base colour
+    const int* base,
+
+    // Best table index
+    u32* table,
+
+    // Best selector per member
+    u8* selectors
+) {
+    u32 best = UINT32_MAX;
+
+    for (u32 t = 0; t < 8; t++) {
+        u32 error = 0;
+        u8 candidate[8];
+
+        for (u32 i = 0; i < 8 && error < best; i++) {
+            const u8* pixel = pixels[members[i]];
+            u32 bestPixel = UINT32_MAX;
+
+            for (u32 s = 0; s < 4; s++) {
+                const int modifier = etc1Modifier(t, s);
+                const int dr = clampColor(base[0] + modifier) - pixel[0];
+                const int dg = clampColor(base[1] + modifier) - pixel[1];
+                const int db = clampColor(base[2] + modifier) - pixel[2];
+                const u32 e  = (u32)(dr * dr + dg * dg + db * db);
+
+                if (e < bestPixel) {
+                    bestPixel    = e;
+                    candidate[i] = (u8)s;
+                }
+            }
+
+            error += bestPixel;
+        }
+
+        if (error < best) {
+            best   = error;
+            *table = t;
+            memcpy(selectors, candidate, sizeof(candidate));
+        }
+    }
+
+    return best;
+}
+
+static u32 etc1FitBase (
+/*
+    SYNOPSIS
+        Picks the quantized base colour, table and selectors that best fit a subblock.
+
+    DESCRIPTION
+        Starts from the rounded average colour and also tries bases shifted along the grey
+        axis, which is the direction the intensity modifiers move pixels. Returns the error
+        of the best fit and updates 'quantized' to the chosen base.
+*/
+    // Block pixels, RGB, indexed x * 4 + y
+    const u8 (*pixels)[3],
+
+    // Indices of the 8 pixels that belong to the subblock
+    const u8* members,
+
+    // Non-zero for 5-bit (differential) bases, zero for 4-bit (individual) bases
+    u32 diff,
+
+    // Allowed range of each quantized channel
+    const int* low,
+    const int* high,
+
+    // Initial guess on input, chosen base on output
+    int* quantized,
+
+    // Best table index
+    u32* table,
+
+    // Best selector per member
+    u8* selectors
+) {
+    int start[3];
+    u32 best = UINT32_MAX;
+    memcpy(start, quantized, sizeof(start));
+
+    for (int shift = -ETC1_BASE_SEARCH; shift <= ETC1_BASE_SEARCH; shift++) {
+        int candidate[3], base[3];
+        bool inRange = true;
+
+        for (u32 c = 0; c < 3; c++) {
+            candidate[c] = start[c] + shift;
+            if (candidate[c] < low[c] || candidate[c] > high[c]) inRange = false;
+            base[c] = diff ? (candidate[c] << 3) | (candidate[c] >> 2) : candidate[c] * 17;
+        }
+        if (!inRange && shift) continue;
+        if (!inRange) {
+            // The rounded average itself may sit outside a differential range; clamp it
+            for (u32 c = 0; c < 3; c++) {
+                candidate[c] = candidate[c] < low[c] ? low[c] : (candidate[c] > high[c] ? high[c] : candidate[c]);
+                base[c] = diff ? (candidate[c] << 3) | (candidate[c] >> 2) : candidate[c] * 17;
+            }
+        }
+
+        u32 candidateTable = 0;
+        u8 candidateSelectors[8] = { 0 };
+        const u32 error = etc1FitSubblock(pixels, members, base, &candidateTable, candidateSelectors);
+        if (error < best) {
+            best   = error;
+            *table = candidateTable;
+            memcpy(selectors, candidateSelectors, sizeof(candidateSelectors));
+            memcpy(quantized, candidate, sizeof(candidate));
+        }
+    }
+
+    return best;
+}
+
+static u64 etc1EncodeBlock (
+/*
+    SYNOPSIS
+        Compresses one 4x4 block of RGB pixels into a 64-bit ETC1 word.
+
+    DESCRIPTION
+        Tries both subblock orientations in both individual (4:4:4 + 4:4:4) and differential
+        (5:5:5 + 3:3:3) mode, searching bases around the average colour of each subblock,
+        and keeps the candidate with the lowest error.
+*/
+    // Block pixels, RGB, indexed x * 4 + y
+    const u8 (*pixels)[3]
+) {
+    u64 bestBlock = 0;
+    u32 bestError = UINT32_MAX;
+
+    for (u32 flip = 0; flip < 2; flip++) {
+        // Without flip the subblocks are the left and right 2x4 halves, with flip the top and bottom 4x2 halves
+        u8 members[2][8];
+        u32 count[2] = { 0, 0 };
+        for (u32 p = 0; p < 16; p++) {
+            const u32 sub = flip ? ((p & 3) >= 2) : ((p >> 2) >= 2);
+            members[sub][count[sub]++] = (u8)p;
+        }
+
+        int average[2][3];
+        for (u32 sub = 0; sub < 2; sub++) {
+            for (u32 c = 0; c < 3; c++) {
+                int sum = 0;
+                for (u32 i = 0; i < 8; i++) sum += pixels[members[sub][i]][c];
+                average[sub][c] = (sum + 4) / 8;
+            }
+        }
+
+        for (u32 diff = 0; diff < 2; diff++) {
+            // Individual mode stores 4 bits per channel, differential mode 5 bits plus a 3-bit delta
+            const int maxQuantized = diff ? 31 : 15;
+            int quantized[2][3], low[3], high[3];
+            u32 table[2];
+            u8 selectors[2][8];
+
+            for (u32 c = 0; c < 3; c++) {
+                quantized[0][c] = (average[0][c] * maxQuantized + 127) / 255;
+                low[c]  = 0;
+                high[c] = maxQuantized;
+            }
+            u32 error = etc1FitBase(pixels, members[0], diff, low, high, quantized[0], &table[0], selectors[0]);
+            if (error >= bestError) continue;
+
+            // The second colour of a differential block must stay within -4..+3 of the first
+            for (u32 c = 0; c < 3; c++) {
+                quantized[1][c] = (average[1][c] * maxQuantized + 127) / 255;
+                if (diff) {
+                    low[c]  = quantized[0][c] - 4 < 0 ? 0 : quantized[0][c] - 4;
+                    high[c] = quantized[0][c] + 3 > 31 ? 31 : quantized[0][c] + 3;
+                }
+            }
+            error += etc1FitBase(pixels, members[1], diff, low, high, quantized[1], &table[1], selectors[1]);
+            if (error >= bestError) continue;
+
+            u32 word;
+            if (diff) {
+                word = ((u32)quantized[0][0] << 27) | (((u32)(quantized[1][0] - quantized[0][0]) & 7) << 24) |
+                       ((u32)quantized[0][1] << 19) | (((u32)(quantized[1][1] - quantized[0][1]) & 7) << 16) |
+                       ((u32)quantized[0][2] << 11) | (((u32)(quantized[1][2] - quantized[0][2]) & 7) << 8);
+            } else {
+                word = ((u32)quantized[0][0] << 28) | ((u32)quantized[1][0] << 24) |
+                       ((u32)quantized[0][1] << 20) | ((u32)quantized[1][1] << 16) |
+                       ((u32)quantized[0][2] << 12) | ((u32)quantized[1][2] << 8);
+            }
+            word |= (table[0] << 5) | (table[1] << 2) | (diff << 1) | flip;
+
+            u32 indices = 0;
+            for (u32 sub = 0; sub < 2; sub++) {
+                for (u32 i = 0; i < 8; i++) {
+                    const u32 p = members[sub][i];
+                    indices |= (u32)(selectors[sub][i] >> 1) << (16 + p);
+                    indices |= (u32)(selectors[sub][i] & 1) << p;
+                }
+            }
+
+            bestError = error;
+            bestBlock = ((u64)word << 32) | indices;
+        }
+    }
+
+    return bestBlock;
+}
+
+static void etc1DecodeBlock (
+/*
+    SYNOPSIS
+        Expands a 64-bit ETC1 word into 16 RGB pixels indexed x * 4 + y.
+*/
+    // ETC1 word
+    u64 block,
+
+    // Decoded pixels
+    u8 (*pixels)[3]
+) {
+    const u32 high = (u32)(block >> 32);
+    const u32 low  = (u32)block;
+    const u32 flip = high & 1;
+    const u32 table[2] = { (high >> 5) & 7, (high >> 2) & 7 };
+    int base[2][3];
+
+    for (u32 c = 0; c < 3; c++) {
+        const u32 shift = 24 - c * 8;
+        if (high & 2) {
+            const int first = (high >> (shift + 3)) & 31;
+            const int delta = ((int)((high >> shift) & 7) ^ 4) - 4;
+            const int second = first + delta;
+            base[0][c] = (first << 3) | (first >> 2);
+            base[1][c] = (second << 3) | (second >> 2);
+        } else {
+            base[0][c] = ((high >> (shift + 4)) & 15) * 17;
+            base[1][c] = ((high >> shift) & 15) * 17;
+        }
+    }
+
+    for (u32 p = 0; p < 16; p++) {
+        const u32 sub      = flip ? ((p & 3) >= 2) : ((p >> 2) >= 2);
+        const u32 selector = (((low >> (16 + p)) & 1) << 1) | ((low >> p) & 1);
+        const int modifier = etc1Modifier(table[sub], selector);
+
+        for (u32 c = 0; c < 3; c++) {
+            pixels[p][c] = (u8)clampColor(base[sub][c] + modifier);
+        }
+    }
+}
+
+void etc1EncodeTexture (
+/*
+    SYNOPSIS
+        Compresses an RGBA image into a tiled ETC1 or ETC1A4 texture.
+
+    DESCRIPTION
+        Walks the texture tile by tile and compresses its four 4x4 blocks in the order the
+        GPU expects. Texels outside the image repeat the nearest edge pixel, which keeps
+        linear filtering at the border of the image from bleeding in a foreign colour.
+
+    EXAMPLE
+        u8* data = malloc(etc1TextureSize(GPU_ETC1, 128, 256));
+        etc1EncodeTexture(data, GPU_ETC1, 128, 256, rgba, 128, 130);
+*/
+    // Destination, etc1TextureSize(format, textureWidth, textureHeight) bytes
+    void* texture,
+
+    // GPU_ETC1 or GPU_ETC1A4
+    GPU_TEXCOLOR format,
+
+    // Texture dimensions in texels (multiples of 8)
+    u32 textureWidth,
+    u32 textureHeight,
+
+    // Source image, 4 bytes per pixel in R,G,B,A order
+    const u8* rgba,
+
+    // Source dimensions in pixels
+    u32 width,
+    u32 height
+) {
+    u8* out = (u8*)texture;
+
+    for (u32 tileY = 0; tileY < textureHeight; tileY += 8) {
+        for (u32 tileX = 0; tileX < textureWidth; tileX += 8) {
+            for (u32 b = 0; b < 4; b++) {
+                const u32 x0 = tileX + (b & 1) * 4;
+                const u32 y0 = tileY + (b >> 1) * 4;
+                u8 pixels[16][3];
+                u64 alpha = 0;
+
+                for (u32 p = 0; p < 16; p++) {
+                    const u32 x = x0 + (p >> 2) < width  ? x0 + (p >> 2) : width - 1;
+                    const u32 y = y0 + (p & 3)  < height ? y0 + (p & 3)  : height - 1;
+                    const u8* src = rgba + ((size_t)y * width + x) * 4;
+
+                    memcpy(pixels[p], src, 3);
+                    alpha |= (u64)((src[3] * 15 + 127) / 255) << (p * 4);
+                }
+
+                if (format == GPU_ETC1A4) {
+                    memcpy(out, &alpha, sizeof(alpha));
+                    out += sizeof(alpha);
+                }
+
+                const u64 block = etc1EncodeBlock((const u8 (*)[3])pixels);
+                memcpy(out, &block, sizeof(block));
+                out += sizeof(block);
+            }
+        }
+    }
+}
+
+void etc1DecodeTexture (
+/*
+    SYNOPSIS
+        Expands a tiled ETC1 or ETC1A4 texture into a linear RGBA image.
+
+    DESCRIPTION
+        The output covers the whole texture. Without an alpha block every pixel is opaque.
+        Used to verify the encoder and to measure its quality on the host.
+*/
+    // Destination, textureWidth * textureHeight * 4 bytes
+    u8* rgba,
+
+    // GPU_ETC1 or GPU_ETC1A4
+    GPU_TEXCOLOR format,
+
+    // Texture dimensions in texels (multiples of 8)
+    u32 textureWidth,
+    u32 textureHeight,
+
+    // Tiled texture data
+    const void* texture
+) {
+    const u8* in = (const u8*)texture;
+
+    for (u32 tileY = 0; tileY < textureHeight; tileY += 8) {
+        for (u32 tileX = 0; tileX < textureWidth; tileX += 8) {
+            for (u32 b = 0; b < 4; b++) {
+                const u32 x0 = tileX + (b & 1) * 4;
+                const u32 y0 = tileY + (b >> 1) * 4;
+                u64 alpha = UINT64_MAX;
+                u64 block;
+
+                if (format == GPU_ETC1A4) {
+                    memcpy(&alpha, in, sizeof(alpha));
+                    in += sizeof(alpha);
+                }
+                memcpy(&block, in, sizeof(block));
+                in += sizeof(block);
+
+                u8 pixels[16][3];
+                etc1DecodeBlock(block, pixels);
+
+                for (u32 p = 0; p < 16; p++) {
+                    u8* dst = rgba + ((size_t)(y0 + (p & 3)) * textureWidth + x0 + (p >> 2)) * 4;
+                    memcpy(dst, pixels[p], 3);
+                    dst[3] = (u8)(((alpha >> (p * 4)) & 15) * 17);
+                }
+            }
+        }
+    }
+}
+
+static bool etc1HeaderValid(const ETC1FileHeader* header) {
+    return !memcmp(header->magic, ETC1_FILE_MAGIC, 4) &&
+           header->version == ETC1_FILE_VERSION &&
+           (header->format == GPU_ETC1 || header->format == GPU_ETC1A4) &&
+           header->width <= header->textureWidth && header->height <= header->textureHeight &&
+           header->dataSize == etc1TextureSize(header->format, header->textureWidth, header->textureHeight);
+}
+
+bool decodeETC1ToTexture (
+/*
+    SYNOPSIS
+        Copies a .etc file held in memory into texture memory from an allocator.
+
+    DESCRIPTION
+        Validates the header, obtains the destination from 'allocate' and copies the
+        pre-tiled blocks into it. No decoding or swizzling happens at runtime; the blocks
+        are hashed into data->sourceHash so identical covers can share a texture. On failure
+        data->data may still hold memory handed out by the allocator.
+
+    EXAMPLE
+        TextureData data;
+        decodeETC1ToTexture(buffer, size, &data, allocateTextureData, NULL);
+*/
+    // Contents of a .etc file
+    const u8* buffer,
+
+    // Size of the buffer in bytes
+    size_t size,
+
+    // Description of the texture
+    TextureData* data,
+
+    // Provides the texture memory once its size is known
+    TextureAllocator allocate,
+
+    // Passed to 'allocate'
+    void* context
+) {
+    ETC1FileHeader header;
+
+    memset(data, 0, sizeof(*data));
+    if (size < sizeof(header)) return false;
+    memcpy(&header, buffer, sizeof(header));
+
+    if (!etc1HeaderValid(&header) || size - sizeof(header) < header.dataSize) {
+        printf("error: invalid compressed texture\n");
+        return false;
+    }
+
+    data->format        = (GPU_TEXCOLOR)header.format;
+    data->width         = header.width;
+    data->height        = header.height;
+    data->textureWidth  = header.textureWidth;
+    data->textureHeight = header.textureHeight;
+    data->size          = header.dataSize;
+    data->opacity       = formatOpacity(data->format);
+    data->data          = allocate(data, context);
+    if (!data->data) return false;
+
+    memcpy(data->data, buffer + sizeof(header), header.dataSize);
+    data->sourceHash = hash64(buffer + sizeof(header), header.dataSize, 0);
+    return true;
+}
+
+C2D_Image convertETC1BufferToC2DImage (
+/*
+    SYNOPSIS
+        Creates a compressed texture from a .etc file held in memory.
+
+    DESCRIPTION
+        See decodeETC1ToTexture; the blocks are copied straight into a GPU_ETC1 or
+        GPU_ETC1A4 texture.
+
+    EXAMPLE
+        C2D_Image image = convertETC1BufferToC2DImage(data, size);
+*/
+    // Contents of a .etc file
+    const u8* data,
+
+    // Size of the data in bytes
+    size_t size
+) {
+    C2D_Image img = {0};
+    TextureData texture;
+
+    if (!decodeETC1ToTexture(data, size, &texture, allocateC2DImageTexture, &img)) {
+        freeC2DImage(&img);
+        return (C2D_Image){0};
+    }
+
+    C3D_TexFlush(img.tex);
+    return img;
+}
+
+bool loadETC1Texture (
+/*
+    SYNOPSIS
+        Reads a .etc file produced by the host packer into memory from an allocator.
+
+    DESCRIPTION
+        Reads the header, obtains the destination from 'allocate' and reads the blocks
+        straight into it in one sequential read, then hashes them into data->sourceHash.
+        A missing file is not an error; it returns false with nothing allocated so
+        callers can fall back to the PNG. On other failures data->data may still hold
+        memory handed out by the allocator.
+
+    EXAMPLE
+        TextureData data;
+        if (!loadETC1Texture("images/game0.etc", &data, allocateTextureData, NULL)) {
+            freeTextureData(&data);
+        }
+*/
+    // Filename of the .etc file to load
+    const char* filename,
+
+    // Description of the loaded texture
+    TextureData* data,
+
+    // Provides the texture memory once its size is known
+    TextureAllocator allocate,
+
+    // Passed to 'allocate'
+    void* context
+) {
+    ETC1FileHeader header;
+    bool loaded = false;
+
+    memset(data, 0, sizeof(*data));
+
+    FILE* file = fopen(filename, "rb");
+    if (!file) return false;
+
+    if (fread(&header, sizeof(header), 1, file) != 1 || !etc1HeaderValid(&header)) {
+        printf("error: invalid compressed texture %s\n", filename);
+    } else {
+        data->format        = (GPU_TEXCOLOR)header.format;
+        data->width         = header.width;
+        data->height        = header.height;
+        data->textureWidth  = header.textureWidth;
+        data->textureHeight = header.textureHeight;
+        data->size          = header.dataSize;
+        data->opacity       = formatOpacity(data->format);
+        data->data          = allocate(data, context);
+
+        if (data->data) {
+            loaded = fread(data->data, 1, header.dataSize, file) == header.dataSize;
+            if (!loaded) printf("error: truncated compressed texture %s\n", filename);
+            else data->sourceHash = hash64(data->data, header.dataSize, 0);
+        }
+    }
+
+    fclose(file);
+    return loaded;
+}
+
+C2D_Image convertETC1ToC2DImage (
+/*
+    SYNOPSIS
+        Loads a .etc file produced by the host packer into a compressed texture.
+
+    DESCRIPTION
+        Reads the header, allocates a GPU_ETC1 or GPU_ETC1A4 texture and reads the blocks
+        straight into the texture memory in one sequential read. A missing file is not an
+        error; it returns an empty image so callers can fall back to the PNG.
+
+    EXAMPLE
+        C2D_Image image = convertETC1ToC2DImage("images/game0.etc");
+        if (!image.tex) image = convertPNGToC2DImage("images/game0.png");
+*/
+    // Filename of the .etc file to load
+    const char* filename
+) {
+    C2D_Image img = {0};
+    TextureData data;
+
+    if (!loadETC1Texture(filename, &data, allocateC2DImageTexture, &img)) {
+        freeC2DImage(&img);
+        return (C2D_Image){0};
+    }
+
+    C3D_TexFlush(img.tex);
+    return img;
+}
@@ -0,0 +1,62 @@
+#include "framebudget.h"
+
+void frameBudgetInit (
+/*
+    SYNOPSIS
+        Prepares a frame budget.
+
+    EXAMPLE
+        FrameBudget budget;
+        frameBudgetInit(&budget);
+*/
+    // Budget to initialize
+    FrameBudget* budget
+) {
+    budget->budgetUs = FRAME_BUDGET_MIN_US;
+    budget->frameUs  = FRAME_TARGET_US - FRAME_BUDGET_MARGIN_US - FRAME_BUDGET_MIN_US;
+}
+
+void frameBudgetUpdate (
+/*
+    SYNOPSIS
+        Adapts the sliced work budget to the headroom of the last frame.
+
+    DESCRIPTION
+        The frame's own busy time is what remains after taking the sliced work out. Its
+        estimate follows a busier frame at once and a lighter one slowly, so a spike in
+        the carousel (a scroll starting, text being laid out) immediately shrinks the
+        budget, while it only grows back over a few frames. The budget is whatever the
+        estimate leaves of the frame target minus the margin, within the limits.
+
+    EXAMPLE
+        u64 start = svcGetSystemTick();
+        // frame work, including 'sliced' ticks of decoding
+        frameBudgetUpdate(&budget, ticksToMicroseconds(svcGetSystemTick() - start), ticksToMicroseconds(sliced));
+*/
+    // Budget to adapt
+    FrameBudget* budget,
+
+    // CPU time the frame took, vsync waits excluded
+    u32 busyUs,
+
+    // Part of busyUs spent on sliced work
+    u32 slicedUs
+) {
+    const u32 frameUs = busyUs > slicedUs ? busyUs - slicedUs : 0;
+
+    if (frameUs > budget->frameUs) {
+        budget->frameUs = frameUs;
+    } else {
+        budget->frameUs -= (budget->frameUs - frameUs) / 8;
+    }
+
+    const u32 reserved = budget->frameUs + FRAME_BUDGET_MARGIN_US;
+    const u32 headroom = reserved < FRAME_TARGET_US ? FRAME_TARGET_US - reserved : 0;
+
+    budget->budgetUs = headroom < FRAME_BUDGET_MIN_US ? FRAME_BUDGET_MIN_US :
+                       headroom > FRAME_BUDGET_MAX_US ? FRAME_BUDGET_MAX_US : headroom;
+}
+
+u32 ticksToMicroseconds(u64 ticks) {
+    return (u32)(ticks / CPU_TICKS_PER_USEC);
+}
@@ -0,0 +1,117 @@
+#include <string.h>
+#include "hash.h"
+
+/*
+    XXH64 by Yann Collet, written out for this project. It hashes 32 bytes per
+    round with four independent accumulators, which keeps it well above SD card
+    read speed even on the Old 3DS.
+*/
+
+#define PRIME64_1 0x9E3779B185EBCA87ULL
+#define PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define PRIME64_3 0x165667B19E3779F9ULL
+#define PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define PRIME64_5 0x27D4EB2F165667C5ULL
+
+static inline u64 rotl64(u64 value, u32 bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+static inline u64 read64(const u8* p) {
+    u64 value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline u32 read32(const u8* p) {
+    u32 value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline u64 hashRound(u64 acc, u64 input) {
+    acc += input * PRIME64_2;
+    acc  = rotl64(acc, 31);
+    return acc * PRIME64_1;
+}
+
+static inline u64 hashMerge(u64 acc, u64 value) {
+    acc ^= hashRound(0, value);
+    return acc * PRIME64_1 + PRIME64_4;
+}
+
+u64 hash64 (
+/*
+    SYNOPSIS
+        Computes a 64-bit hash of a buffer.
+
+    DESCRIPTION
+        Returns the XXH64 digest of 'size' bytes at 'data' with the given seed. Suitable
+        for detecting changed or identical files, not for anything security related.
+
+    EXAMPLE
+        u64 digest = hash64(png, pngsize, 0);
+*/
+    // Data to hash
+    const void* data,
+
+    // Size of the data in bytes
+    size_t size,
+
+    // Seed; different seeds give unrelated hashes
+    u64 seed
+) {
+    const u8* p   = (const u8*)data;
+    const u8* end = p + size;
+    u64 h;
+
+    if (size >= 32) {
+        u64 v1 = seed + PRIME64_1 + PRIME64_2;
+        u64 v2 = seed + PRIME64_2;
+        u64 v3 = seed;
+        u64 v4 = seed - PRIME64_1;
+
+        do {
+            v1 = hashRound(v1, read64(p));
+            v2 = hashRound(v2, read64(p + 8));
+            v3 = hashRound(v3, read64(p + 16));
+            v4 = hashRound(v4, read64(p + 24));
+            p += 32;
+        } while (p + 32 <= end);
+
+        h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+        h = hashMerge(h, v1);
+        h = hashMerge(h, v2);
+        h = hashMerge(h, v3);
+        h = hashMerge(h, v4);
+    } else {
+        h = seed + PRIME64_5;
+    }
+
+    h += (u64)size;
+
+    while (p + 8 <= end) {
+        h ^= hashRound(0, read64(p));
+        h  = rotl64(h, 27) * PRIME64_1 + PRIME64_4;
+        p += 8;
+    }
+    if (p + 4 <= end) {
+        h ^= (u64)read32(p) * PRIME64_1;
+        h  = rotl64(h, 23) * PRIME64_2 + PRIME64_3;
+        p += 4;
+    }
+    while (p < end) {
+        h ^= (u64)(*p) * PRIME64_5;
+        h  = rotl64(h, 11) * PRIME64_1;
+        p++;
+    }
+
+    // Final avalanche
+    h ^= h >> 33;
+    h *= PRIME64_2;
+    h ^= h >> 29;
+    h *= PRIME64_3;
+    h ^= h >> 32;
+
+    return h;
+}
@@ -0,0 +1,483 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "ioqueue.h"
+
+static bool ioCancelled(const IORequest* request) {
+    return request->cancel && atomic_load(request->cancel);
+}
+
+static void ioFinish (
+/*
+    SYNOPSIS
+        Gives a request its final state and wakes its waiter.
+
+    DESCRIPTION
+        The waiter may release the request as soon as the event is signalled, so it is
+        not touched afterwards.
+*/
+    // Queue that served the request
+    IOQueue* queue,
+
+    // Request that finished
+    IORequest* request,
+
+    // IO_DONE, IO_FAILED or IO_CANCELLED
+    IOState state
+) {
+    atomic_fetch_add(state == IO_CANCELLED ? &queue->cancelled : &queue->served, 1);
+    atomic_store(&request->state, state);
+    LightEvent_Signal(&request->done);
+}
+
+static void ioUnlink (
+/*
+    SYNOPSIS
+        Removes a request from the queue of its class. Called with the lock held.
+*/
+    // Queue holding the request
+    IOQueue* queue,
+
+    // Request to remove
+    IORequest* request,
+
+    // Request before it in the same class, NULL if it is the first
+    IORequest* previous
+) {
+    const IOPriority priority = request->priority;
+
+    if (previous) previous->next = request->next;
+    else queue->head[priority] = request->next;
+    if (queue->tail[priority] == request) queue->tail[priority] = previous;
+    request->next = NULL;
+}
+
+static int ioTake (
+/*
+    SYNOPSIS
+        Takes the next read to issue: the oldest request of the most urgent class, merged
+        with the queued requests adjacent to it.
+
+    DESCRIPTION
+        Requests cancelled through their flag are dropped on the way. A request is merged
+        when it reads the same file right before or after the run, as long as the run stays
+        within IO_MAX_COALESCE bytes; background requests are never merged into a more
+        urgent read, which would make it wait for them. Returns the number of requests in
+        'run', 0 if no class up to 'lowest' has any.
+*/
+    // Queue to take from
+    IOQueue* queue,
+
+    // Least urgent class to consider
+    IOPriority lowest,
+
+    // Receives the requests to serve with one read, at most IO_MAX_RUN
+    IORequest** run
+) {
+    int count = 0;
+
+    LightLock_Lock(&queue->lock);
+
+    for (int priority = 0; priority <= (int)lowest && !count; priority++) {
+        while (queue->head[priority] && !count) {
+            IORequest* request = queue->head[priority];
+            ioUnlink(queue, request, NULL);
+            if (ioCancelled(request)) {
+                ioFinish(queue, request, IO_CANCELLED);
+            } else {
+                run[count++] = request;
+            }
+        }
+    }
+
+    if (count) {
+        const IORequest* first = run[0];
+        u64 start = first->offset;
+        u64 end   = first->offset + first->size;
+        bool merged = true;
+
+        while (merged && count < IO_MAX_RUN) {
+            merged = false;
+            for (int priority = 0; priority < IO_PRIORITY_COUNT && !merged; priority++) {
+                if (priority == IO_PRIORITY_BACKGROUND && first->priority != IO_PRIORITY_BACKGROUND) break;
+
+                IORequest* previous = NULL;
+                for (IORequest* request = queue->head[priority]; request; previous = request, request = request->next) {
+                    if (request->file != first->file || ioCancelled(request)) continue;
+
+                    const bool after  = request->offset == end;
+                    const bool before = request->offset + request->size == start;
+                    if (!after && !before) continue;
+                    if ((after ? request->offset + request->size - start : end - request->offset) > IO_MAX_COALESCE) {
+                        continue;
+                    }
+
+                    ioUnlink(queue, request, previous);
+                    run[count++] = request;
+                    if (after) end = request->offset + request->size;
+                    else start = request->offset;
+                    merged = true;
+                    break;
+                }
+            }
+        }
+
+        for (int i = 0; i < count; i++) {
+            atomic_store(&run[i]->state, IO_READING);
+        }
+    }
+
+    LightLock_Unlock(&queue->lock);
+    return count;
+}
+
+static void ioServe(IOQueue* queue, IORequest** run, int count);
+
+static bool ioReadRange (
+/*
+    SYNOPSIS
+        Reads a range of a file into memory.
+
+    DESCRIPTION
+        With 'yield' the range is read in IO_BACKGROUND_CHUNK pieces, and every visible or
+        prefetch request queued in the meantime is served between two pieces. Stops early
+        at the end of the file. Returns false if the file service reports an error.
+*/
+    // Queue doing the read
+    IOQueue* queue,
+
+    // File to read
+    IOFile* file,
+
+    // Start of the range
+    u64 offset,
+
+    // Receives the bytes
+    u8* buffer,
+
+    // Bytes to read
+    u32 size,
+
+    // Receives the bytes actually read
+    u32* read,
+
+    // Let more urgent requests go first between pieces
+    bool yield
+) {
+    *read = 0;
+
+    while (*read < size) {
+        const u32 piece = yield && size - *read > IO_BACKGROUND_CHUNK ? IO_BACKGROUND_CHUNK : size - *read;
+        u32 got = 0;
+
+        atomic_fetch_add(&queue->reads, 1);
+        if (R_FAILED(FSFILE_Read(file->handle, &got, offset + *read, buffer + *read, piece))) return false;
+        *read += got;
+        if (got < piece) break;
+
+        IORequest* urgent[IO_MAX_RUN];
+        int count;
+        while (yield && *read < size && (count = ioTake(queue, IO_PRIORITY_PREFETCH, urgent))) {
+            ioServe(queue, urgent, count);
+        }
+    }
+
+    return true;
+}
+
+static void ioServe (
+/*
+    SYNOPSIS
+        Issues one read for a run of adjacent requests and completes them.
+
+    DESCRIPTION
+        A single request is read straight into its buffer. A merged run is read into a
+        temporary buffer spanning it and copied out, as the file service has no scattered
+        read; if that buffer cannot be allocated, the requests are read one by one.
+*/
+    // Queue doing the read
+    IOQueue* queue,
+
+    // Requests from ioTake
+    IORequest** run,
+
+    // Number of requests in 'run'
+    int count
+) {
+    // Sort by offset; runs are short
+    for (int i = 1; i < count; i++) {
+        IORequest* request = run[i];
+        int j = i;
+        for (; j > 0 && run[j - 1]->offset > request->offset; j--) {
+            run[j] = run[j - 1];
+        }
+        run[j] = request;
+    }
+
+    const u64 start = run[0]->offset;
+    const u64 end   = run[count - 1]->offset + run[count - 1]->size;
+    u8* buffer = count == 1 ? run[0]->buffer : malloc(end - start);
+    if (!buffer) {
+        for (int i = 0; i < count; i++) {
+            ioServe(queue, &run[i], 1);
+        }
+        return;
+    }
+
+    u32 read = 0;
+    const bool valid = ioReadRange(queue, run[0]->file, start, buffer, (u32)(end - start), &read,
+                                   run[0]->priority == IO_PRIORITY_BACKGROUND);
+
+    for (int i = 0; i < count; i++) {
+        IORequest* request = run[i];
+        const u64 skip = request->offset - start;
+        request->read = read > skip ? (u32)(read - skip < request->size ? read - skip : request->size) : 0;
+        if (count > 1) memcpy(request->buffer, buffer + skip, request->read);
+        ioFinish(queue, request, valid ? IO_DONE : IO_FAILED);
+    }
+
+    if (count > 1) free(buffer);
+}
+
+static void ioThread (
+/*
+    SYNOPSIS
+        Entry point of the I/O thread.
+
+    DESCRIPTION
+        Serves reads until none are queued, then sleeps on the wake event.
+*/
+    // Queue that owns the thread
+    void* arg
+) {
+    IOQueue* queue = (IOQueue*)arg;
+
+    while (!atomic_load(&queue->quit)) {
+        IORequest* run[IO_MAX_RUN];
+        const int count = ioTake(queue, IO_PRIORITY_BACKGROUND, run);
+
+        if (count) {
+            ioServe(queue, run, count);
+        } else {
+            LightEvent_Wait(&queue->wake);
+        }
+    }
+}
+
+IOQueue* ioQueueCreate (
+/*
+    SYNOPSIS
+        Starts an I/O thread that serves reads by priority.
+
+    DESCRIPTION
+        Any thread can queue reads, which are served oldest first within a class and by
+        class otherwise, so art on screen never waits behind prefetches or background
+        work that was queued earlier. The thread spends nearly all its time blocked in the
+        file service, so it runs one priority step above the caller to keep the SD card
+        busy. Returns NULL if the thread cannot be created.
+
+    EXAMPLE
+        IOQueue* io = ioQueueCreate();
+        Bundle* bundle = bundleOpen(COVER_BUNDLE_PATH, false, io);
+*/
+    void
+) {
+    IOQueue* queue = calloc(1, sizeof(IOQueue));
+    if (!queue) return NULL;
+
+    LightEvent_Init(&queue->wake, RESET_ONESHOT);
+    LightLock_Init(&queue->lock);
+    atomic_init(&queue->quit, false);
+    atomic_init(&queue->reads, 0);
+    atomic_init(&queue->served, 0);
+    atomic_init(&queue->cancelled, 0);
+
+    s32 priority = 0x30;
+    svcGetThreadPriority(&priority, CUR_THREAD_HANDLE);
+
+    queue->thread = threadCreate(ioThread, queue, IO_STACK_SIZE, priority - 1, -2, false);
+    if (!queue->thread) {
+        printf("error: cannot start the I/O thread\n");
+        free(queue);
+        return NULL;
+    }
+
+    return queue;
+}
+
+void ioQueueDestroy (
+/*
+    SYNOPSIS
+        Stops the I/O thread and cancels every request still queued.
+
+    DESCRIPTION
+        The read in progress is finished first.
+*/
+    // Queue to destroy, may be NULL
+    IOQueue* queue
+) {
+    if (!queue) return;
+
+    atomic_store(&queue->quit, true);
+    LightEvent_Signal(&queue->wake);
+    threadJoin(queue->thread, U64_MAX);
+    threadFree(queue->thread);
+
+    for (int priority = 0; priority < IO_PRIORITY_COUNT; priority++) {
+        while (queue->head[priority]) {
+            IORequest* request = queue->head[priority];
+            ioUnlink(queue, request, NULL);
+            ioFinish(queue, request, IO_CANCELLED);
+        }
+    }
+
+    free(queue);
+}
+
+bool ioOpen (
+/*
+    SYNOPSIS
+        Opens a file on the SD card for scheduled reads.
+
+    DESCRIPTION
+        The file is opened directly through the file system service, bypassing stdio, so
+        reads land in the caller's buffer with no intermediate copy. A relative path is
+        resolved against the working directory, the launcher's directory on the console;
+        an "sdmc:" prefix is accepted. Returns false if the file cannot be opened.
+
+    EXAMPLE
+        IOFile file;
+        if (ioOpen(&file, "images/covers.bundle")) {
+            // submit reads
+            ioClose(&file);
+        }
+*/
+    // Receives the open file
+    IOFile* file,
+
+    // Path of the file
+    const char* path
+) {
+    char full[256];
+    const char* colon = strchr(path, ':');
+    if (colon) path = colon + 1;
+
+    if (path[0] == '/') {
+        snprintf(full, sizeof(full), "%s", path);
+    } else {
+        char cwd[192];
+        if (!getcwd(cwd, sizeof(cwd))) return false;
+
+        const char* root = strchr(cwd, ':') ? strchr(cwd, ':') + 1 : cwd;
+        const size_t length = strlen(root);
+        snprintf(full, sizeof(full), "%s%s%s", root, length && root[length - 1] == '/' ? "" : "/", path);
+    }
+
+    if (R_FAILED(FSUSER_OpenFileDirectly(&file->handle, ARCHIVE_SDMC, fsMakePath(PATH_EMPTY, ""),
+                                         fsMakePath(PATH_ASCII, full), FS_OPEN_READ, 0))) {
+        return false;
+    }
+    if (R_FAILED(FSFILE_GetSize(file->handle, &file->size))) {
+        FSFILE_Close(file->handle);
+        return false;
+    }
+
+    return true;
+}
+
+void ioClose(IOFile* file) {
+    FSFILE_Close(file->handle);
+}
+
+void ioSubmit (
+/*
+    SYNOPSIS
+        Queues a read on the I/O thread.
+
+    DESCRIPTION
+        The caller fills in the file, range, buffer, priority and optional cancel flag;
+        the rest of the request is set up here. The request must stay valid until ioWait
+        returns for it. Can be called from any thread.
+
+    EXAMPLE
+        IORequest request = {0};
+        request.file     = &file;
+        request.offset   = entry->offset;
+        request.size     = size;
+        request.buffer   = buffer;
+        request.priority = IO_PRIORITY_VISIBLE;
+        ioSubmit(io, &request);
+        if (ioWait(&request) == IO_DONE && request.read == size) // use the buffer
+*/
+    // Queue to submit to
+    IOQueue* queue,
+
+    // Read to queue
+    IORequest* request
+) {
+    if ((int)request->priority < 0 || request->priority >= IO_PRIORITY_COUNT) {
+        request->priority = IO_PRIORITY_BACKGROUND;
+    }
+    request->read = 0;
+    request->next = NULL;
+    atomic_init(&request->state, IO_QUEUED);
+    LightEvent_Init(&request->done, RESET_STICKY);
+
+    LightLock_Lock(&queue->lock);
+    if (queue->tail[request->priority]) queue->tail[request->priority]->next = request;
+    else queue->head[request->priority] = request;
+    queue->tail[request->priority] = request;
+    LightLock_Unlock(&queue->lock);
+
+    LightEvent_Signal(&queue->wake);
+}
+
+bool ioCancel (
+/*
+    SYNOPSIS
+        Withdraws a queued read.
+
+    DESCRIPTION
+        A request that has not started is removed and completes as IO_CANCELLED. One that
+        is being read or has finished is left alone. Either way, ioWait must still be
+        called before the request is released.
+*/
+    // Queue the request was submitted to
+    IOQueue* queue,
+
+    // Request to withdraw
+    IORequest* request
+) {
+    bool found = false;
+
+    LightLock_Lock(&queue->lock);
+    IORequest* previous = NULL;
+    for (IORequest* queued = queue->head[request->priority]; queued; previous = queued, queued = queued->next) {
+        if (queued == request) {
+            ioUnlink(queue, request, previous);
+            ioFinish(queue, request, IO_CANCELLED);
+            found = true;
+            break;
+        }
+    }
+    LightLock_Unlock(&queue->lock);
+
+    return found;
+}
+
+IOState ioWait (
+/*
+    SYNOPSIS
+        Waits for a request to finish.
+
+    DESCRIPTION
+        Returns IO_DONE with the bytes read in request->read, IO_FAILED, or IO_CANCELLED
+        when it was dropped before it started.
+*/
+    // Request given to ioSubmit
+    IORequest* request
+) {
+    LightEvent_Wait(&request->done);
+    return (IOState)atomic_load(&request->state);
+}
@@ -0,0 +1,256 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "jobs.h"
+
+static bool jobDequePush(JobDeque* deque, Job* job) {
+    const int bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+    const int top    = atomic_load_explicit(&deque->top, memory_order_acquire);
+    if (bottom - top >= JOB_DEQUE_CAPACITY) return false;
+
+    atomic_store_explicit(&deque->slots[bottom & (JOB_DEQUE_CAPACITY - 1)], job, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+    return true;
+}
+
+static Job* jobDequePop (
+/*
+    SYNOPSIS
+        Takes the most recently pushed job. Owner only.
+
+    DESCRIPTION
+        Only the last remaining job can be contended by a thief; the compare-exchange on
+        'top' decides who gets it.
+*/
+    // Deque of the calling thread
+    JobDeque* deque
+) {
+    const int bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&deque->bottom, bottom, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    int top = atomic_load_explicit(&deque->top, memory_order_relaxed);
+
+    if (top > bottom) {
+        atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+        return NULL;
+    }
+
+    Job* job = atomic_load_explicit(&deque->slots[bottom & (JOB_DEQUE_CAPACITY - 1)], memory_order_relaxed);
+    if (top == bottom) {
+        if (!atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1, memory_order_seq_cst,
+                                                     memory_order_relaxed)) {
+            job = NULL; // A thief took it
+        }
+        atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+    }
+
+    return job;
+}
+
+static Job* jobDequeSteal (
+/*
+    SYNOPSIS
+        Takes the oldest job of another thread's deque.
+
+    DESCRIPTION
+        Returns NULL if the deque is empty or another thread won the race for the job.
+*/
+    // Deque to steal from
+    JobDeque* deque
+) {
+    int top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    const int bottom = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+    if (top >= bottom) return NULL;
+
+    Job* job = atomic_load_explicit(&deque->slots[top & (JOB_DEQUE_CAPACITY - 1)], memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1, memory_order_seq_cst,
+                                                 memory_order_relaxed)) {
+        return NULL;
+    }
+
+    return job;
+}
+
+static void jobRun(Job* job) {
+    job->func(job->arg);
+    atomic_fetch_sub_explicit(&job->group->pending, 1, memory_order_release);
+}
+
+static Job* jobFind (
+/*
+    SYNOPSIS
+        Finds work for a thread: its own deque first, then the others in turn.
+*/
+    // Job system to search
+    JobSystem* system,
+
+    // Deque owned by the calling thread
+    u32 index
+) {
+    Job* job = jobDequePop(&system->deques[index]);
+
+    for (u32 i = 1; !job && i <= system->workerCount; i++) {
+        job = jobDequeSteal(&system->deques[(index + i) % (system->workerCount + 1)]);
+    }
+
+    return job;
+}
+
+static void jobWorkerThread (
+/*
+    SYNOPSIS
+        Entry point of a worker thread.
+
+    DESCRIPTION
+        Runs jobs until there are none left, then sleeps on the wake event. The event is
+        cleared before checking once more, so a job submitted in between is never missed.
+*/
+    // JobWorker of this thread
+    void* arg
+) {
+    JobWorker* worker = (JobWorker*)arg;
+    JobSystem* system = worker->system;
+
+    while (!atomic_load(&system->quit)) {
+        Job* job = jobFind(system, worker->index);
+        if (job) {
+            jobRun(job);
+            continue;
+        }
+
+        LightEvent_Clear(&system->wake);
+        job = jobFind(system, worker->index);
+        if (job) {
+            jobRun(job);
+        } else if (!atomic_load(&system->quit)) {
+            LightEvent_Wait(&system->wake);
+        }
+    }
+}
+
+JobSystem* jobSystemCreate (
+/*
+    SYNOPSIS
+        Creates a job system owned by the calling thread.
+
+    DESCRIPTION
+        Starts up to 'maxWorkers' worker threads, one per core other than the application
+        core, each pinned to its core. On New 3DS the faster clock and L2 cache are enabled
+        and core 2 gets a worker; on every model the application is granted a share of the
+        system core so core 1 can run one too. Cores that cannot run a thread are skipped,
+        so on a single-core system every job runs on the owner thread inside jobWait.
+
+    EXAMPLE
+        JobSystem* jobs = jobSystemCreate(JOB_MAX_WORKERS);
+*/
+    // Upper bound on worker threads, at most JOB_MAX_WORKERS
+    u32 maxWorkers
+) {
+    JobSystem* system = calloc(1, sizeof(JobSystem));
+    if (!system) return NULL;
+
+    LightEvent_Init(&system->wake, RESET_STICKY);
+    atomic_init(&system->quit, false);
+    for (u32 i = 0; i <= JOB_MAX_WORKERS; i++) {
+        atomic_init(&system->deques[i].top, 0);
+        atomic_init(&system->deques[i].bottom, 0);
+    }
+
+    bool isNew3DS = false;
+    APT_CheckNew3DS(&isNew3DS);
+    if (isNew3DS) osSetSpeedupEnable(true);
+    APT_SetAppCpuTimeLimit(JOB_SYSCORE_TIME_LIMIT);
+
+    s32 priority = 0x30;
+    svcGetThreadPriority(&priority, CUR_THREAD_HANDLE);
+
+    if (maxWorkers > JOB_MAX_WORKERS) maxWorkers = JOB_MAX_WORKERS;
+    for (int core = 1; core <= JOB_MAX_WORKERS && system->workerCount < maxWorkers; core++) {
+        JobWorker* worker = &system->workers[system->workerCount];
+        worker->system = system;
+        worker->index  = system->workerCount + 1;
+
+        Thread thread = threadCreate(jobWorkerThread, worker, JOB_STACK_SIZE, priority, core, false);
+        if (thread) system->threads[system->workerCount++] = thread;
+    }
+
+    return system;
+}
+
+void jobSystemDestroy (
+/*
+    SYNOPSIS
+        Stops the worker threads and releases the job system.
+*/
+    // Job system to destroy, may be NULL
+    JobSystem* system
+) {
+    if (!system) return;
+
+    atomic_store(&system->quit, true);
+    LightEvent_Signal(&system->wake);
+    for (u32 i = 0; i < system->workerCount; i++) {
+        threadJoin(system->threads[i], U64_MAX);
+        threadFree(system->threads[i]);
+    }
+
+    free(system);
+}
+
+void jobSubmit (
+/*
+    SYNOPSIS
+        Queues a job on the owner's deque, where idle workers can steal it.
+
+    DESCRIPTION
+        Must be called on the thread that created the job system. The job and its group
+        must stay valid until jobWait returns for the group.
+
+    EXAMPLE
+        JobGroup group = {0};
+        Job job = { decodeCover, cover, &group };
+        jobSubmit(jobs, &job);
+        jobWait(jobs, &group);
+*/
+    // Job system owned by the calling thread
+    JobSystem* system,
+
+    // Job to run
+    Job* job
+) {
+    atomic_fetch_add_explicit(&job->group->pending, 1, memory_order_relaxed);
+
+    if (!jobDequePush(&system->deques[0], job)) {
+        jobRun(job);
+        return;
+    }
+
+    LightEvent_Signal(&system->wake);
+}
+
+void jobWait (
+/*
+    SYNOPSIS
+        Waits for every job of a group, working on jobs in the meantime.
+
+    DESCRIPTION
+        The owner thread takes its own jobs newest first while the workers steal the
+        oldest ones. Once nothing is left to run it yields until the last jobs held by
+        workers finish.
+*/
+    // Job system owned by the calling thread
+    JobSystem* system,
+
+    // Group to wait for
+    JobGroup* group
+) {
+    while (atomic_load_explicit(&group->pending, memory_order_acquire) > 0) {
+        Job* job = jobFind(system, 0);
+        if (job) {
+            jobRun(job);
+        } else {
+            svcSleepThread(100000);
+        }
+    }
+}
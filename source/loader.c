@@ -0,0 +1,302 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "etc1.h"
+#include "texcache.h"
+#include "loader.h"
+
+static void loaderRun (
+/*
+    SYNOPSIS
+        Loads a single cover on the loader thread.
+
+    DESCRIPTION
+        Tries the bundle first, then the pre-compressed cover and finally the PNG through
+        the texture cache. Everything ends up in heap memory; no GPU calls are made here.
+        A request cancelled before it gets here is skipped, and so is one whose bundle
+        reads were still queued when it was cancelled.
+*/
+    // Request to complete
+    LoaderJob* job
+) {
+    if (atomic_load(&job->cancel)) {
+        job->skipped = true;
+        return;
+    }
+
+    job->loaded = job->bundle && loadBundledTexture(job->bundle, (u32)job->id, job->priority, &job->cancel,
+                                                    &job->options, &job->data, allocateTextureData, NULL);
+
+    if (!job->loaded && atomic_load(&job->cancel)) {
+        freeTextureData(&job->data);
+        job->skipped = true;
+        return;
+    }
+
+    if (!job->loaded) {
+        freeTextureData(&job->data);
+        job->loaded = job->etcPath[0] && loadETC1Texture(job->etcPath, &job->data, allocateTextureData, NULL);
+    }
+
+    if (!job->loaded) {
+        freeTextureData(&job->data);
+        job->loaded = loadPNGCached(job->pngPath, &job->options, &job->data, allocateTextureData, NULL);
+    }
+
+    if (!job->loaded) freeTextureData(&job->data);
+}
+
+static void loaderRunJob(void* arg) {
+    loaderRun((LoaderJob*)arg);
+}
+
+static void loaderThread (
+/*
+    SYNOPSIS
+        Entry point of the loader thread.
+
+    DESCRIPTION
+        Sleeps on the wake event until requests arrive. Up to LOADER_BATCH_SIZE queued
+        requests are fanned out as one job each, so the workers on the other cores decode
+        covers in parallel with this thread, and all of them are joined before the results
+        are handed back in request order. The result queue has the same capacity as the
+        request queue and loaderRequest caps the number of requests in flight, so handing
+        a job back never fails.
+*/
+    // Loader that owns the thread
+    void* arg
+) {
+    Loader* loader = (Loader*)arg;
+    JobSystem* jobs = jobSystemCreate(JOB_MAX_WORKERS);
+    atomic_store(&loader->workers, jobs ? jobs->workerCount : 0);
+
+    while (!atomic_load(&loader->quit)) {
+        LoaderJob* batch[LOADER_BATCH_SIZE];
+        Job work[LOADER_BATCH_SIZE];
+        JobGroup group;
+        int count = 0;
+
+        atomic_init(&group.pending, 0);
+        while (count < LOADER_BATCH_SIZE && (batch[count] = spscPop(&loader->requests))) {
+            work[count] = (Job){ loaderRunJob, batch[count], &group };
+            if (jobs) jobSubmit(jobs, &work[count]);
+            else loaderRun(batch[count]);
+            count++;
+        }
+
+        if (!count) {
+            LightEvent_Wait(&loader->wake);
+            continue;
+        }
+
+        if (jobs) jobWait(jobs, &group);
+        for (int i = 0; i < count; i++) {
+            spscPush(&loader->results, batch[i]);
+        }
+    }
+
+    jobSystemDestroy(jobs);
+}
+
+Loader* loaderCreate (
+/*
+    SYNOPSIS
+        Starts a background loader thread.
+
+    DESCRIPTION
+        The thread runs one priority step below the caller on the same core, so it only
+        gets the CPU while the main thread waits for the GPU or vblank and never delays a
+        frame. It spreads decoding over the other cores with a job system. Returns NULL if
+        the thread cannot be created.
+
+    EXAMPLE
+        Loader* loader = loaderCreate();
+        loaderRequest(loader, 0, NULL, "images/game0.etc", "images/game0.png", &defaultTextureOptions,
+                      IO_PRIORITY_VISIBLE);
+*/
+    void
+) {
+    Loader* loader = calloc(1, sizeof(Loader));
+    if (!loader) return NULL;
+
+    spscInit(&loader->requests);
+    spscInit(&loader->results);
+    LightEvent_Init(&loader->wake, RESET_ONESHOT);
+    atomic_init(&loader->quit, false);
+    atomic_init(&loader->workers, 0);
+
+    s32 priority = 0x30;
+    svcGetThreadPriority(&priority, CUR_THREAD_HANDLE);
+
+    loader->thread = threadCreate(loaderThread, loader, LOADER_STACK_SIZE, priority + 1, -2, false);
+    if (!loader->thread) {
+        printf("error: cannot start the loader thread\n");
+        free(loader);
+        return NULL;
+    }
+
+    return loader;
+}
+
+void loaderDestroy (
+/*
+    SYNOPSIS
+        Stops the loader thread and releases everything still queued.
+
+    DESCRIPTION
+        Waits for the cover being loaded to finish. Results that were never polled are
+        released, including their texture data.
+*/
+    // Loader to destroy, may be NULL
+    Loader* loader
+) {
+    if (!loader) return;
+
+    atomic_store(&loader->quit, true);
+    LightEvent_Signal(&loader->wake);
+    threadJoin(loader->thread, U64_MAX);
+    threadFree(loader->thread);
+
+    LoaderJob* job;
+    while ((job = spscPop(&loader->requests))) {
+        free(job);
+    }
+    while ((job = spscPop(&loader->results))) {
+        freeTextureData(&job->data);
+        free(job);
+    }
+
+    free(loader);
+}
+
+bool loaderRequest (
+/*
+    SYNOPSIS
+        Queues a cover for loading on the loader thread.
+
+    DESCRIPTION
+        The result is returned by loaderPoll under 'id'. Returns false without queuing
+        anything if LOADER_MAX_PENDING requests are already in flight.
+
+    EXAMPLE
+        loaderRequest(loader, box->UID, bundle, "images/game0.etc", "images/game0.png", &options,
+                      IO_PRIORITY_PREFETCH);
+*/
+    // Loader to queue on
+    Loader* loader,
+
+    // Caller's key, returned with the result
+    int id,
+
+    // Bundle searched for the cover 'id' before the files, may be NULL. Shared with the loader thread.
+    Bundle* bundle,
+
+    // Pre-compressed cover tried first, may be NULL
+    const char* etcPath,
+
+    // PNG loaded through the texture cache if there is no usable pre-compressed cover
+    const char* pngPath,
+
+    // Texture format and dithering for the PNG
+    const TextureOptions* options,
+
+    // Class of the cover's reads on the bundle's I/O queue
+    IOPriority priority
+) {
+    if (loader->pending >= LOADER_MAX_PENDING) return false;
+
+    LoaderJob* job = calloc(1, sizeof(LoaderJob));
+    if (!job) return false;
+
+    job->id       = id;
+    job->bundle   = bundle;
+    job->options  = *options;
+    job->priority = priority;
+    atomic_init(&job->cancel, false);
+    snprintf(job->etcPath, sizeof(job->etcPath), "%s", etcPath ? etcPath : "");
+    snprintf(job->pngPath, sizeof(job->pngPath), "%s", pngPath);
+
+    if (!spscPush(&loader->requests, job)) {
+        free(job);
+        return false;
+    }
+
+    for (int i = 0; i < LOADER_MAX_PENDING; i++) {
+        if (!loader->inflight[i]) {
+            loader->inflight[i] = job;
+            break;
+        }
+    }
+    loader->pending++;
+    LightEvent_Signal(&loader->wake);
+    return true;
+}
+
+bool loaderCancel (
+/*
+    SYNOPSIS
+        Cancels a queued request.
+
+    DESCRIPTION
+        The request for 'id' is marked so the loader thread skips it when it gets to it.
+        A cover already being loaded is finished as usual. Either way the result is still
+        returned by loaderPoll, with 'cancelled' set when nothing was loaded. Returns
+        false if no request for 'id' is in flight.
+
+    EXAMPLE
+        // The carousel reversed; the cover ahead is not coming into view any more
+        loaderCancel(loader, aheadUID);
+*/
+    // Loader the request was queued on
+    Loader* loader,
+
+    // Caller's key of the request
+    int id
+) {
+    for (int i = 0; i < LOADER_MAX_PENDING; i++) {
+        if (loader->inflight[i] && loader->inflight[i]->id == id) {
+            atomic_store(&loader->inflight[i]->cancel, true);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool loaderPoll (
+/*
+    SYNOPSIS
+        Takes one finished load from the loader thread.
+
+    DESCRIPTION
+        Never blocks. Returns false if no load has finished since the last call. The
+        texture data in 'result' belongs to the caller.
+
+    EXAMPLE
+        LoaderResult result;
+        while (loaderPoll(loader, &result)) {
+            C2D_Image image = uploadTextureData(&result.data);
+            freeTextureData(&result.data);
+        }
+*/
+    // Loader to poll
+    Loader* loader,
+
+    // Finished load
+    LoaderResult* result
+) {
+    LoaderJob* job = spscPop(&loader->results);
+    if (!job) return false;
+
+    for (int i = 0; i < LOADER_MAX_PENDING; i++) {
+        if (loader->inflight[i] == job) loader->inflight[i] = NULL;
+    }
+
+    result->id        = job->id;
+    result->loaded    = job->loaded;
+    result->cancelled = job->skipped;
+    result->data      = job->data;
+    loader->pending--;
+
+    free(job);
+    return true;
+}
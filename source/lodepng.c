@@ -1259,24 +1259,96 @@ static unsigned getTreeInflateDynamic(HuffmanTree* tree_ll, HuffmanTree* tree_d,
   return error;
 }
 
-/*inflate a block with dynamic of fixed Huffman tree. btype must be 1 or 2.*/
-static unsigned inflateHuffmanBlock(ucvector* out, LodePNGBitReader* reader,
-                                    unsigned btype, size_t max_output_size) {
-  unsigned error = 0;
-  HuffmanTree tree_ll; /*the huffman tree for literal and length codes*/
-  HuffmanTree tree_d; /*the huffman tree for distance codes*/
+static unsigned update_adler32(unsigned adler, const unsigned char* data, unsigned len);
+
+/*Optional consumer of the inflated data. It lets the output window be trimmed while inflating, so the
+whole output never has to be held in memory. Used by lodepng_decode_rows.*/
+typedef struct InflateSink {
+  /*called with the current window, data[0] being output byte number 'discarded'. Must advance 'consumed'
+  past every byte it no longer needs. Returns error code.*/
+  unsigned (*drain)(struct InflateSink* sink, const unsigned char* data, size_t size);
+  size_t threshold; /*window size in bytes at which drain is called*/
+  size_t discarded; /*output bytes dropped from the front of the window*/
+  size_t consumed; /*output bytes the consumer is done with*/
+  unsigned adler; /*running adler32 of the discarded bytes*/
+} InflateSink;
+
+/*hands the window to the sink. Once the window reached the threshold, drops the consumed bytes except for the
+last 32K that LZ77 distances may still refer to*/
+static unsigned inflateDrain(ucvector* out, InflateSink* sink) {
+  size_t drop, i;
+  unsigned error = sink->drain(sink, out->data, out->size);
+  if(error) return error;
+  if(out->size < sink->threshold) return 0;
 
-  HuffmanTree_init(&tree_ll);
-  HuffmanTree_init(&tree_d);
+  drop = sink->consumed - sink->discarded;
+  if(out->size <= 32768) drop = 0;
+  else if(drop > out->size - 32768) drop = out->size - 32768;
+  if(drop == 0) return 0;
 
-  if(btype == 1) error = getTreeInflateFixed(&tree_ll, &tree_d);
-  else /*if(btype == 2)*/ error = getTreeInflateDynamic(&tree_ll, &tree_d, reader);
+  sink->adler = update_adler32(sink->adler, out->data, (unsigned)drop);
+  for(i = drop; i != out->size; ++i) out->data[i - drop] = out->data[i];
+  out->size -= drop;
+  sink->discarded += drop;
+  return 0;
+}
 
-  while(!error) /*decode all symbols until end reached, breaks at end code*/ {
+/*where an Inflater stopped*/
+#define INFLATE_HEADER 0 /*before a block header*/
+#define INFLATE_HUFFMAN 1 /*inside a block with fixed or dynamic Huffman trees*/
+#define INFLATE_STORED 2 /*inside a block without compression*/
+#define INFLATE_DONE 3 /*after the final block*/
+
+/*state of an inflate that can be suspended between symbols and resumed later, see inflateResume.
+All the compressed input must be available from the start.*/
+typedef struct Inflater {
+  LodePNGBitReader reader;
+  const LodePNGDecompressSettings* settings;
+  InflateSink* sink; /*optional*/
+  unsigned mode;
+  unsigned bfinal; /*whether the current block is the last one*/
+  HuffmanTree tree_ll; /*the huffman tree for literal and length codes of the current block*/
+  HuffmanTree tree_d; /*the huffman tree for distance codes of the current block*/
+  size_t stored_pos; /*byte position of the data of the current stored block not yet copied*/
+  size_t stored_left; /*bytes of the current stored block not yet copied*/
+} Inflater;
+
+static unsigned Inflater_init(Inflater* inflater, const unsigned char* in, size_t insize,
+                              const LodePNGDecompressSettings* settings, InflateSink* sink) {
+  lodepng_memset(inflater, 0, sizeof(*inflater));
+  inflater->settings = settings;
+  inflater->sink = sink;
+  inflater->mode = INFLATE_HEADER;
+  HuffmanTree_init(&inflater->tree_ll);
+  HuffmanTree_init(&inflater->tree_d);
+  return LodePNGBitReader_init(&inflater->reader, in, insize);
+}
+
+static void Inflater_cleanup(Inflater* inflater) {
+  HuffmanTree_cleanup(&inflater->tree_ll);
+  HuffmanTree_cleanup(&inflater->tree_d);
+  HuffmanTree_init(&inflater->tree_ll);
+  HuffmanTree_init(&inflater->tree_d);
+}
+
+/*the current block ended, continue with the next one or stop after the final one*/
+static void inflateEndBlock(Inflater* inflater) {
+  Inflater_cleanup(inflater);
+  inflater->mode = inflater->bfinal ? INFLATE_DONE : INFLATE_HEADER;
+}
+
+/*decode symbols of a block with dynamic or fixed Huffman tree until the end code, or until out reached 'limit'
+bytes. The trees must have been read.*/
+static unsigned inflateHuffmanBlock(ucvector* out, Inflater* inflater, size_t limit) {
+  unsigned error = 0;
+  LodePNGBitReader* reader = &inflater->reader;
+  size_t max_output_size = inflater->settings->max_output_size;
+
+  while(!error && out->size < limit) /*decode symbols until end reached, breaks at end code*/ {
     /*code_ll is literal, length or end code*/
     unsigned code_ll;
     ensureBits25(reader, 20); /* up to 15 for the huffman symbol, up to 5 for the length extra bits */
-    code_ll = huffmanDecodeSymbol(reader, &tree_ll);
+    code_ll = huffmanDecodeSymbol(reader, &inflater->tree_ll);
     if(code_ll <= 255) /*literal symbol*/ {
       if(!ucvector_resize(out, out->size + 1)) ERROR_BREAK(83 /*alloc fail*/);
       out->data[out->size - 1] = (unsigned char)code_ll;
@@ -1297,7 +1369,7 @@ static unsigned inflateHuffmanBlock(ucvector* out, LodePNGBitReader* reader,
 
       /*part 3: get distance code*/
       ensureBits32(reader, 28); /* up to 15 for the huffman symbol, up to 13 for the extra bits */
-      code_d = huffmanDecodeSymbol(reader, &tree_d);
+      code_d = huffmanDecodeSymbol(reader, &inflater->tree_d);
       if(code_d > 29) {
         if(code_d <= 31) {
           ERROR_BREAK(18); /*error: invalid distance code (30-31 are never used)*/
@@ -1331,6 +1403,7 @@ static unsigned inflateHuffmanBlock(ucvector* out, LodePNGBitReader* reader,
         lodepng_memcpy(out->data + start, out->data + backward, length);
       }
     } else if(code_ll == 256) {
+      inflateEndBlock(inflater);
       break; /*end code, break the loop*/
     } else /*if(code_ll == INVALIDSYMBOL)*/ {
       ERROR_BREAK(16); /*error: tried to read disallowed huffman symbol*/
@@ -1347,17 +1420,15 @@ static unsigned inflateHuffmanBlock(ucvector* out, LodePNGBitReader* reader,
     }
   }
 
-  HuffmanTree_cleanup(&tree_ll);
-  HuffmanTree_cleanup(&tree_d);
-
   return error;
 }
 
-static unsigned inflateNoCompression(ucvector* out, LodePNGBitReader* reader,
-                                     const LodePNGDecompressSettings* settings) {
+/*reads LEN and NLEN of a block without compression*/
+static unsigned inflateStoredHeader(Inflater* inflater) {
+  LodePNGBitReader* reader = &inflater->reader;
   size_t bytepos;
   size_t size = reader->size;
-  unsigned LEN, NLEN, error = 0;
+  unsigned LEN, NLEN;
 
   /*go to first boundary of byte*/
   bytepos = (reader->bp + 7u) >> 3u;
@@ -1368,44 +1439,87 @@ static unsigned inflateNoCompression(ucvector* out, LodePNGBitReader* reader,
   NLEN = (unsigned)reader->data[bytepos] + ((unsigned)reader->data[bytepos + 1] << 8u); bytepos += 2;
 
   /*check if 16-bit NLEN is really the one's complement of LEN*/
-  if(!settings->ignore_nlen && LEN + NLEN != 65535) {
+  if(!inflater->settings->ignore_nlen && LEN + NLEN != 65535) {
     return 21; /*error: NLEN is not one's complement of LEN*/
   }
 
-  if(!ucvector_resize(out, out->size + LEN)) return 83; /*alloc fail*/
-
-  /*read the literal data: LEN bytes are now stored in the out buffer*/
+  /*the literal data must be entirely in the in buffer*/
   if(bytepos + LEN > size) return 23; /*error: reading outside of in buffer*/
 
-  lodepng_memcpy(out->data + out->size - LEN, reader->data + bytepos, LEN);
-  bytepos += LEN;
+  inflater->stored_pos = bytepos;
+  inflater->stored_left = LEN;
+  inflater->mode = INFLATE_STORED;
+  return 0;
+}
+
+/*copies the literal data of a block without compression, until the block ends or out reached 'limit' bytes*/
+static unsigned inflateNoCompression(ucvector* out, Inflater* inflater, size_t limit) {
+  size_t length = inflater->stored_left;
 
-  reader->bp = bytepos << 3u;
+  if(out->size < limit && limit - out->size < length) length = limit - out->size;
+  if(!ucvector_resize(out, out->size + length)) return 83; /*alloc fail*/
+
+  lodepng_memcpy(out->data + out->size - length, inflater->reader.data + inflater->stored_pos, length);
+  inflater->stored_pos += length;
+  inflater->stored_left -= length;
+
+  if(inflater->stored_left == 0) {
+    inflater->reader.bp = inflater->stored_pos << 3u;
+    inflateEndBlock(inflater);
+  }
+
+  return 0;
+}
+
+/*inflates until out grew by at least 'budget' bytes (a block header or a symbol is never split, so it may grow a
+little more) or the final block ended, in which case the mode becomes INFLATE_DONE. Returns error code.*/
+static unsigned inflateResume(Inflater* inflater, ucvector* out, size_t budget) {
+  size_t max_output_size = inflater->settings->max_output_size;
+  InflateSink* sink = inflater->sink;
+  size_t limit = budget > (size_t)(-1) - out->size ? (size_t)(-1) : out->size + budget;
+  unsigned error = 0;
+
+  while(!error && inflater->mode != INFLATE_DONE && out->size < limit) {
+    /*blocks stop early when the window is due for draining*/
+    size_t stop = sink && sink->threshold < limit && sink->threshold > out->size ? sink->threshold : limit;
+    if(inflater->mode == INFLATE_HEADER) {
+      LodePNGBitReader* reader = &inflater->reader;
+      unsigned BTYPE;
+      if(!ensureBits9(reader, 3)) return 52; /*error, bit pointer will jump past memory*/
+      inflater->bfinal = readBits(reader, 1);
+      BTYPE = readBits(reader, 2);
+
+      if(BTYPE == 3) return 20; /*error: invalid BTYPE*/
+      else if(BTYPE == 0) error = inflateStoredHeader(inflater); /*no compression*/
+      else {
+        /*compression, BTYPE 01 or 10*/
+        if(BTYPE == 1) error = getTreeInflateFixed(&inflater->tree_ll, &inflater->tree_d);
+        else /*if(BTYPE == 2)*/ error = getTreeInflateDynamic(&inflater->tree_ll, &inflater->tree_d, reader);
+        inflater->mode = INFLATE_HUFFMAN;
+      }
+    }
+    else if(inflater->mode == INFLATE_STORED) error = inflateNoCompression(out, inflater, stop);
+    else error = inflateHuffmanBlock(out, inflater, stop);
+    if(!error && max_output_size && out->size > max_output_size) error = 109;
+    if(!error && sink && out->size >= sink->threshold) {
+      /*draining shrinks the window, the budget counts what was inflated*/
+      size_t size = out->size;
+      error = inflateDrain(out, sink);
+      limit -= size - out->size;
+    }
+  }
 
   return error;
 }
 
 static unsigned lodepng_inflatev(ucvector* out,
                                  const unsigned char* in, size_t insize,
-                                 const LodePNGDecompressSettings* settings) {
-  unsigned BFINAL = 0;
-  LodePNGBitReader reader;
-  unsigned error = LodePNGBitReader_init(&reader, in, insize);
-
-  if(error) return error;
+                                 const LodePNGDecompressSettings* settings, InflateSink* sink) {
+  Inflater inflater;
+  unsigned error = Inflater_init(&inflater, in, insize, settings, sink);
 
-  while(!BFINAL) {
-    unsigned BTYPE;
-    if(!ensureBits9(&reader, 3)) return 52; /*error, bit pointer will jump past memory*/
-    BFINAL = readBits(&reader, 1);
-    BTYPE = readBits(&reader, 2);
-
-    if(BTYPE == 3) return 20; /*error: invalid BTYPE*/
-    else if(BTYPE == 0) error = inflateNoCompression(out, &reader, settings); /*no compression*/
-    else error = inflateHuffmanBlock(out, &reader, BTYPE, settings->max_output_size); /*compression, BTYPE 01 or 10*/
-    if(!error && settings->max_output_size && out->size > settings->max_output_size) error = 109;
-    if(error) break;
-  }
+  if(!error) error = inflateResume(&inflater, out, (size_t)(-1));
+  Inflater_cleanup(&inflater);
 
   return error;
 }
@@ -1414,7 +1528,7 @@ unsigned lodepng_inflate(unsigned char** out, size_t* outsize,
                          const unsigned char* in, size_t insize,
                          const LodePNGDecompressSettings* settings) {
   ucvector v = ucvector_init(*out, *outsize);
-  unsigned error = lodepng_inflatev(&v, in, insize, settings);
+  unsigned error = lodepng_inflatev(&v, in, insize, settings, 0);
   *out = v.data;
   *outsize = v.size;
   return error;
@@ -1433,7 +1547,7 @@ static unsigned inflatev(ucvector* out, const unsigned char* in, size_t insize,
     }
     return error;
   } else {
-    return lodepng_inflatev(out, in, insize, settings);
+    return lodepng_inflatev(out, in, insize, settings, 0);
   }
 }
 
@@ -2171,10 +2285,8 @@ static unsigned adler32(const unsigned char* data, unsigned len) {
 
 #ifdef LODEPNG_COMPILE_DECODER
 
-static unsigned lodepng_zlib_decompressv(ucvector* out,
-                                         const unsigned char* in, size_t insize,
-                                         const LodePNGDecompressSettings* settings) {
-  unsigned error = 0;
+/*checks the 2-byte zlib header in front of the deflate data. Returns error code.*/
+static unsigned zlibCheckHeader(const unsigned char* in, size_t insize) {
   unsigned CM, CINFO, FDICT;
 
   if(insize < 2) return 53; /*error, size of zlib data too small*/
@@ -2199,6 +2311,14 @@ static unsigned lodepng_zlib_decompressv(ucvector* out,
       "The additional flags shall not specify a preset dictionary."*/
     return 26;
   }
+  return 0;
+}
+
+static unsigned lodepng_zlib_decompressv(ucvector* out,
+                                         const unsigned char* in, size_t insize,
+                                         const LodePNGDecompressSettings* settings) {
+  unsigned error = zlibCheckHeader(in, insize);
+  if(error) return error;
 
   error = inflatev(out, in + 2, insize - 2, settings);
   if(error) return error;
@@ -4753,17 +4873,13 @@ unsigned lodepng_inspect_chunk(LodePNGState* state, size_t pos,
   return error;
 }
 
-/*read a PNG, the result will be in the same color type as the PNG (hence "generic")*/
-static void decodeGeneric(unsigned char** out, unsigned* w, unsigned* h,
-                          LodePNGState* state,
-                          const unsigned char* in, size_t insize) {
+/*reads the chunks following the header into state and locates the compressed image data. A single IDAT
+chunk is referenced in place; several are concatenated into *idatcopy, which the caller must free.
+return value is error*/
+static unsigned decodeChunks(LodePNGState* state, const unsigned char* in, size_t insize,
+                             const unsigned char** idat, size_t* idatsize, unsigned char** idatcopy) {
   unsigned char IEND = 0;
   const unsigned char* chunk;
-  unsigned char* idat; /*the data from idat chunks, zlib compressed*/
-  size_t idatsize = 0;
-  unsigned char* scanlines = 0;
-  size_t scanlines_size = 0, expected_size = 0;
-  size_t outsize = 0;
 
   /*for unknown chunk order*/
   unsigned unknown = 0;
@@ -4771,26 +4887,13 @@ static void decodeGeneric(unsigned char** out, unsigned* w, unsigned* h,
   unsigned critical_pos = 1; /*1 = after IHDR, 2 = after PLTE, 3 = after IDAT*/
 #endif /*LODEPNG_COMPILE_ANCILLARY_CHUNKS*/
 
-
-  /* safe output values in case error happens */
-  *out = 0;
-  *w = *h = 0;
-
-  state->error = lodepng_inspect(w, h, state, in, insize); /*reads header and resets other parameters in state->info_png*/
-  if(state->error) return;
-
-  if(lodepng_pixel_overflow(*w, *h, &state->info_png.color, &state->info_raw)) {
-    CERROR_RETURN(state->error, 92); /*overflow possible due to amount of pixels*/
-  }
-
-  /*the input filesize is a safe upper bound for the sum of idat chunks size*/
-  idat = (unsigned char*)lodepng_malloc(insize);
-  if(!idat) CERROR_RETURN(state->error, 83); /*alloc fail*/
+  *idat = 0;
+  *idatsize = 0;
+  *idatcopy = 0;
 
   chunk = &in[33]; /*first byte of the first chunk after the header*/
 
-  /*loop through the chunks, ignoring unknown chunks and stopping at IEND chunk.
-  IDAT data is put at the start of the in buffer*/
+  /*loop through the chunks, ignoring unknown chunks and stopping at IEND chunk*/
   while(!IEND && !state->error) {
     unsigned chunkLength;
     const unsigned char* data; /*the data in the chunk*/
@@ -4820,10 +4923,21 @@ static void decodeGeneric(unsigned char** out, unsigned* w, unsigned* h,
     /*IDAT chunk, containing compressed image data*/
     if(lodepng_chunk_type_equals(chunk, "IDAT")) {
       size_t newsize;
-      if(lodepng_addofl(idatsize, chunkLength, &newsize)) CERROR_BREAK(state->error, 95);
+      if(lodepng_addofl(*idatsize, chunkLength, &newsize)) CERROR_BREAK(state->error, 95);
       if(newsize > insize) CERROR_BREAK(state->error, 95);
-      lodepng_memcpy(idat + idatsize, data, chunkLength);
-      idatsize += chunkLength;
+      if(*idatsize == 0) {
+        *idat = data; /*a lone IDAT chunk is inflated in place*/
+      } else {
+        if(!*idatcopy) {
+          /*the input filesize is a safe upper bound for the sum of idat chunks size*/
+          *idatcopy = (unsigned char*)lodepng_malloc(insize);
+          if(!*idatcopy) CERROR_BREAK(state->error, 83); /*alloc fail*/
+          lodepng_memcpy(*idatcopy, *idat, *idatsize);
+          *idat = *idatcopy;
+        }
+        lodepng_memcpy(*idatcopy + *idatsize, data, chunkLength);
+      }
+      *idatsize = newsize;
 #ifdef LODEPNG_COMPILE_ANCILLARY_CHUNKS
       critical_pos = 3;
 #endif /*LODEPNG_COMPILE_ANCILLARY_CHUNKS*/
@@ -4912,29 +5026,60 @@ static void decodeGeneric(unsigned char** out, unsigned* w, unsigned* h,
     state->error = 106; /* error: PNG file must have PLTE chunk if color type is palette */
   }
 
+  return state->error;
+}
+
+/*size of the filtered scanlines (including Adam7 reduced images) the IDAT data inflates to*/
+static size_t idatExpectedSize(unsigned w, unsigned h, const LodePNGInfo* info_png) {
+  size_t bpp = lodepng_get_bpp(&info_png->color);
+  size_t expected_size = 0;
+  if(info_png->interlace_method == 0) {
+    expected_size = lodepng_get_raw_size_idat(w, h, bpp);
+  } else {
+    /*Adam-7 interlaced: expected size is the sum of the 7 sub-images sizes*/
+    expected_size += lodepng_get_raw_size_idat((w + 7) >> 3, (h + 7) >> 3, bpp);
+    if(w > 4) expected_size += lodepng_get_raw_size_idat((w + 3) >> 3, (h + 7) >> 3, bpp);
+    expected_size += lodepng_get_raw_size_idat((w + 3) >> 2, (h + 3) >> 3, bpp);
+    if(w > 2) expected_size += lodepng_get_raw_size_idat((w + 1) >> 2, (h + 3) >> 2, bpp);
+    expected_size += lodepng_get_raw_size_idat((w + 1) >> 1, (h + 1) >> 2, bpp);
+    if(w > 1) expected_size += lodepng_get_raw_size_idat((w + 0) >> 1, (h + 1) >> 1, bpp);
+    expected_size += lodepng_get_raw_size_idat((w + 0), (h + 0) >> 1, bpp);
+  }
+  return expected_size;
+}
+
+/*read a PNG, the result will be in the same color type as the PNG (hence "generic")*/
+static void decodeGeneric(unsigned char** out, unsigned* w, unsigned* h,
+                          LodePNGState* state,
+                          const unsigned char* in, size_t insize) {
+  const unsigned char* idat; /*the data from idat chunks, zlib compressed*/
+  unsigned char* idatcopy = 0; /*holds the idat data if it is split over several chunks*/
+  size_t idatsize = 0;
+  unsigned char* scanlines = 0;
+  size_t scanlines_size = 0, expected_size = 0;
+  size_t outsize = 0;
+
+  /* safe output values in case error happens */
+  *out = 0;
+  *w = *h = 0;
+
+  state->error = lodepng_inspect(w, h, state, in, insize); /*reads header and resets other parameters in state->info_png*/
+  if(state->error) return;
+
+  if(lodepng_pixel_overflow(*w, *h, &state->info_png.color, &state->info_raw)) {
+    CERROR_RETURN(state->error, 92); /*overflow possible due to amount of pixels*/
+  }
+
+  decodeChunks(state, in, insize, &idat, &idatsize, &idatcopy);
+
   if(!state->error) {
     /*predict output size, to allocate exact size for output buffer to avoid more dynamic allocation.
     If the decompressed size does not match the prediction, the image must be corrupt.*/
-    if(state->info_png.interlace_method == 0) {
-      size_t bpp = lodepng_get_bpp(&state->info_png.color);
-      expected_size = lodepng_get_raw_size_idat(*w, *h, bpp);
-    } else {
-      size_t bpp = lodepng_get_bpp(&state->info_png.color);
-      /*Adam-7 interlaced: expected size is the sum of the 7 sub-images sizes*/
-      expected_size = 0;
-      expected_size += lodepng_get_raw_size_idat((*w + 7) >> 3, (*h + 7) >> 3, bpp);
-      if(*w > 4) expected_size += lodepng_get_raw_size_idat((*w + 3) >> 3, (*h + 7) >> 3, bpp);
-      expected_size += lodepng_get_raw_size_idat((*w + 3) >> 2, (*h + 3) >> 3, bpp);
-      if(*w > 2) expected_size += lodepng_get_raw_size_idat((*w + 1) >> 2, (*h + 3) >> 2, bpp);
-      expected_size += lodepng_get_raw_size_idat((*w + 1) >> 1, (*h + 1) >> 2, bpp);
-      if(*w > 1) expected_size += lodepng_get_raw_size_idat((*w + 0) >> 1, (*h + 1) >> 1, bpp);
-      expected_size += lodepng_get_raw_size_idat((*w + 0), (*h + 0) >> 1, bpp);
-    }
-
+    expected_size = idatExpectedSize(*w, *h, &state->info_png);
     state->error = zlib_decompress(&scanlines, &scanlines_size, expected_size, idat, idatsize, &state->decoder.zlibsettings);
   }
   if(!state->error && scanlines_size != expected_size) state->error = 91; /*decompressed size doesn't match prediction*/
-  lodepng_free(idat);
+  lodepng_free(idatcopy);
 
   if(!state->error) {
     outsize = lodepng_get_raw_size(*w, *h, &state->info_png.color);
@@ -4985,6 +5130,262 @@ unsigned lodepng_decode(unsigned char** out, unsigned* w, unsigned* h,
   return state->error;
 }
 
+#ifdef LODEPNG_COMPILE_ZLIB
+/*state of the scanlines while they are taken out of the inflater*/
+typedef struct RowDecoder {
+  InflateSink sink; /*must be first, the drain callback casts back to RowDecoder*/
+  const LodePNGState* state;
+  unsigned w, h;
+  size_t bytewidth; /*bytes per pixel for unfiltering, at least 1*/
+  size_t linebytes; /*bytes of a scanline, without the filter type byte*/
+  unsigned y; /*next row to unfilter*/
+  unsigned char* lines; /*two scanlines: the one being unfiltered and the previous one*/
+  unsigned char* line;
+  unsigned char* prevline; /*0 before the first row*/
+  unsigned char* rows; /*finished rows in the info_raw color type, waiting to be delivered*/
+  size_t rowbytes; /*bytes of one row in rows*/
+  unsigned group; /*rows per callback*/
+  unsigned count; /*rows currently in rows*/
+  unsigned convert; /*whether rows need color conversion*/
+  LodePNGRowCallback callback;
+  void* user;
+} RowDecoder;
+
+/*InflateSink drain: unfilters, converts and delivers every complete scanline in the window*/
+static unsigned rowDecoderDrain(InflateSink* sink, const unsigned char* data, size_t size) {
+  RowDecoder* decoder = (RowDecoder*)sink;
+
+  while(decoder->y < decoder->h && sink->consumed + 1 + decoder->linebytes <= sink->discarded + size) {
+    const unsigned char* scanline = &data[sink->consumed - sink->discarded];
+    unsigned char* row = &decoder->rows[decoder->count * decoder->rowbytes];
+    unsigned error = unfilterScanline(decoder->line, &scanline[1], decoder->prevline,
+                                      decoder->bytewidth, scanline[0], decoder->linebytes);
+    if(error) return error;
+
+    /*every scanline starts at a byte boundary, so a single row converts like a 1 pixel high image*/
+    if(decoder->convert) {
+      error = lodepng_convert(row, decoder->line, &decoder->state->info_raw, &decoder->state->info_png.color,
+                              decoder->w, 1);
+      if(error) return error;
+    } else {
+      lodepng_memcpy(row, decoder->line, decoder->rowbytes);
+    }
+
+    decoder->prevline = decoder->line;
+    decoder->line = decoder->line == decoder->lines ? &decoder->lines[decoder->linebytes] : decoder->lines;
+    sink->consumed += 1 + decoder->linebytes;
+    ++decoder->y;
+    ++decoder->count;
+
+    if(decoder->count == decoder->group || decoder->y == decoder->h) {
+      error = decoder->callback(decoder->user, decoder->rows, decoder->y - decoder->count, decoder->count, decoder->w);
+      if(error) return error;
+      decoder->count = 0;
+    }
+  }
+
+  return 0;
+}
+#endif /*LODEPNG_COMPILE_ZLIB*/
+
+struct LodePNGRowDecoder {
+#ifdef LODEPNG_COMPILE_ZLIB
+  RowDecoder rows; /*used when streaming*/
+  Inflater inflater;
+  ucvector window; /*inflated data not yet consumed, plus the 32K history*/
+  const unsigned char* idat; /*zlib stream of the image data*/
+  size_t idatsize;
+  unsigned char* idatcopy; /*holds the idat data if it is split over several chunks*/
+#endif /*LODEPNG_COMPILE_ZLIB*/
+  LodePNGState* state;
+  unsigned streaming; /*whether the image data is inflated step by step, else image holds the decoded image*/
+  unsigned char* image;
+  unsigned w, h;
+  unsigned y; /*next row of image to deliver*/
+  unsigned rows_per_call;
+  LodePNGRowCallback callback;
+  void* user;
+  unsigned done;
+};
+
+void lodepng_row_decoder_free(LodePNGRowDecoder* decoder) {
+  if(!decoder) return;
+#ifdef LODEPNG_COMPILE_ZLIB
+  Inflater_cleanup(&decoder->inflater);
+  lodepng_free(decoder->window.data);
+  lodepng_free(decoder->rows.lines);
+  lodepng_free(decoder->rows.rows);
+  lodepng_free(decoder->idatcopy);
+#endif /*LODEPNG_COMPILE_ZLIB*/
+  lodepng_free(decoder->image);
+  lodepng_free(decoder);
+}
+
+#ifdef LODEPNG_COMPILE_ZLIB
+/*prepares inflating the image data of a non-interlaced PNG straight into rows. Returns error code.*/
+static unsigned rowDecoderStart(LodePNGRowDecoder* decoder, const unsigned char* in, size_t insize, unsigned convert) {
+  LodePNGState* state = decoder->state;
+  RowDecoder* rows = &decoder->rows;
+  unsigned w = decoder->w, h = decoder->h;
+  unsigned bpp = lodepng_get_bpp(&state->info_png.color);
+  size_t expected_size, reserve;
+
+  if(lodepng_pixel_overflow(w, h, &state->info_png.color, &state->info_raw)) {
+    return 92; /*overflow possible due to amount of pixels*/
+  }
+
+  decodeChunks(state, in, insize, &decoder->idat, &decoder->idatsize, &decoder->idatcopy);
+  if(state->error) return state->error;
+  if(!state->decoder.color_convert) {
+    state->error = lodepng_color_mode_copy(&state->info_raw, &state->info_png.color);
+    if(state->error) return state->error;
+  }
+
+  rows->sink.drain = rowDecoderDrain;
+  rows->sink.adler = 1u;
+  rows->state = state;
+  rows->w = w;
+  rows->h = h;
+  rows->bytewidth = (bpp + 7u) / 8u;
+  rows->linebytes = lodepng_get_raw_size_idat(w, 1, bpp) - 1u;
+  rows->rowbytes = lodepng_get_raw_size(w, 1, convert ? &state->info_raw : &state->info_png.color);
+  rows->group = decoder->rows_per_call > h ? h : decoder->rows_per_call;
+  rows->convert = convert;
+  rows->callback = decoder->callback;
+  rows->user = decoder->user;
+  /*the 32K history stays in the window, so drop consumed data only after another 64K to keep the copying cheap*/
+  rows->sink.threshold = 3 * 32768 + 2 * (1 + rows->linebytes);
+
+  rows->lines = (unsigned char*)lodepng_malloc(2 * rows->linebytes);
+  rows->rows = (unsigned char*)lodepng_malloc(rows->group * rows->rowbytes);
+  if(!rows->lines || !rows->rows) return 83; /*alloc fail*/
+  rows->line = rows->lines;
+
+  /*reserve the whole window up front, small images then never reallocate it*/
+  expected_size = idatExpectedSize(w, h, &state->info_png);
+  reserve = expected_size < rows->sink.threshold + 258 ? expected_size : rows->sink.threshold + 258;
+  if(!ucvector_resize(&decoder->window, reserve)) return 83; /*alloc fail*/
+  decoder->window.size = 0;
+
+  state->error = zlibCheckHeader(decoder->idat, decoder->idatsize);
+  if(state->error) return state->error;
+  return Inflater_init(&decoder->inflater, decoder->idat + 2, decoder->idatsize - 2,
+                       &state->decoder.zlibsettings, &rows->sink);
+}
+
+/*inflates about 'budget' more bytes of image data and delivers the rows that became complete*/
+static unsigned rowDecoderStep(LodePNGRowDecoder* decoder, size_t budget) {
+  const LodePNGDecompressSettings* settings = &decoder->state->decoder.zlibsettings;
+  RowDecoder* rows = &decoder->rows;
+  unsigned error = inflateResume(&decoder->inflater, &decoder->window, budget);
+  if(!error) error = inflateDrain(&decoder->window, &rows->sink);
+  if(error || decoder->inflater.mode != INFLATE_DONE) return error;
+
+  if(rows->y != decoder->h ||
+     rows->sink.discarded + decoder->window.size != idatExpectedSize(decoder->w, decoder->h, &decoder->state->info_png)) {
+    return 91; /*decompressed size doesn't match prediction*/
+  }
+  if(!settings->ignore_adler32) {
+    unsigned ADLER32 = lodepng_read32bitInt(&decoder->idat[decoder->idatsize - 4]);
+    unsigned checksum = update_adler32(rows->sink.adler, decoder->window.data, (unsigned)(decoder->window.size));
+    if(checksum != ADLER32) return 58; /*error, adler checksum not correct, data must be corrupted*/
+  }
+  decoder->done = 1;
+  return 0;
+}
+#endif /*LODEPNG_COMPILE_ZLIB*/
+
+LodePNGRowDecoder* lodepng_row_decoder_new(unsigned* w, unsigned* h,
+                                           LodePNGState* state,
+                                           const unsigned char* in, size_t insize,
+                                           unsigned rows_per_call, LodePNGRowCallback callback, void* user) {
+  LodePNGRowDecoder* decoder;
+  unsigned convert;
+  *w = *h = 0;
+
+  state->error = lodepng_inspect(w, h, state, in, insize);
+  if(state->error) return 0;
+
+  convert = state->decoder.color_convert && !lodepng_color_mode_equal(&state->info_raw, &state->info_png.color);
+  if(convert && !(state->info_raw.colortype == LCT_RGB || state->info_raw.colortype == LCT_RGBA)
+     && !(state->info_raw.bitdepth == 8)) {
+    state->error = 56; /*unsupported color mode conversion*/
+    return 0;
+  }
+
+  decoder = (LodePNGRowDecoder*)lodepng_malloc(sizeof(LodePNGRowDecoder));
+  if(!decoder) {
+    state->error = 83; /*alloc fail*/
+    return 0;
+  }
+  lodepng_memset(decoder, 0, sizeof(*decoder));
+  decoder->state = state;
+  decoder->w = *w;
+  decoder->h = *h;
+  decoder->rows_per_call = rows_per_call ? rows_per_call : 1;
+  decoder->callback = callback;
+  decoder->user = user;
+
+#ifdef LODEPNG_COMPILE_ZLIB
+  if(state->info_png.interlace_method == 0 && !state->decoder.zlibsettings.custom_zlib
+     && !state->decoder.zlibsettings.custom_inflate) {
+    unsigned error;
+    decoder->streaming = 1;
+    error = rowDecoderStart(decoder, in, insize, convert);
+    if(error) {
+      state->error = error;
+      lodepng_row_decoder_free(decoder);
+      return 0;
+    }
+    return decoder;
+  }
+#endif /*LODEPNG_COMPILE_ZLIB*/
+
+  lodepng_decode(&decoder->image, w, h, state, in, insize);
+  if(state->error) {
+    lodepng_row_decoder_free(decoder);
+    return 0;
+  }
+  return decoder;
+}
+
+unsigned lodepng_row_decoder_step(LodePNGRowDecoder* decoder, size_t budget, unsigned* done) {
+  LodePNGState* state = decoder->state;
+  if(!decoder->done && !state->error) {
+#ifdef LODEPNG_COMPILE_ZLIB
+    if(decoder->streaming) state->error = rowDecoderStep(decoder, budget);
+    else
+#endif /*LODEPNG_COMPILE_ZLIB*/
+    {
+      /*the image is already decoded, deliver about 'budget' bytes of it*/
+      size_t rowbytes = lodepng_get_raw_size(decoder->w, 1, &state->info_raw);
+      size_t delivered = 0;
+      while(decoder->y < decoder->h && delivered < budget && !state->error) {
+        unsigned count = decoder->h - decoder->y;
+        if(count > decoder->rows_per_call) count = decoder->rows_per_call;
+        state->error = decoder->callback(decoder->user, &decoder->image[rowbytes * decoder->y], decoder->y, count, decoder->w);
+        decoder->y += count;
+        delivered += rowbytes * count;
+      }
+      if(decoder->y == decoder->h) decoder->done = 1;
+    }
+  }
+  *done = decoder->done;
+  return state->error;
+}
+
+unsigned lodepng_decode_rows(unsigned* w, unsigned* h,
+                             LodePNGState* state,
+                             const unsigned char* in, size_t insize,
+                             unsigned rows_per_call, LodePNGRowCallback callback, void* user) {
+  unsigned done = 0;
+  LodePNGRowDecoder* decoder = lodepng_row_decoder_new(w, h, state, in, insize, rows_per_call, callback, user);
+  if(!decoder) return state->error;
+  while(!done && !lodepng_row_decoder_step(decoder, (size_t)(-1), &done)) {}
+  lodepng_row_decoder_free(decoder);
+  return state->error;
+}
+
 unsigned lodepng_decode_memory(unsigned char** out, unsigned* w, unsigned* h, const unsigned char* in,
                                size_t insize, LodePNGColorType colortype, unsigned bitdepth) {
   unsigned error;
@@ -2,7 +2,21 @@
 #include <3ds.h>
 #include <citro2d.h>
 #include <stdlib.h>
-#include "lodepng.h"
+#include <math.h>
+#include <sys/stat.h>
+#include "texture.h"
+#include "etc1.h"
+#include "texcache.h"
+#include "atlas.h"
+#include "loader.h"
+#include "residency.h"
+#include "bundle.h"
+#include "ioqueue.h"
+#include "framebudget.h"
+#include "prefetch.h"
+#include "carousel.h"
+#include "tiledimage.h"
+#include "displaylist.h"
 
 // Screen dimensions
 #define TOP_SCREEN_WIDTH  400
@@ -11,36 +25,88 @@
 #define BOTTOM_SCREEN_HEIGHT 240
 
 // Box dimensions and carousel settings
-#define NUM_BOXES 5
+#define NUM_BOXES 5 // Titles in the library
 #define BOX_WIDTH 128
+#define BOX_HEIGHT 130
 #define BOX_SPACING 10
-#define totalWidth (NUM_BOXES * (BOX_WIDTH + BOX_SPACING))
 #define BOX_TOP_MARGIN 20 // Vertical spacing from top of the screen
+#define CULL_MARGIN 0 // Px beyond either edge of the top screen in which boxes are still drawn
+#define MAX_VISIBLE_BOXES ((TOP_SCREEN_WIDTH + 2 * CULL_MARGIN) / (BOX_WIDTH + BOX_SPACING) + 2) // Boxes drawn at most
 
 // Animation and interaction settings
 #define SCROLL_SPEED 4.0f // Speed of carousel animation
 #define SELECTION_THRESHOLD 10.0f // Proximity to center for selection
 #define OUTLINE_THICKNESS 3.0f // Thickness of the box outline
+#define RESIDENT_SLOTS_AROUND_SELECTION 2 // Covers kept loaded on each side of the selection
+#define COVER_MEMORY_BUDGET (512 * 1024) // Bytes of cover art kept in all, the slots around the selection included
+#define MAX_PREFETCHED_BOXES 4 // Boxes beyond the screen edge asked for ahead of the scrolling
+#define IDLE_REDRAW_INTERVAL 30 // Frames between redraws while nothing changes
+#define BACKDROP_PATH "images/backdrop.png" // Optional panorama behind the carousel, drawn at its own size
+#define BACKDROP_PARALLAX 0.25f // Px the backdrop scrolls per px the carousel scrolls, roughly
+#define BACKDROP_MIN_WIDTH (TOP_SCREEN_WIDTH / 4) // Narrower art is not loaded; it would take too many repeats
+
+// Commands the top screen's list records at most: a cover or placeholder per box drawn, and
+// the selected title's name. The bottom screen's list only holds its description.
+#define SCENE_TOP_COMMANDS (MAX_VISIBLE_BOXES + 1)
+#if SCENE_TOP_COMMANDS > DISPLAY_LIST_MAX_COMMANDS
+#error "The boxes drawn at most do not fit into a display list; raise DISPLAY_LIST_MAX_COMMANDS"
+#endif
+
+// Commands the backdrop records at most: its repeats across the top screen, times the tiles of
+// one repeat that fit on the screen
+#define BACKDROP_MAX_COMMANDS ((TOP_SCREEN_WIDTH / BACKDROP_MIN_WIDTH + 1) * \
+                               (TOP_SCREEN_WIDTH / TILED_IMAGE_TILE_SIZE + 2) * (TOP_SCREEN_HEIGHT / TILED_IMAGE_TILE_SIZE + 1))
+#if BACKDROP_MAX_COMMANDS > DISPLAY_LIST_MAX_COMMANDS
+#error "The backdrop does not fit into a display list; raise BACKDROP_MIN_WIDTH"
+#endif
 
 // Color definitions
 #define SELECTED_BOX_COLOR C2D_Color32(0x00, 0x00, 0x00, 0xFF) // Black
 #define GLOBAL_BACKGROUND_COLOR C2D_Color32(0x1A, 0x1A, 0x1A, 0xFF)
 #define GLOBAL_MAIN_TEXT_COLOR C2D_Color32(0x4C, 0xE4, 0x9D, 0xFF)
 #define GLOBAL_SECONDARY_TEXT_COLOR C2D_Color32(0xFF, 0xFF, 0xFF, 0xFF)
+#define PLACEHOLDER_BOX_COLOR C2D_Color32(0x2E, 0x2E, 0x2E, 0xFF) // Drawn until the cover art is loaded
 
 // Global variable for target position in carousel
 float target = -1;
 
-// Struct definition for Box
+// Struct definition for Box. Where a box is drawn follows from its index and the carousel's
+// scroll position (see carousel.h).
 typedef struct {
-    float x, y;
-    float width, height;
     int UID;
-    C2D_Image BoxArtObject;
     C2D_Text GameNameObject;
     C2D_Text GameDescriptionObject;
 } Box;
 
+// Boxes drawn in a frame against the size of the library. Only the boxes overlapping the top
+// screen are submitted, so the 2D objects and GPU commands a frame needs stay bounded however
+// many titles there are.
+typedef struct {
+    int drawn;  // Covers and placeholders submitted
+    int total;  // Boxes in the library
+} DrawStats;
+
+// Draw calls of both screens. They are recorded by layoutScene only when the carousel, the
+// selection or the resident covers changed, and submitted every frame.
+typedef struct {
+    DisplayList backdrop;      // Submitted to the top screen before 'top'
+    DisplayList top;
+    DisplayList bottom;
+    DrawStats   stats;         // Boxes in the top screen's list
+    bool        valid;         // Recorded at least once
+    bool        overflowed;    // A list was full once; reported the first time only
+    int         first;         // What the lists were recorded for
+    float       shift;
+    int         selection;
+    u32         coverChanges;
+} Scene;
+
+// Boxes that overlapped the top screen in the last frame, for prefetch hit accounting
+typedef struct {
+    int count;
+    int index[MAX_VISIBLE_BOXES];
+} ShownBoxes;
+
 // Struct definition for game database records
 typedef struct {
     int UID;
@@ -109,130 +175,23 @@ void DrawC2D_TextObject (
     );
 }
 
-u32 calculateTexturePosition (
-/*
-    SYNOPSIS
-        Calculates the position in the texture buffer for a given pixel coordinate.
-
-    DESCRIPTION
-        This function takes the x and y pixel coordinates and calculates the corresponding
-        position in the texture buffer. It is used for converting image data into a format
-        suitable for graphics rendering. The calculation involves bit manipulation to
-        efficiently determine the position in a linear texture buffer.
-
-    EXAMPLE
-        u32 position = calculateTexturePosition(10, 20);
-        // This will calculate the texture buffer position for the pixel at coordinates (10, 20).
-*/
-    // X coordinate of the pixel
-    u32 x, 
-    // Y coordinate of the pixel
-    u32 y
-) {
-    return ((((y >> 3) * (512 >> 3) + (x >> 3)) << 6) +
-            ((x & 1) | ((y & 1) << 1) | ((x & 2) << 1) | ((y & 2) << 2) |
-            ((x & 4) << 2) | ((y & 4) << 3))) * 4;
-}
-
-C2D_Image convertPNGToC2DImage (
-/*
-    SYNOPSIS
-        Converts a PNG image file to a C2D_Image format for rendering in a graphics application.
-
-    DESCRIPTION
-        Loads a PNG file specified by the filename, decodes it, and then converts the image
-        data into a C2D_Image format suitable for rendering. The function handles loading errors
-        and allocates necessary resources for the image conversion.
-
-    EXAMPLE
-        C2D_Image image = convertPNGToC2DImage("path/to/image.png");
-
-        Converts the PNG image at the specified path to a C2D_Image.
-*/
-    // Filename of the PNG image to be converted
-    const char* filename
-) {
-    unsigned error;
-    unsigned char* image;
-    unsigned width, height;
-    size_t pngsize;
-    LodePNGState state;
-
-    // Initialize the PNG state with RGBA color type
-    lodepng_state_init(&state);
-    state.info_raw.colortype = LCT_RGBA;
-
-    // Load the PNG file and handle any errors
-    error = lodepng_load_file(&image, &pngsize, filename);
-    if (error) {
-        printf("error %u: %s\n", error, lodepng_error_text(error));
-        return (C2D_Image){0}; // Return an empty image in case of error
-    }
-
-    // Decode the PNG file into raw image data
-    error = lodepng_decode(&image, &width, &height, &state, image, pngsize);
-    if (error) {
-        printf("error %u: %s\n", error, lodepng_error_text(error));
-        free(image); // Ensure to free the loaded image in case of error
-        return (C2D_Image){0}; // Return an empty image in case of error
-    }
-
-    // Create a C2D_Image and allocate memory for its texture
-    C2D_Image img;
-    img.tex = (C3D_Tex*)malloc(sizeof(C3D_Tex));
-
-    // Set up the sub-texture parameters based on image dimensions
-    Tex3DS_SubTexture subtex = {
-        (u16)width, (u16)height, 0.0f, 1.0f, 
-        width / 512.0f, 1.0f - (height / 512.0f)
-    };
-    img.subtex = &subtex;
-
-    // Initialize the texture with RGBA format and set filters
-    C3D_TexInit(img.tex, 512, 512, GPU_RGBA8);
-    C3D_TexSetFilter(img.tex, GPU_LINEAR, GPU_LINEAR);
-    img.tex->border = 0xFFFFFFFF;
-    C3D_TexSetWrap(img.tex, GPU_CLAMP_TO_BORDER, GPU_CLAMP_TO_BORDER);
-
-    // Convert the PNG image data to texture format
-    for (u32 x = 0; x < width && x < 512; x++) {
-        for (u32 y = 0; y < height && y < 512; y++) {
-            // Calculate destination and source positions for texture data
-            const u32 dstPos = calculateTexturePosition(x, y);
-            const u32 srcPos = (y * width + x) * 4;
-
-            // Assign the RGBA values to the texture
-            ((uint8_t *)img.tex->data)[dstPos + 0] = image[srcPos + 3];
-            ((uint8_t *)img.tex->data)[dstPos + 1] = image[srcPos + 2];
-            ((uint8_t *)img.tex->data)[dstPos + 2] = image[srcPos + 1];
-            ((uint8_t *)img.tex->data)[dstPos + 3] = image[srcPos + 0];
-        }
-    }
-
-    // Clean up the loaded image and PNG state
-    free(image);
-    lodepng_state_cleanup(&state);
-
-    return img; // Return the created C2D_Image
-}
-
 void initializeBoxes (
 /*
     SYNOPSIS
         Initializes the boxes in the carousel.
 
     DESCRIPTION
-        Sets the position, dimensions, and unique identifier (UID) for each box in the carousel.
-        Also loads the corresponding image and description for each box. This function is essential
-        for setting up the initial state of the carousel with all its boxes.
+        Sets the unique identifier (UID) for each box in the carousel and loads its name and
+        description; cover art is loaded on demand by the residency manager (see
+        updateCoverResidency), and positions come from the carousel's scroll model.
 
     PARAMETER boxes
         A pointer to an array of 'Box' structures. This array is filled with the initialized data for
-        each box, including position, dimensions, UID, image, and description.
+        each box, including UID and description.
 
     EXAMPLE
         Box boxes[NUM_BOXES];
-        initializeBoxes(boxes);
+        initializeBoxes(boxes, buffer);
 
         Initializes an array of boxes for the carousel.
 */
@@ -242,12 +201,6 @@ void initializeBoxes (
     C2D_TextBuf Buffer
 ) {
     for (int i = 0; i < NUM_BOXES; i++) {
-        // Set position and dimensions for each box
-        boxes[i].x = i * (BOX_WIDTH + BOX_SPACING);
-        boxes[i].y = BOX_TOP_MARGIN;
-        boxes[i].width  = 128;
-        boxes[i].height = 130;
-
         // Assign a unique UID to each box
         boxes[i].UID = i;
 
@@ -263,15 +216,141 @@ void initializeBoxes (
             }
         }
 
-        // Load the PNG image for the game
-        char filename[256];
-        sprintf(filename, "images/game%d.png", i);  // Assuming the images are named game0.png, game1.png, etc.
-        boxes[i].BoxArtObject          = convertPNGToC2DImage(filename);
         boxes[i].GameNameObject        = NewC2D_TextObject(gameName, Buffer);
         boxes[i].GameDescriptionObject = NewC2D_TextObject(gameDescription, Buffer);
     }
 }
 
+void coverPaths (
+/*
+    SYNOPSIS
+        Names the files a cover is loaded from.
+
+    DESCRIPTION
+        A cover baked into the romfs at build time (see COVER_MANIFEST in the Makefile) is
+        tried first, then the pre-compressed cover when the packer produced one, otherwise
+        the PNG is loaded through the texture cache. The PNG path stays for user-supplied
+        art. Used as the residency manager's ResidencyPaths.
+*/
+    // UID of the box
+    int UID,
+
+    // Path of the baked cover
+    char* t3xPath,
+
+    // Path of the pre-compressed cover
+    char* etcPath,
+
+    // Path of the PNG cover
+    char* pngPath,
+
+    // Size of the path buffers
+    size_t size
+) {
+    snprintf(t3xPath, size, "romfs:/gfx/cover%d.t3x", UID);
+    snprintf(etcPath, size, "images/game%d.etc", UID);
+    snprintf(pngPath, size, "images/game%d.png", UID);  // Assuming the images are named game0.png, game1.png, etc.
+}
+
+// Boxes whose covers updateCoverResidency asks for at most
+#define MAX_WANTED_BOXES (2 * RESIDENT_SLOTS_AROUND_SELECTION + 1 + MAX_PREFETCHED_BOXES)
+
+// Appends a box's UID to the wanted covers unless the box is listed already; in a small library
+// the same box comes up on both sides of the selection
+static void wantBox(const Box* boxes, int index, int* listed, int* wanted, int* count) {
+    for (int k = 0; k < *count; k++) {
+        if (listed[k] == index) return;
+    }
+    listed[*count]     = index;
+    wanted[(*count)++] = boxes[index].UID;
+}
+
+void updateCoverResidency (
+/*
+    SYNOPSIS
+        Keeps the cover art around the selection loaded.
+
+    DESCRIPTION
+        Finds the box closest to the center of the top screen and asks the residency manager
+        for it and the RESIDENT_SLOTS_AROUND_SELECTION boxes on either side, nearest first.
+        While the carousel scrolls, the boxes the prefetcher expects to come into view next
+        are asked for after those, so they are resident by the time they appear. When the
+        scroll direction reverses, the loads queued for the old direction are cancelled.
+        Covers further away stay loaded while they fit COVER_MEMORY_BUDGET and are evicted
+        least recently shown first, so a library of any size needs a fixed amount of memory.
+        Only the slots around the screen are looked at, never the whole library.
+
+    EXAMPLE
+        bool reversed = prefetchObserve(&prefetcher, dx);
+        updateCoverResidency(&carousel, &selection, boxes, covers, &prefetcher, reversed, &shown);
+*/
+    // Scroll position of the carousel
+    const Carousel* carousel,
+
+    // This frame's selection
+    const CarouselSelection* selection,
+
+    // Array of 'Box' structures
+    Box* boxes,
+
+    // Residency manager of the cover art
+    Residency* covers,
+
+    // Scroll prediction, updated with this frame's movement
+    Prefetcher* prefetcher,
+
+    // Whether the scroll direction reversed this frame
+    bool reversed,
+
+    // Boxes on screen in the last frame; updated to this frame's
+    ShownBoxes* shown
+) {
+    int wanted[MAX_WANTED_BOXES];
+    int listed[MAX_WANTED_BOXES];
+    int count = 0;
+
+    // The carousel wraps around, so neighbours are taken modulo the number of boxes
+    const int nearest = selection->nearest;
+    for (int distance = 0; distance <= RESIDENT_SLOTS_AROUND_SELECTION; distance++) {
+        wantBox(boxes, (nearest + distance) % NUM_BOXES, listed, wanted, &count);
+        wantBox(boxes, ((nearest - distance) % NUM_BOXES + NUM_BOXES) % NUM_BOXES, listed, wanted, &count);
+    }
+
+    // Then the boxes about to scroll into view from the side the carousel moves towards,
+    // nearest to the screen edge first. Their reads wait behind those of the covers around
+    // the selection.
+    CarouselSlot visible[MAX_VISIBLE_BOXES];
+    const int visibleCount = carouselVisible(carousel, visible, MAX_VISIBLE_BOXES);
+    const int around = count;
+
+    if (visibleCount > 0 && prefetcher->direction) {
+        const int side = prefetcher->direction;
+        int slot = side > 0 ? visible[visibleCount - 1].slot : visible[0].slot;
+
+        for (int prefetched = 0; prefetched < MAX_PREFETCHED_BOXES && prefetched < NUM_BOXES; prefetched++) {
+            slot += side;
+            const CarouselSlot next = carouselSlot(carousel, slot);
+            const float distance = side > 0 ? next.x - TOP_SCREEN_WIDTH : -(next.x + BOX_WIDTH);
+            if (!prefetchWanted(prefetcher, distance, side)) break;
+            wantBox(boxes, next.index, listed, wanted, &count);
+        }
+    }
+
+    residencyUpdate(covers, wanted, count, count - around);
+    if (reversed) residencyCancel(covers);
+
+    // Count the covers that came into view already resident
+    for (int i = 0; i < visibleCount; i++) {
+        bool wasShown = false;
+        for (int k = 0; k < shown->count; k++) wasShown = wasShown || shown->index[k] == visible[i].index;
+        if (!wasShown) {
+            prefetchRecord(prefetcher, residencyGet(covers, boxes[visible[i].index].UID).tex != NULL);
+        }
+    }
+    shown->count = visibleCount;
+    for (int i = 0; i < visibleCount; i++) shown->index[i] = visible[i].index;
+}
+
 void launchTitle (
 /*
     SYNOPSIS
@@ -331,125 +410,189 @@ int checkSelectedBoxReachedTarget (
         Determines which box in the carousel is currently "selected".
 
     DESCRIPTION
-        Iterates through each box to identify the one closest to the center of the top screen,
-        considering it as the "selected" box. Additionally, it checks if the selected box has
-        reached a specified target position.
+        Takes the box whose center is within SELECTION_THRESHOLD of the center of the top
+        screen from this frame's selection, considering it as the "selected" box. Additionally,
+        it checks if the selected box has reached a specified target position.
 
     EXAMPLE
-        Box boxes[NUM_BOXES];
-        initializeBoxes(boxes);
         float targetPosition = 100.0f; // Example target position
-        int selectedIndex = checkSelectedBoxReachedTarget(boxes, NUM_BOXES, &targetPosition);
+        int selectedIndex = checkSelectedBoxReachedTarget(&carousel, &selection, &targetPosition);
 
         Determines the selected box and checks if it has reached the target position.
 */
 
-    // Array of 'Box' structures representing the boxes on screen
-    Box* boxes, 
+    // Scroll position of the carousel
+    const Carousel* carousel,
 
-    // Number of boxes in the array
-    int numBoxes, 
+    // This frame's selection
+    const CarouselSelection* selection,
 
     // Pointer to the target position variable
     float* target
 ) {
-    int selectedIndex = -1; // Variable to hold the index of the selected box
-
-    // Loop through each box to find the one that is closest to the center of the top screen
-    for (int i = 0; i < numBoxes; i++) {
-        if (abs(boxes[i].x + boxes[i].width / 2 - TOP_SCREEN_WIDTH / 2) < SELECTION_THRESHOLD) {
-            selectedIndex = i; // Assign the index of the selected box
-            break;
-        }
-    }
+    int selectedIndex = selection->index; // Index of the selected box
 
     // Check if the selected box has reached the target position
-    if (selectedIndex != -1 && abs(boxes[selectedIndex].x - *target) < SCROLL_SPEED) {
+    if (selectedIndex != -1 && fabsf(carouselItemX(carousel, selectedIndex) - *target) < SCROLL_SPEED) {
         *target = -1; // Reset the target position if reached
     }
 
     return selectedIndex; // Return the index of the selected box
 }
 
-int drawCarousel(Box* boxes, C2D_TextBuf Buffer, bool drawTop) {
-    int selectedUID = -1; // Variable to hold the UID of the selected box
+bool sceneCurrent (
+/*
+    SYNOPSIS
+        Tells whether the scene still shows the current state.
 
-    // Loop through each box to render them and identify the selected box
-    for (int i = 0; i < NUM_BOXES; i++) {
-        if (drawTop) {
-            // Draw each box in the carousel only if drawing the top half
-            C2D_DrawImageAt(
-                boxes[i].BoxArtObject, 
-                boxes[i].x, 
-                boxes[i].y, 
-                0.5f, // Z depth
-                NULL, // Parameters (not used here)
-                1.0f, // Scale X
-                1.0f  // Scale Y
-            );
+    DESCRIPTION
+        The layout depends on nothing but the scroll position, the selection and which
+        covers are resident, so it only has to be recorded again when one of them changed.
+*/
+    // Scene laid out before
+    const Scene* scene,
+
+    // Scroll position of the carousel
+    const Carousel* carousel,
+
+    // This frame's selection
+    const CarouselSelection* selection,
+
+    // Residency manager of the cover art
+    const Residency* covers
+) {
+    return scene->valid && scene->first == carousel->first && scene->shift == carousel->shift &&
+           scene->selection == selection->index && scene->coverChanges == covers->changes;
+}
+
+void layoutScene (
+/*
+    SYNOPSIS
+        Records the draw calls of both screens into the scene's display lists.
+
+    DESCRIPTION
+        Replaces drawing the carousel once per screen: the visible boxes are laid out a
+        single time, into the top screen's list, and the selected box's description into
+        the bottom screen's. Boxes off the top screen (and its margin) are culled before
+        anything is recorded. Covers that are still loading get a placeholder; opaque
+        covers are recorded unblended and displayListSubmit draws them first.
+
+        The backdrop, when there is one, scrolls slower than the covers and repeats. It
+        goes round a whole number of times per trip through the library, so it does not
+        jump when the carousel wraps around. Only its tiles on screen are recorded, into a
+        list of its own so it can never crowd out the covers.
+
+        SCENE_TOP_COMMANDS and BACKDROP_MAX_COMMANDS are checked against the list size at
+        compile time. Should a list still fill up, the draw calls that do not fit are
+        dropped and the first time is reported.
+
+    EXAMPLE
+        if (!sceneCurrent(&scene, &carousel, &selection, covers)) {
+            layoutScene(&scene, &carousel, &selection, boxes, covers, &backdrop);
         }
+        C2D_SceneBegin(top);
+        displayListSubmit(&scene.backdrop);
+        displayListSubmit(&scene.top);
+*/
+    // Scene to record
+    Scene* scene,
 
-        // Check if the box is near the center of the screen
-        if (abs(boxes[i].x + boxes[i].width / 2 - TOP_SCREEN_WIDTH / 2) < SELECTION_THRESHOLD) {
-            selectedUID = boxes[i].UID; // Assign the UID of the selected box
-
-            if (drawTop) {
-                // Rendering logic for the top half of the carousel
-                float textScale  = 0.5f;
-                float textHeight = 10.0f;
-                float textWidth  = boxes[i].GameNameObject.width * textScale;
-
-                DrawC2D_TextObject(
-                    boxes[i].GameNameObject, 
-                    Buffer,  
-                    boxes[i].x + boxes[i].width / 2 - textWidth / 2, // X position
-                    boxes[i].y + boxes[i].height + textHeight, // Y position
-                    0.5f, // Z depth
-                    textScale, // Text scale
-                    textScale, // Text scale
-                    GLOBAL_MAIN_TEXT_COLOR
-                );
-            }
-            else {
-                // Rendering logic for the bottom half of the carousel
-                float textScale = 0.5f;
-                float textX     = 10.0f;
-                float textY     = 10.0f;
+    // Scroll position of the carousel
+    const Carousel* carousel,
 
-                C2D_Text description;
-                description = boxes[i].GameDescriptionObject;
+    // This frame's selection
+    const CarouselSelection* selection,
 
-                C2D_DrawText(&description, C2D_WithColor | C2D_WordWrap, textX, textY, 0.5f, textScale, textScale, GLOBAL_SECONDARY_TEXT_COLOR, BOTTOM_SCREEN_WIDTH / 2 - textX);    
-            }
+    // Array of 'Box' structures; the scene refers to their text objects
+    Box* boxes,
+
+    // Residency manager of the cover art
+    const Residency* covers,
+
+    // Panorama behind the carousel; empty when there is none
+    const TiledImage* backdrop
+) {
+    displayListClear(&scene->backdrop);
+    displayListClear(&scene->top);
+    displayListClear(&scene->bottom);
+    bool recorded = true;
+
+    // The main loop only keeps a backdrop at least BACKDROP_MIN_WIDTH wide, so the repeats
+    // stay within BACKDROP_MAX_COMMANDS
+    if (backdrop->tiles) {
+        const float length = carousel->count * carousel->pitch;
+        const float turns  = fmaxf(1.0f, roundf(length * BACKDROP_PARALLAX / backdrop->width));
+        const float offset = (carousel->first * carousel->pitch + carousel->shift) / length * turns * backdrop->width;
+
+        for (float x = -fmodf(offset, backdrop->width); recorded && x < TOP_SCREEN_WIDTH; x += backdrop->width) {
+            recorded = displayListTiledImage(&scene->backdrop, backdrop, x, 0.0f, 0.0f, TOP_SCREEN_WIDTH,
+                                             TOP_SCREEN_HEIGHT);
         }
     }
 
-    return selectedUID; // Return the UID of the selected box
-}
+    CarouselSlot visible[MAX_VISIBLE_BOXES];
+    const int visibleCount = carouselVisible(carousel, visible, MAX_VISIBLE_BOXES);
+    scene->stats.drawn = visibleCount;
+    scene->stats.total = carousel->count;
 
-void scrollCarousel(Box* boxes, bool scrollLeft) {
-    int selectedIndex = -1; // Variable to hold the index of the selected box
+    for (int i = 0; i < visibleCount; i++) {
+        const int UID = boxes[visible[i].index].UID;
+        C2D_Image cover = residencyGet(covers, UID);
 
-    // Find the selected box
-    for (int i = 0; i < NUM_BOXES; i++) {
-        if (abs(boxes[i].x + boxes[i].width / 2 - TOP_SCREEN_WIDTH / 2) < SELECTION_THRESHOLD) {
-            selectedIndex = i; // Assign the index of the selected box
-            break;
+        if (!cover.tex) {
+            // The cover is still loading
+            recorded &= displayListRect(&scene->top, visible[i].x, visible[i].y, 0.5f, BOX_WIDTH, BOX_HEIGHT,
+                                        PLACEHOLDER_BOX_COLOR);
+        }
+        else {
+            recorded &= displayListImage(&scene->top, cover, visible[i].x, visible[i].y, 0.5f,
+                                         !residencyOpaque(covers, UID));
         }
     }
 
-    // Move each box in the carousel
-    for (int i = 0; i < NUM_BOXES; i++) {
-        // Determine scroll direction and adjust position
-        boxes[i].x += (scrollLeft ? -SCROLL_SPEED : SCROLL_SPEED);
-
-        // Wrap around if a box moves past the edge
-        if (scrollLeft && (boxes[i].x + boxes[i].width < 0)) {
-            boxes[i].x += totalWidth; // Reset box position to the right
-        } else if (!scrollLeft && (boxes[i].x > totalWidth - BOX_WIDTH)) {
-            boxes[i].x -= totalWidth; // Reset box position to the left
-        }
+    // The text of the box resting near the center of the screen
+    const int i = selection->index;
+    if (i != -1) {
+        // Name under the box on the top screen
+        float textScale  = 0.5f;
+        float textHeight = 10.0f;
+        float textWidth  = boxes[i].GameNameObject.width * textScale;
+
+        recorded &= displayListText(
+            &scene->top,
+            &boxes[i].GameNameObject,
+            0, // No flags besides the color
+            carouselItemX(carousel, i) + BOX_WIDTH / 2 - textWidth / 2, // X position
+            carousel->top + BOX_HEIGHT + textHeight, // Y position
+            0.5f, // Z depth
+            textScale, // Text scale
+            GLOBAL_MAIN_TEXT_COLOR,
+            0.0f // No wrapping
+        );
+
+        // Description on the bottom screen
+        float textX = 10.0f;
+        float textY = 10.0f;
+
+        recorded &= displayListText(&scene->bottom, &boxes[i].GameDescriptionObject, C2D_WordWrap, textX, textY, 0.5f,
+                                    textScale, GLOBAL_SECONDARY_TEXT_COLOR, BOTTOM_SCREEN_WIDTH / 2 - textX);
+    }
+
+    if (!recorded && !scene->overflowed) {
+        printf("error: display list full, draw calls dropped\n");
+        scene->overflowed = true;
     }
+
+    scene->valid        = true;
+    scene->first        = carousel->first;
+    scene->shift        = carousel->shift;
+    scene->selection    = selection->index;
+    scene->coverChanges = covers->changes;
+}
+
+// APT hook noting that the screens have to be drawn again after the HOME menu or sleep
+static void onScreensLost(APT_HookType hook, void* param) {
+    if (hook == APTHOOK_ONRESTORE || hook == APTHOOK_ONWAKEUP) *(bool*)param = true;
 }
 
 // Execute the program
@@ -477,6 +620,9 @@ int main (
     C2D_Init(C2D_DEFAULT_MAX_OBJECTS);
     C2D_Prepare();
 
+    // Covers baked at build time live in the romfs; without one they are loaded from images/
+    romfsInit();
+
     // Uncomment for debugging
      //consoleInit(GFX_BOTTOM, NULL);
 
@@ -487,12 +633,77 @@ int main (
     // Initialize the text buffer for the bottom screen
     C2D_TextBuf carouselTextBuffer = C2D_TextBufNew(512);
 
+    // Pack the cover art into a shared atlas, with pages of each format the covers are decoded to
+    Atlas* coverAtlas = atlasCreate(ATLAS_PAGE_SIZE, TEXTURE_FORMAT_AUTO);
+
+    // The New 3DS has cores to spare for loading the cover art in the background. On the Old 3DS
+    // the covers are decoded on the main thread instead, in slices that fit into each frame.
+    bool isNew3DS = false;
+    APT_CheckNew3DS(&isNew3DS);
+    Loader* coverLoader = isNew3DS ? loaderCreate() : NULL;
+
+    // Reads from the SD card are scheduled by how soon the art is shown, so covers on screen never
+    // wait behind prefetches or cache rebuilds
+    IOQueue* coverIO = ioQueueCreate();
+
+    // Covers packed into a bundle are found through its index instead of a directory lookup per
+    // file; without one the loose images are used
+    Bundle* coverBundle = bundleOpen(COVER_BUNDLE_PATH, true, coverIO);
+
+    // Keep only the cover art around the selection in memory. Each cover is decoded to the
+    // format its alpha channel calls for and the atlas takes it as it is.
+    Residency* covers = residencyCreate(COVER_MEMORY_BUDGET, coverAtlas, coverLoader, coverBundle, coverPaths,
+                                        &defaultTextureOptions);
+
+    // A backdrop wider than a texture is kept at full resolution as a grid of tiles. Without
+    // the file the screen is only cleared to the background color.
+    static TiledImage backdrop;
+    struct stat backdropInfo;
+    if (!stat(BACKDROP_PATH, &backdropInfo) && loadTiledImageFile(&backdrop, BACKDROP_PATH, &defaultTextureOptions) &&
+        backdrop.width < BACKDROP_MIN_WIDTH) {
+        printf("error: backdrop %s is narrower than %d px\n", BACKDROP_PATH, BACKDROP_MIN_WIDTH);
+        freeTiledImage(&backdrop);
+    }
+
     // Initialize an array of boxes for the carousel
     Box boxes[NUM_BOXES];
     initializeBoxes(boxes, carouselTextBuffer);
 
+    // Scroll position of the carousel; box positions are derived from it
+    Carousel carousel;
+    carouselInit(&carousel, NUM_BOXES, BOX_WIDTH, BOX_HEIGHT, BOX_SPACING, BOX_TOP_MARGIN, TOP_SCREEN_WIDTH);
+    carousel.margin = CULL_MARGIN;
+
+    // Draw calls of both screens, recorded when what they show changes
+    static Scene scene;
+
+    // Frames since the last one drawn, and whether the HOME menu or sleep may have left other
+    // content on the screens
+    u32 idleFrames = 0;
+    bool screensLost = true;
+    aptHookCookie aptCookie;
+    aptHook(&aptCookie, onScreensLost, &screensLost);
+
+    // The box resting at the center of the top screen, derived once per frame for drawing,
+    // loading and launching alike
+    CarouselSelection selection;
+    carouselSelectionInit(&selection);
+
+    // Boxes on screen last frame, to tell covers scrolling into view apart
+    ShownBoxes shownBoxes = {0};
+
+    // Time each frame can spare for decoding covers, adapted to how busy the frames are
+    FrameBudget frameBudget;
+    frameBudgetInit(&frameBudget);
+
+    // Predicts the covers scrolling into view, counting its hits and misses
+    Prefetcher coverPrefetcher;
+    prefetchInit(&coverPrefetcher);
+
     // Main application loop
     while (aptMainLoop()) {
+        const u64 frameStart = svcGetSystemTick();
+
         // Scan the current input state
         hidScanInput();
 
@@ -501,49 +712,102 @@ int main (
         u32 kHeld = hidKeysHeld();
 
         // Scroll carousel left or right based on input
+        float scrolled = 0.0f;
         if (kHeld & KEY_DRIGHT) {
-            scrollCarousel(boxes, true);
+            carouselScroll(&carousel, -SCROLL_SPEED);
+            scrolled = -SCROLL_SPEED;
         } 
         else if (kHeld & KEY_DLEFT) {
-            scrollCarousel(boxes, false);
+            carouselScroll(&carousel, SCROLL_SPEED);
+            scrolled = SCROLL_SPEED;
         }
+        const bool reversed = prefetchObserve(&coverPrefetcher, scrolled);
+        carouselUpdateSelection(&selection, &carousel, SELECTION_THRESHOLD);
 
-        // Begin rendering the top screen
-        C3D_FrameBegin(C3D_FRAME_SYNCDRAW);
-        C2D_TargetClear(top, GLOBAL_BACKGROUND_COLOR);
-        C2D_SceneBegin(top);
-
-        // Draw the carousel and get the selected box's UID (true = top screen)
-        int selectedUID = drawCarousel(boxes, carouselTextBuffer, true);
+        // Load the cover art around the selection and pick up what the loader has finished.
+        // Without a loader, the covers are decoded for as long as the frame budget allows.
+        covers->timeSlice = coverLoader ? 0 : frameBudget.budgetUs;
+        const u64 sliceStart = svcGetSystemTick();
+        updateCoverResidency(&carousel, &selection, boxes, covers, &coverPrefetcher, reversed, &shownBoxes);
+        const u64 sliceTicks = svcGetSystemTick() - sliceStart;
 
-        // Begin rendering the bottom screen
-        C2D_SceneBegin(bot);
-        C2D_TargetClear(bot, GLOBAL_BACKGROUND_COLOR);
+        // Exit the application if 'START' button is pressed
+        if (kDown & KEY_START) {
+            break;
+        }
 
-        // Check for selected box and draw the bottom carousel (false = bottom screen)
-        //checkSelectedBoxReachedTarget(boxes, NUM_BOXES, &target);
-        drawCarousel(boxes, carouselTextBuffer, false);
+        // A frame is only drawn when something on the screens changed: a new layout, the launch
+        // message, a key press, or a return from the HOME menu. Otherwise one is still drawn every
+        // IDLE_REDRAW_INTERVAL frames.
+        const bool launching = (kHeld & KEY_A) && selection.index != -1;
+        bool redraw = kDown || launching || screensLost || idleFrames + 1 >= IDLE_REDRAW_INTERVAL;
 
-        // Launch game if 'A' button is pressed
-        if (kHeld & KEY_A) {
-            launchTitle(selectedUID);
+        // Lay out both screens, unless nothing they show has changed since the last frame
+        if (!sceneCurrent(&scene, &carousel, &selection, covers)) {
+            layoutScene(&scene, &carousel, &selection, boxes, covers, &backdrop);
+            redraw = true;
         }
 
-        // Exit the application if 'START' button is pressed
-        if (kDown & KEY_START) {
-            break;
+        u64 waitTicks;
+        if (redraw) {
+            idleFrames  = 0;
+            screensLost = false;
+
+            // Begin rendering the top screen. Waiting for the previous frame is not busy time.
+            const u64 waitStart = svcGetSystemTick();
+            C3D_FrameBegin(C3D_FRAME_SYNCDRAW);
+            waitTicks = svcGetSystemTick() - waitStart;
+            C2D_TargetClear(top, GLOBAL_BACKGROUND_COLOR);
+            C2D_SceneBegin(top);
+
+            // Draw the backdrop and the carousel
+            displayListSubmit(&scene.backdrop);
+            displayListSubmit(&scene.top);
+
+            // Begin rendering the bottom screen
+            C2D_SceneBegin(bot);
+            C2D_TargetClear(bot, GLOBAL_BACKGROUND_COLOR);
+
+            // Check for selected box and draw its description
+            //checkSelectedBoxReachedTarget(&carousel, &selection, &target);
+            displayListSubmit(&scene.bottom);
+
+            // Launch game if 'A' button is pressed
+            if (launching) {
+                launchTitle(boxes[selection.index].UID);
+            }
+
+            // End the frame
+            C2D_Flush();
+            C2D_TextBufClear(carouselTextBuffer);
+            C3D_FrameEnd(0);
+        }
+        else {
+            // The last frame stays on display and the GPU is left idle. The loop still runs
+            // once per VBlank, so input is read and covers keep loading as before.
+            idleFrames++;
+            const u64 waitStart = svcGetSystemTick();
+            gspWaitForVBlank();
+            waitTicks = svcGetSystemTick() - waitStart;
         }
 
-        // End the frame
-        C2D_Flush();
-        C2D_TextBufClear(carouselTextBuffer);
-        C3D_FrameEnd(0);
+        // Size the next frame's slice to the headroom this one left
+        frameBudgetUpdate(&frameBudget, ticksToMicroseconds(svcGetSystemTick() - frameStart - waitTicks),
+                          ticksToMicroseconds(sliceTicks));
     }
 
     // Clean up and deinitialize libraries
+    aptUnhook(&aptCookie);
+    loaderDestroy(coverLoader);
+    residencyDestroy(covers);
+    bundleClose(coverBundle);
+    ioQueueDestroy(coverIO);
+    atlasDestroy(coverAtlas);
+    freeTiledImage(&backdrop);
     C2D_TextBufDelete(carouselTextBuffer);
     C2D_Fini();
     C3D_Fini();
+    romfsExit();
     gfxExit();
     return 0;
 }
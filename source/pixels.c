@@ -0,0 +1,294 @@
+#include <string.h>
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+#include "pixels.h"
+
+// A pixel with R in the low byte (R,G,B,A in memory) in the requested order. Byte reversal
+// compiles to a single REV on the ARM11.
+static inline u32 orderPixel(u32 rgba, PixelOrder order) {
+    return order == PIXELS_ABGR ? __builtin_bswap32(rgba) : rgba;
+}
+
+static inline void storePixel(u8* out, u32 pixel) {
+    memcpy(out, &pixel, sizeof(pixel));
+}
+
+PixelLayout pixelLayoutFor (
+/*
+    SYNOPSIS
+        Tells whether rows in a PNG's own color mode can go through the conversion kernels.
+
+    DESCRIPTION
+        Only 8-bit samples are handled; lodepng keeps converting 16-bit and packed
+        sub-byte images, and color-keyed ones whose key turns pixels transparent.
+
+    EXAMPLE
+        lodepng_inspect(&width, &height, &state, png, pngsize);
+        if (pixelLayoutFor(&state.info_png.color) != PIXELS_UNSUPPORTED) {
+            // decode without color conversion
+        }
+*/
+    // Color mode of the PNG, from lodepng_inspect
+    const LodePNGColorMode* mode
+) {
+    if (mode->bitdepth != 8) return PIXELS_UNSUPPORTED;
+
+    switch (mode->colortype) {
+        case LCT_RGB:
+            return mode->key_defined ? PIXELS_UNSUPPORTED : PIXELS_RGB8;
+        case LCT_RGBA:
+            return PIXELS_RGBA8;
+        case LCT_GREY:
+            return mode->key_defined ? PIXELS_UNSUPPORTED : PIXELS_GRAY8;
+        case LCT_GREY_ALPHA:
+            return PIXELS_GRAY_ALPHA8;
+        case LCT_PALETTE:
+            return PIXELS_PALETTE8;
+        default:
+            return PIXELS_UNSUPPORTED;
+    }
+}
+
+void buildPixelPalette (
+/*
+    SYNOPSIS
+        Builds the lookup table palette pixels are converted through.
+
+    DESCRIPTION
+        Every one of the 256 entries is filled, so no index needs a bounds check. Entries
+        past the palette are opaque black, as lodepng decodes them.
+*/
+    // Receives 256 pixels
+    u32* lut,
+
+    // Color mode holding the palette (PLTE with tRNS alpha), R,G,B,A per entry
+    const LodePNGColorMode* mode,
+
+    // Byte order of the entries
+    PixelOrder order
+) {
+    const size_t count = mode->palette ? mode->palettesize : 0;
+
+    for (u32 i = 0; i < 256; i++) {
+        u32 rgba = 0xFF000000;
+        if (i < count) memcpy(&rgba, &mode->palette[i * 4], sizeof(rgba));
+        lut[i] = orderPixel(rgba, order);
+    }
+}
+
+#if defined(__SSSE3__)
+static u32 convertPixelsWide (
+/*
+    SYNOPSIS
+        Converts the bulk of a row with SSSE3 byte shuffles; returns the pixels done.
+
+    DESCRIPTION
+        Each step loads 16 bytes, scatters them into place with PSHUFB and ORs in the
+        constant alpha. Loads never read past the row. Palette lookups stay scalar.
+*/
+    PixelLayout layout,
+    PixelOrder order,
+    u8* out,
+    const u8* in,
+    u32 count
+) {
+    const bool abgr = order == PIXELS_ABGR;
+    const __m128i alpha = _mm_set1_epi32(abgr ? 0x000000FF : (int)0xFF000000);
+    u32 x = 0;
+
+    switch (layout) {
+        case PIXELS_RGBA8: {
+            const __m128i reverse = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+            for (; x + 4 <= count; x += 4) {
+                const __m128i pixels = _mm_loadu_si128((const __m128i*)(in + x * 4));
+                _mm_storeu_si128((__m128i*)(out + x * 4), abgr ? _mm_shuffle_epi8(pixels, reverse) : pixels);
+            }
+            break;
+        }
+        case PIXELS_RGB8: {
+            const __m128i shuffle = abgr
+                ? _mm_setr_epi8(-1, 2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9)
+                : _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+            // 16 bytes are loaded for 12, so stop while two more pixels follow
+            for (; x + 6 <= count; x += 4) {
+                const __m128i pixels = _mm_loadu_si128((const __m128i*)(in + x * 3));
+                _mm_storeu_si128((__m128i*)(out + x * 4), _mm_or_si128(_mm_shuffle_epi8(pixels, shuffle), alpha));
+            }
+            break;
+        }
+        case PIXELS_GRAY8: {
+            __m128i shuffle[4];
+            for (int k = 0; k < 4; k++) {
+                const char j = (char)(k * 4);
+                shuffle[k] = abgr
+                    ? _mm_setr_epi8(-1, j, j, j, -1, j + 1, j + 1, j + 1, -1, j + 2, j + 2, j + 2, -1, j + 3, j + 3, j + 3)
+                    : _mm_setr_epi8(j, j, j, -1, j + 1, j + 1, j + 1, -1, j + 2, j + 2, j + 2, -1, j + 3, j + 3, j + 3, -1);
+            }
+            for (; x + 16 <= count; x += 16) {
+                const __m128i pixels = _mm_loadu_si128((const __m128i*)(in + x));
+                for (int k = 0; k < 4; k++) {
+                    _mm_storeu_si128((__m128i*)(out + (x + k * 4) * 4),
+                                     _mm_or_si128(_mm_shuffle_epi8(pixels, shuffle[k]), alpha));
+                }
+            }
+            break;
+        }
+        case PIXELS_GRAY_ALPHA8: {
+            __m128i shuffle[2];
+            for (int k = 0; k < 2; k++) {
+                const char j = (char)(k * 8);
+                shuffle[k] = abgr
+                    ? _mm_setr_epi8(j + 1, j, j, j, j + 3, j + 2, j + 2, j + 2, j + 5, j + 4, j + 4, j + 4,
+                                    j + 7, j + 6, j + 6, j + 6)
+                    : _mm_setr_epi8(j, j, j, j + 1, j + 2, j + 2, j + 2, j + 3, j + 4, j + 4, j + 4, j + 5,
+                                    j + 6, j + 6, j + 6, j + 7);
+            }
+            for (; x + 8 <= count; x += 8) {
+                const __m128i pixels = _mm_loadu_si128((const __m128i*)(in + x * 2));
+                _mm_storeu_si128((__m128i*)(out + x * 4), _mm_shuffle_epi8(pixels, shuffle[0]));
+                _mm_storeu_si128((__m128i*)(out + x * 4 + 16), _mm_shuffle_epi8(pixels, shuffle[1]));
+            }
+            break;
+        }
+        default:
+            break;
+    }
+
+    return x;
+}
+#elif defined(__ARM_NEON)
+static u32 convertPixelsWide (
+/*
+    SYNOPSIS
+        Converts the bulk of a row with NEON structure loads; returns the pixels done.
+
+    DESCRIPTION
+        VLD2/VLD3 split 16 pixels into planes and VST4 interleaves them in the requested
+        order with the constant alpha. Palette lookups stay scalar.
+*/
+    PixelLayout layout,
+    PixelOrder order,
+    u8* out,
+    const u8* in,
+    u32 count
+) {
+    const bool abgr = order == PIXELS_ABGR;
+    const uint8x16_t opaque = vdupq_n_u8(0xFF);
+    u32 x = 0;
+
+    for (; layout != PIXELS_PALETTE8 && x + 16 <= count; x += 16) {
+        uint8x16_t r, g, b, a = opaque;
+        switch (layout) {
+            case PIXELS_RGBA8: {
+                const uint8x16x4_t pixels = vld4q_u8(in + x * 4);
+                r = pixels.val[0];
+                g = pixels.val[1];
+                b = pixels.val[2];
+                a = pixels.val[3];
+                break;
+            }
+            case PIXELS_RGB8: {
+                const uint8x16x3_t pixels = vld3q_u8(in + x * 3);
+                r = pixels.val[0];
+                g = pixels.val[1];
+                b = pixels.val[2];
+                break;
+            }
+            case PIXELS_GRAY8:
+                r = g = b = vld1q_u8(in + x);
+                break;
+            default: { // PIXELS_GRAY_ALPHA8
+                const uint8x16x2_t pixels = vld2q_u8(in + x * 2);
+                r = g = b = pixels.val[0];
+                a = pixels.val[1];
+                break;
+            }
+        }
+        const uint8x16x4_t result = abgr ? (uint8x16x4_t){ { a, b, g, r } } : (uint8x16x4_t){ { r, g, b, a } };
+        vst4q_u8(out + x * 4, result);
+    }
+
+    return x;
+}
+#else
+static u32 convertPixelsWide(PixelLayout layout, PixelOrder order, u8* out, const u8* in, u32 count) {
+    (void)layout; (void)order; (void)out; (void)in; (void)count;
+    return 0;
+}
+#endif
+
+void convertPixels (
+/*
+    SYNOPSIS
+        Converts decoded PNG pixels straight into 32-bit pixels of the requested byte order.
+
+    DESCRIPTION
+        Replaces lodepng's conversion to RGBA followed by a per-pixel byte reversal with a
+        single pass. The host build uses SSSE3 or NEON for the bulk of the row; the rest,
+        and everything on the console, goes a whole word at a time, with REV reversing the
+        bytes. Palette pixels are one table lookup each. 'out' may not overlap 'in'.
+
+    EXAMPLE
+        u32 palette[256];
+        buildPixelPalette(palette, &state.info_png.color, PIXELS_ABGR);
+        convertPixels(PIXELS_PALETTE8, PIXELS_ABGR, texels, row, width, palette);
+*/
+    // Layout of the source pixels
+    PixelLayout layout,
+
+    // Byte order to write
+    PixelOrder order,
+
+    // Receives 4 bytes per pixel
+    void* out,
+
+    // Source pixels
+    const u8* in,
+
+    // Number of pixels
+    u32 count,
+
+    // Lookup table from buildPixelPalette in the same order, for PIXELS_PALETTE8
+    const u32* palette
+) {
+    if (layout == PIXELS_UNSUPPORTED) return;
+
+    u8* dst = (u8*)out;
+    u32 x = convertPixelsWide(layout, order, dst, in, count);
+
+    switch (layout) {
+        case PIXELS_RGB8:
+            for (; x < count; x++) {
+                const u8* src = in + x * 3;
+                storePixel(dst + x * 4, orderPixel(src[0] | (u32)src[1] << 8 | (u32)src[2] << 16 | 0xFF000000, order));
+            }
+            break;
+        case PIXELS_RGBA8:
+            for (; x < count; x++) {
+                u32 rgba;
+                memcpy(&rgba, in + x * 4, sizeof(rgba));
+                storePixel(dst + x * 4, orderPixel(rgba, order));
+            }
+            break;
+        case PIXELS_GRAY8:
+            for (; x < count; x++) {
+                storePixel(dst + x * 4, orderPixel(in[x] * 0x010101u | 0xFF000000, order));
+            }
+            break;
+        case PIXELS_GRAY_ALPHA8:
+            for (; x < count; x++) {
+                storePixel(dst + x * 4, orderPixel(in[x * 2] * 0x010101u | (u32)in[x * 2 + 1] << 24, order));
+            }
+            break;
+        case PIXELS_PALETTE8:
+            for (; x < count; x++) {
+                storePixel(dst + x * 4, palette[in[x]]);
+            }
+            break;
+        default:
+            break;
+    }
+}
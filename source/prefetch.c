@@ -0,0 +1,115 @@
+#include <math.h>
+#include "prefetch.h"
+
+void prefetchInit (
+/*
+    SYNOPSIS
+        Prepares a prefetcher.
+
+    EXAMPLE
+        Prefetcher prefetcher;
+        prefetchInit(&prefetcher);
+*/
+    // Prefetcher to initialize
+    Prefetcher* prefetcher
+) {
+    prefetcher->velocity      = 0.0f;
+    prefetcher->direction     = 0;
+    prefetcher->lastDirection = 0;
+    prefetcher->leadFrames    = PREFETCH_LEAD_FRAMES;
+    prefetcher->hits          = 0;
+    prefetcher->misses        = 0;
+    prefetcher->reversals     = 0;
+}
+
+bool prefetchObserve (
+/*
+    SYNOPSIS
+        Tracks the scroll direction and velocity of the carousel.
+
+    DESCRIPTION
+        The velocity follows the movement over a few frames, so a single frame without
+        input does not drop the prefetch horizon to nothing. A movement against the last
+        direction is taken at once and reported as a reversal: the covers queued for the
+        old direction are no longer coming into view and the caller should cancel them.
+
+    EXAMPLE
+        if (prefetchObserve(&prefetcher, dx)) residencyCancel(covers);
+*/
+    // Prefetcher to update
+    Prefetcher* prefetcher,
+
+    // Movement of the carousel in the last frame in px; negative moves covers left
+    float dx
+) {
+    // Covers moving left come into view on the right
+    const int direction = dx < 0.0f ? 1 : dx > 0.0f ? -1 : 0;
+    const bool reversed = direction && prefetcher->lastDirection && direction != prefetcher->lastDirection;
+
+    if (reversed) {
+        prefetcher->velocity = dx;
+        prefetcher->reversals++;
+    } else {
+        prefetcher->velocity += (dx - prefetcher->velocity) / 4.0f;
+    }
+
+    if (fabsf(prefetcher->velocity) < PREFETCH_MIN_SPEED) {
+        prefetcher->direction = 0;
+    } else {
+        prefetcher->direction = prefetcher->velocity < 0.0f ? 1 : -1;
+    }
+    if (direction) prefetcher->lastDirection = direction;
+
+    return reversed;
+}
+
+bool prefetchWanted (
+/*
+    SYNOPSIS
+        Decides whether a cover outside the viewport should be requested now.
+
+    DESCRIPTION
+        A cover on the side the carousel scrolls in from is wanted once it is close
+        enough to enter the viewport within the lead time at the current speed. Nothing
+        is wanted while standing still or on the other side.
+
+    EXAMPLE
+        if (prefetchWanted(&prefetcher, box->x - TOP_SCREEN_WIDTH, 1)) wanted[count++] = box->UID;
+*/
+    // Prefetcher that tracks the scrolling
+    const Prefetcher* prefetcher,
+
+    // Distance between the cover and the viewport edge in px
+    float distance,
+
+    // Side of the viewport the cover is on: 1 right, -1 left
+    int side
+) {
+    if (!prefetcher->direction || side != prefetcher->direction) return false;
+
+    return distance <= fabsf(prefetcher->velocity) * prefetcher->leadFrames;
+}
+
+void prefetchRecord (
+/*
+    SYNOPSIS
+        Counts a cover entering the viewport as a hit or a miss.
+
+    DESCRIPTION
+        A miss means the cover was requested too late, so the lead grows by a frame up to
+        PREFETCH_MAX_LEAD_FRAMES; the hit and miss counts show how well the lead fits.
+*/
+    // Prefetcher to update
+    Prefetcher* prefetcher,
+
+    // Whether the cover was resident when it entered the viewport
+    bool resident
+) {
+    if (resident) {
+        prefetcher->hits++;
+        return;
+    }
+
+    prefetcher->misses++;
+    if (prefetcher->leadFrames < PREFETCH_MAX_LEAD_FRAMES) prefetcher->leadFrames++;
+}
@@ -0,0 +1,704 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lodepng.h"
+#include "etc1.h"
+#include "hash.h"
+#include "texcache.h"
+#include "framebudget.h"
+#include "residency.h"
+
+static ResidentTexture* residencyFind(const Residency* residency, int id) {
+    for (int i = 0; i < RESIDENCY_MAX_ENTRIES; i++) {
+        if (residency->entries[i].id == id) return (ResidentTexture*)&residency->entries[i];
+    }
+    return NULL;
+}
+
+static void residencyRelease (
+/*
+    SYNOPSIS
+        Drops the texture of an entry.
+
+    DESCRIPTION
+        The shared texture is only freed, and its memory given back to the budget, when
+        no other cover samples it any more.
+*/
+    // Manager that owns the entry
+    Residency* residency,
+
+    // Entry to release
+    ResidentTexture* entry
+) {
+    if (!entry->image.tex) return;
+
+    SharedTexture* texture = &residency->textures[entry->texture];
+    residency->changes++;
+    entry->image  = (C2D_Image){0};
+    entry->opaque = false;
+    if (--texture->refs > 0) return;
+
+    if (texture->packed) {
+        atlasRemove(residency->atlas, entry->texture);
+    } else {
+        freeC2DImage(&texture->image);
+    }
+
+    residency->used -= texture->bytes;
+    memset(texture, 0, sizeof(*texture));
+}
+
+static void residencyAttach (
+/*
+    SYNOPSIS
+        Makes an entry resident by sampling a shared texture.
+*/
+    // Manager that owns the entry
+    Residency* residency,
+
+    // Entry that is not resident
+    ResidentTexture* entry,
+
+    // Index of the shared texture
+    int index
+) {
+    SharedTexture* texture = &residency->textures[index];
+
+    texture->refs++;
+    if (entry->lastWanted > texture->lastWanted) texture->lastWanted = entry->lastWanted;
+
+    entry->texture = index;
+    entry->image   = texture->image;
+    entry->opaque  = texture->opacity == IMAGE_OPAQUE;
+    entry->hash    = texture->hash;
+    residency->loads++;
+    residency->changes++;
+}
+
+static bool residencyShare (
+/*
+    SYNOPSIS
+        Makes an entry resident with the texture of identical art, if one is resident.
+
+    DESCRIPTION
+        Returns false, leaving the entry alone, when 'hash' is unknown (0) or no resident
+        texture was made from art with that hash.
+*/
+    // Manager that owns the entry
+    Residency* residency,
+
+    // Entry to make resident
+    ResidentTexture* entry,
+
+    // Content hash of the entry's art
+    u64 hash
+) {
+    if (!hash) return false;
+
+    for (int i = 0; i < RESIDENCY_MAX_ENTRIES; i++) {
+        if (residency->textures[i].refs && residency->textures[i].hash == hash) {
+            residencyRelease(residency, entry);
+            residencyAttach(residency, entry, i);
+            residency->shared++;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void residencyStore (
+/*
+    SYNOPSIS
+        Makes loaded texture data resident.
+
+    DESCRIPTION
+        Shares the texture of identical art when one is resident. Otherwise copies the
+        data into the atlas, or into a texture of its own if it does not fit, and charges
+        its size to the budget. The data itself is not released.
+*/
+    // Manager that owns the entry
+    Residency* residency,
+
+    // Entry the data belongs to
+    ResidentTexture* entry,
+
+    // Loaded cover
+    const TextureData* data
+) {
+    residencyRelease(residency, entry);
+    if (residencyShare(residency, entry, data->sourceHash)) return;
+
+    int index = 0;
+    while (index < RESIDENCY_MAX_ENTRIES && residency->textures[index].refs) index++;
+    if (index == RESIDENCY_MAX_ENTRIES) return;
+
+    SharedTexture* texture = &residency->textures[index];
+    if (residency->atlas && atlasInsert(residency->atlas, index, data, &texture->image)) {
+        texture->packed = true;
+        texture->bytes  = (size_t)texture->image.subtex->width * texture->image.subtex->height *
+                          textureFormatBits(data->format) / 8;
+    } else {
+        texture->image  = uploadTextureData(data);
+        texture->packed = false;
+        texture->bytes  = texture->image.tex ? texture->image.tex->size : 0;
+    }
+
+    if (!texture->image.tex) {
+        memset(texture, 0, sizeof(*texture));
+        return;
+    }
+
+    texture->hash    = data->sourceHash;
+    texture->opacity = data->opacity;
+    residency->used += texture->bytes;
+    if (residency->used > residency->peak) residency->peak = residency->used;
+    residencyAttach(residency, entry, index);
+}
+
+static bool residencyLoad (
+/*
+    SYNOPSIS
+        Starts loading a cover that is not resident.
+
+    DESCRIPTION
+        A cover whose art is already resident for another cover shares its texture, and
+        one baked at build time is read right away, as neither needs decoding. Others are
+        queued on the loader, or loaded right away when there is no loader. With a time
+        slice and no loader the cover is only marked; residencyAdvance decodes it. Reads
+        from the bundle are scheduled at 'priority'. Returns false if the loader is
+        saturated; the cover is asked for again on the next update.
+*/
+    // Manager that owns the entry
+    Residency* residency,
+
+    // Entry to load
+    ResidentTexture* entry,
+
+    // IO_PRIORITY_VISIBLE for a cover on screen, IO_PRIORITY_PREFETCH for one expected soon
+    IOPriority priority
+) {
+    if (residencyShare(residency, entry, entry->hash)) return true;
+
+    char t3xPath[128] = "", etcPath[128] = "", pngPath[128] = "";
+    residency->paths(entry->id, t3xPath, etcPath, pngPath, sizeof(pngPath));
+
+    TextureData data = {0};
+    if (t3xPath[0] && loadT3XTexture(t3xPath, &data, allocateTextureData, NULL)) {
+        residencyStore(residency, entry, &data);
+        freeTextureData(&data);
+        return true;
+    }
+    freeTextureData(&data);
+
+    if (residency->loader) {
+        entry->loading = loaderRequest(residency->loader, entry->id, residency->bundle, etcPath, pngPath,
+                                       &residency->options, priority);
+        return entry->loading;
+    }
+    if (residency->timeSlice) {
+        entry->loading = true;
+        return true;
+    }
+
+    bool loaded = residency->bundle && loadBundledTexture(residency->bundle, (u32)entry->id, priority, NULL,
+                                                          &residency->options, &data, allocateTextureData, NULL);
+    if (!loaded) {
+        freeTextureData(&data);
+        loaded = etcPath[0] && loadETC1Texture(etcPath, &data, allocateTextureData, NULL);
+    }
+    if (!loaded) {
+        freeTextureData(&data);
+        loaded = loadPNGCached(pngPath, &residency->options, &data, allocateTextureData, NULL);
+    }
+    if (loaded) residencyStore(residency, entry, &data);
+    freeTextureData(&data);
+
+    return true;
+}
+
+static ResidentTexture* residencyAcquire (
+/*
+    SYNOPSIS
+        Returns the entry for 'id', creating it if needed.
+
+    DESCRIPTION
+        When the table is full the least recently wanted entry that is neither wanted now
+        nor waiting on the loader is evicted to make room. Returns NULL if every entry is
+        in use.
+*/
+    // Manager to search
+    Residency* residency,
+
+    // Caller's key
+    int id
+) {
+    ResidentTexture* entry = residencyFind(residency, id);
+    if (entry) return entry;
+
+    entry = residencyFind(residency, -1);
+    if (!entry) {
+        for (int i = 0; i < RESIDENCY_MAX_ENTRIES; i++) {
+            ResidentTexture* candidate = &residency->entries[i];
+            if (candidate->loading || candidate->lastWanted == residency->update) continue;
+            if (!entry || candidate->lastWanted < entry->lastWanted) entry = candidate;
+        }
+        if (!entry) return NULL;
+
+        if (entry->image.tex) residency->evictions++;
+        residencyRelease(residency, entry);
+    }
+
+    memset(entry, 0, sizeof(*entry));
+    entry->id = id;
+    return entry;
+}
+
+static void residencyReceive (
+/*
+    SYNOPSIS
+        Moves covers finished by the loader into textures.
+
+    DESCRIPTION
+        Takes at most RESIDENCY_UPLOADS_PER_UPDATE results with texture data; cancelled
+        ones cost nothing and do not count. Results for covers whose entry was recycled
+        while they were loading are dropped.
+*/
+    // Manager that queued the loads
+    Residency* residency
+) {
+    LoaderResult result;
+
+    for (int n = 0; n < RESIDENCY_UPLOADS_PER_UPDATE && residency->loader &&
+                    loaderPoll(residency->loader, &result);) {
+        ResidentTexture* entry = residencyFind(residency, result.id);
+
+        if (entry) {
+            entry->loading = false;
+            if (result.loaded) residencyStore(residency, entry, &result.data);
+        }
+
+        freeTextureData(&result.data);
+        if (!result.cancelled) n++;
+    }
+}
+
+static void residencyEndSlice (
+/*
+    SYNOPSIS
+        Finishes the sliced decode, making the cover resident if it completed.
+*/
+    // Manager that owns the decode
+    Residency* residency,
+
+    // Whether the decode completed and the cover should be stored
+    bool completed
+) {
+    ResidencySlice* slice = &residency->slice;
+    ResidentTexture* entry = residencyFind(residency, slice->id);
+
+    if (entry) {
+        entry->loading = false;
+        if (completed) residencyStore(residency, entry, &slice->data);
+    }
+
+    endPNGDecode(slice->decode);
+    if (slice->bundled) {
+        bundleRelease(residency->bundle, slice->png);
+    } else {
+        free((void*)slice->png);
+    }
+    freeTextureData(&slice->data);
+    slice->id      = -1;
+    slice->decode  = NULL;
+    slice->png     = NULL;
+    slice->hash    = 0;
+    slice->bundled = false;
+}
+
+static void residencyStartSlice (
+/*
+    SYNOPSIS
+        Starts the sliced load of a cover.
+
+    DESCRIPTION
+        Pre-compressed covers and current cache entries are read right away, as they need
+        no decoding. Otherwise the PNG is fetched, from the bundle when it holds the cover,
+        and hashed; art already resident for another cover is shared instead of decoded.
+        Failing that, its decode is set up for residencyAdvance to carry out over the
+        following updates.
+*/
+    // Manager that owns the entry
+    Residency* residency,
+
+    // Entry waiting to be loaded
+    ResidentTexture* entry
+) {
+    ResidencySlice* slice = &residency->slice;
+    Bundle* bundle = residency->bundle;
+    char t3xPath[sizeof(slice->pngPath)] = "", etcPath[sizeof(slice->pngPath)] = "";
+    residency->paths(entry->id, t3xPath, etcPath, slice->pngPath, sizeof(slice->pngPath));
+
+    const BundleEntry* bundled = bundle ? bundleFind(bundle, (u32)entry->id, BUNDLE_PNG) : NULL;
+    TextureData data = {0};
+    bool loaded = bundle && bundleFind(bundle, (u32)entry->id, BUNDLE_ETC1) &&
+                  loadBundledTexture(bundle, (u32)entry->id, IO_PRIORITY_VISIBLE, NULL, &residency->options, &data,
+                                     allocateTextureData, NULL);
+    if (!loaded && !bundled) {
+        freeTextureData(&data);
+        loaded = etcPath[0] && loadETC1Texture(etcPath, &data, allocateTextureData, NULL);
+        if (!loaded) {
+            freeTextureData(&data);
+            loaded = loadPNGCacheEntry(slice->pngPath, &residency->options, &data, allocateTextureData, NULL);
+        }
+    }
+    if (loaded) {
+        entry->loading = false;
+        residencyStore(residency, entry, &data);
+        freeTextureData(&data);
+        return;
+    }
+    freeTextureData(&data);
+
+    slice->id = entry->id;
+    if (bundled) {
+        bundleAssetName(bundle, (u32)entry->id, slice->pngPath, sizeof(slice->pngPath));
+        slice->bundled = true;
+        slice->png     = bundleAcquire(bundle, bundled, IO_PRIORITY_VISIBLE, NULL);
+        slice->pngSize = bundled->size;
+    } else {
+        unsigned char* png = NULL;
+        const unsigned error = lodepng_load_file(&png, &slice->pngSize, slice->pngPath);
+        slice->png = png;
+        if (error) printf("error %u: %s\n", error, lodepng_error_text(error));
+    }
+
+    if (slice->png) {
+        slice->hash = hash64(slice->png, slice->pngSize, 0);
+        if (residencyShare(residency, entry, slice->hash)) {
+            residencyEndSlice(residency, false);
+            return;
+        }
+    }
+    if (slice->png && slice->bundled &&
+        loadPNGBufferCacheEntry(slice->pngPath, slice->png, slice->pngSize, &residency->options, &slice->data,
+                                allocateTextureData, NULL)) {
+        residencyEndSlice(residency, true);
+        return;
+    }
+    freeTextureData(&slice->data);
+
+    if (slice->png) {
+        slice->decode = beginPNGDecode(slice->png, slice->pngSize, &residency->options, &slice->data,
+                                       allocateTextureData, NULL);
+    }
+    if (!slice->decode) residencyEndSlice(residency, false);
+}
+
+static void residencyAdvance (
+/*
+    SYNOPSIS
+        Decodes wanted covers for at most the time slice.
+
+    DESCRIPTION
+        Covers that stopped being wanted are dropped, including one halfway through its
+        decode. The decode in progress is continued, and when it completes the next wanted
+        cover waiting to be loaded is started, until the slice is used up. A finished
+        decode also refreshes the texture cache.
+*/
+    // Manager to advance
+    Residency* residency,
+
+    // Ids of the wanted covers, most important first
+    const int* wanted,
+
+    // Number of ids in 'wanted'
+    int count
+) {
+    ResidencySlice* slice = &residency->slice;
+    const u64 start = svcGetSystemTick();
+    const u64 budget = (u64)(residency->timeSlice * CPU_TICKS_PER_USEC);
+
+    for (int i = 0; i < RESIDENCY_MAX_ENTRIES; i++) {
+        ResidentTexture* entry = &residency->entries[i];
+        if (!entry->loading || entry->lastWanted == residency->update) continue;
+
+        if (entry->id == slice->id) {
+            residencyEndSlice(residency, false);
+        } else {
+            entry->loading = false;
+        }
+    }
+
+    for (u64 elapsed = 0; elapsed < budget; elapsed = svcGetSystemTick() - start) {
+        if (slice->id < 0) {
+            ResidentTexture* next = NULL;
+            for (int i = 0; i < count && !next; i++) {
+                ResidentTexture* entry = residencyFind(residency, wanted[i]);
+                if (entry && entry->loading) next = entry;
+            }
+            if (!next) return;
+
+            residencyStartSlice(residency, next);
+            continue;
+        }
+
+        const PNGDecodeStatus status = advancePNGDecode(slice->decode, ticksToMicroseconds(budget - elapsed));
+        if (status == PNG_DECODE_PENDING) return;
+
+        slice->data.sourceHash = slice->hash;
+        if (status == PNG_DECODE_DONE && slice->bundled) {
+            storePNGBufferCacheEntry(slice->pngPath, &residency->options, &slice->data, slice->png, slice->pngSize);
+        } else if (status == PNG_DECODE_DONE) {
+            storePNGCacheEntry(slice->pngPath, &residency->options, &slice->data, slice->png, slice->pngSize);
+        }
+        residencyEndSlice(residency, status == PNG_DECODE_DONE);
+    }
+}
+
+static void residencyEvict (
+/*
+    SYNOPSIS
+        Evicts least recently wanted covers until the budget is met.
+
+    DESCRIPTION
+        Works on shared textures: every cover sampling the victim is released together,
+        since dropping only some of them would free no memory. Textures of covers wanted
+        by the current update are never evicted, so the budget can be exceeded when the
+        wanted set alone does not fit.
+*/
+    // Manager to trim
+    Residency* residency
+) {
+    while (residency->used > residency->budget) {
+        int victim = -1;
+
+        for (int i = 0; i < RESIDENCY_MAX_ENTRIES; i++) {
+            const SharedTexture* texture = &residency->textures[i];
+            if (!texture->refs || texture->lastWanted == residency->update) continue;
+            if (victim < 0 || texture->lastWanted < residency->textures[victim].lastWanted) victim = i;
+        }
+        if (victim < 0) return;
+
+        for (int i = 0; i < RESIDENCY_MAX_ENTRIES; i++) {
+            ResidentTexture* entry = &residency->entries[i];
+            if (!entry->image.tex || entry->texture != victim) continue;
+
+            residencyRelease(residency, entry);
+            residency->evictions++;
+        }
+    }
+}
+
+Residency* residencyCreate (
+/*
+    SYNOPSIS
+        Creates a texture residency manager for cover art.
+
+    DESCRIPTION
+        Covers are keyed by the caller's id and loaded on demand from 'bundle' when it holds
+        them, otherwise from the files named by 'paths'. Covers go into 'atlas' when it is
+        given and they fit, otherwise into textures of their own. Covers whose art has the
+        same content hash share one texture. With a loader they are loaded in the
+        background. Without one, residencyUpdate decodes them for at most timeSlice
+        microseconds per call, or loads them at once when timeSlice is 0 (the default).
+
+    EXAMPLE
+        Residency* covers = residencyCreate(512 * 1024, atlas, loader, bundle, coverPaths, &defaultTextureOptions);
+*/
+    // Bytes of cover textures to keep resident in all, the wanted ones included; exceeded
+    // only while the wanted covers alone need more
+    size_t budget,
+
+    // Atlas the covers are packed into, may be NULL
+    Atlas* atlas,
+
+    // Background loader, may be NULL
+    Loader* loader,
+
+    // Bundle of cover art searched before the files, may be NULL
+    Bundle* bundle,
+
+    // Maps an id to the files its cover is loaded from
+    ResidencyPaths paths,
+
+    // Texture format and dithering for PNG covers; with TEXTURE_FORMAT_AUTO each cover gets
+    // the format textureFormatFor picks for its alpha channel
+    const TextureOptions* options
+) {
+    Residency* residency = calloc(1, sizeof(Residency));
+    if (!residency) return NULL;
+
+    residency->budget  = budget;
+    residency->options = *options;
+    residency->paths   = paths;
+    residency->atlas   = atlas;
+    residency->loader  = loader;
+    residency->bundle  = bundle;
+    residency->slice.id = -1;
+
+    for (int i = 0; i < RESIDENCY_MAX_ENTRIES; i++) {
+        residency->entries[i].id = -1;
+    }
+
+    return residency;
+}
+
+void residencyDestroy (
+/*
+    SYNOPSIS
+        Releases every resident cover and the manager.
+
+    DESCRIPTION
+        Covers packed into the atlas are removed from it. The loader is not destroyed;
+        destroy it first so no result arrives for a released entry.
+*/
+    // Manager to destroy, may be NULL
+    Residency* residency
+) {
+    if (!residency) return;
+
+    if (residency->slice.id >= 0) residencyEndSlice(residency, false);
+
+    for (int i = 0; i < RESIDENCY_MAX_ENTRIES; i++) {
+        residencyRelease(residency, &residency->entries[i]);
+    }
+
+    free(residency);
+}
+
+void residencyUpdate (
+/*
+    SYNOPSIS
+        Brings the wanted covers in and keeps the rest within the budget.
+
+    DESCRIPTION
+        Called once per frame with the covers around the selection, most important first.
+        Every wanted cover is marked as recently wanted before any is requested, then each
+        is requested if it is not resident or already loading, until the loader is full.
+        The last 'prefetched' ids are covers that are not on screen yet, so their reads are
+        scheduled behind those of the others. Finished loads are then moved into textures
+        (or, without a loader, the time slice is spent decoding), and the least recently
+        wanted covers are evicted until the budget is met again.
+
+    EXAMPLE
+        int wanted[] = { selected, selected + 1, selected - 1, selected + 2 };
+        residencyUpdate(covers, wanted, 4, 1);
+*/
+    // Manager to update
+    Residency* residency,
+
+    // Ids of the wanted covers, most important first
+    const int* wanted,
+
+    // Number of ids in 'wanted'
+    int count,
+
+    // Number of trailing ids in 'wanted' that are prefetches, not on screen
+    int prefetched
+) {
+    residency->update++;
+
+    // Mark every wanted cover that has an entry first, so neither making room for another cover
+    // nor a saturated loader cutting the loads short leaves it looking unwanted to
+    // residencyAcquire, residencyEvict or residencyCancel
+    for (int i = 0; i < count; i++) {
+        ResidentTexture* entry = wanted[i] >= 0 ? residencyFind(residency, wanted[i]) : NULL;
+        if (!entry) continue;
+
+        entry->lastWanted = residency->update;
+        if (entry->image.tex) residency->textures[entry->texture].lastWanted = residency->update;
+    }
+
+    for (int i = 0; i < count; i++) {
+        ResidentTexture* entry = residencyAcquire(residency, wanted[i]);
+        if (!entry) continue;
+
+        entry->lastWanted = residency->update;
+        const IOPriority priority = i >= count - prefetched ? IO_PRIORITY_PREFETCH : IO_PRIORITY_VISIBLE;
+        if (!entry->image.tex && !entry->loading && !residencyLoad(residency, entry, priority)) {
+            break; // Loader saturated; the rest is asked for again next update
+        }
+    }
+
+    if (residency->loader) {
+        residencyReceive(residency);
+    } else if (residency->timeSlice) {
+        residencyAdvance(residency, wanted, count);
+    }
+    residencyEvict(residency);
+}
+
+void residencyCancel (
+/*
+    SYNOPSIS
+        Cancels the loads of covers the last update no longer wanted.
+
+    DESCRIPTION
+        Meant for when the carousel reverses: covers requested ahead of the old direction
+        are not coming into view any more. Requests still queued on the loader are
+        skipped; a cover it is already loading is finished and kept. Without a loader,
+        waiting covers are unmarked and a decode in progress is dropped.
+
+    EXAMPLE
+        residencyUpdate(covers, wanted, count);
+        if (reversed) residencyCancel(covers);
+*/
+    // Manager whose loads to cancel
+    Residency* residency
+) {
+    for (int i = 0; i < RESIDENCY_MAX_ENTRIES; i++) {
+        ResidentTexture* entry = &residency->entries[i];
+        if (!entry->loading || entry->lastWanted == residency->update) continue;
+
+        if (residency->loader) {
+            if (loaderCancel(residency->loader, entry->id)) residency->cancelled++;
+        } else if (entry->id == residency->slice.id) {
+            residencyEndSlice(residency, false);
+            residency->cancelled++;
+        } else {
+            entry->loading = false;
+            residency->cancelled++;
+        }
+    }
+}
+
+C2D_Image residencyGet (
+/*
+    SYNOPSIS
+        Looks up a resident cover.
+
+    EXAMPLE
+        C2D_Image cover = residencyGet(covers, boxes[i].UID);
+        if (!cover.tex) // draw a placeholder
+*/
+    // Manager to search
+    const Residency* residency,
+
+    // Caller's key
+    int id
+) {
+    const ResidentTexture* entry = residencyFind(residency, id);
+    return entry ? entry->image : (C2D_Image){0};
+}
+
+bool residencyOpaque (
+/*
+    SYNOPSIS
+        Tells whether a resident cover can be drawn without alpha blending.
+
+    DESCRIPTION
+        True when the cover is resident and its art was classified as fully opaque while
+        it loaded. Covers whose opacity is unknown are reported as needing blending.
+
+    EXAMPLE
+        if (residencyOpaque(covers, boxes[i].UID)) // draw in the opaque pass
+*/
+    // Manager to search
+    const Residency* residency,
+
+    // Caller's key
+    int id
+) {
+    const ResidentTexture* entry = residencyFind(residency, id);
+    return entry && entry->image.tex && entry->opaque;
+}
@@ -0,0 +1,65 @@
+#include "spsc.h"
+
+void spscInit (
+/*
+    SYNOPSIS
+        Empties a single-producer single-consumer queue.
+*/
+    // Queue to initialize
+    SPSCQueue* queue
+) {
+    atomic_init(&queue->head, 0);
+    atomic_init(&queue->tail, 0);
+}
+
+bool spscPush (
+/*
+    SYNOPSIS
+        Appends an item to the queue. Must only be called by the producer thread.
+
+    DESCRIPTION
+        The slot is written before the tail is published with release ordering, so the
+        consumer never sees an index whose item is not yet stored.
+
+    EXAMPLE
+        if (!spscPush(&loader->requests, job)) free(job);
+*/
+    // Queue to append to
+    SPSCQueue* queue,
+
+    // Item to append, must not be NULL
+    void* item
+) {
+    const u32 tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    const u32 head = atomic_load_explicit(&queue->head, memory_order_acquire);
+    if (tail - head == SPSC_QUEUE_CAPACITY) return false;
+
+    queue->slots[tail & (SPSC_QUEUE_CAPACITY - 1)] = item;
+    atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+void* spscPop (
+/*
+    SYNOPSIS
+        Removes the oldest item from the queue. Must only be called by the consumer thread.
+
+    DESCRIPTION
+        Returns NULL if the queue is empty. The slot is read before the head is published,
+        so the producer never overwrites an item that has not been taken yet.
+
+    EXAMPLE
+        LoaderJob* job;
+        while ((job = spscPop(&loader->results))) { ... }
+*/
+    // Queue to remove from
+    SPSCQueue* queue
+) {
+    const u32 head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    const u32 tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+    if (head == tail) return NULL;
+
+    void* item = queue->slots[head & (SPSC_QUEUE_CAPACITY - 1)];
+    atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+    return item;
+}
@@ -0,0 +1,516 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "lodepng.h"
+#include "hash.h"
+#include "texcache.h"
+
+const char* textureCacheDirectory = TEXTURE_CACHE_DIR;
+
+static void cachePathFor (
+/*
+    SYNOPSIS
+        Builds the cache entry path for a source image.
+
+    DESCRIPTION
+        Flattens the source path into a single file name inside the cache directory, so
+        "images/game0.png" becomes "<cache>/images_game0.png.tex".
+*/
+    // Source image path
+    const char* source,
+
+    // Output buffer
+    char* path,
+
+    // Size of the output buffer
+    size_t size
+) {
+    int length = snprintf(path, size, "%s/", textureCacheDirectory);
+
+    for (const char* c = source; *c && length + 5 < (int)size; c++) {
+        path[length++] = (*c == '/' || *c == ':') ? '_' : *c;
+    }
+    snprintf(path + length, size - length, ".tex");
+}
+
+static bool cacheHeaderMatches(const TextureCacheHeader* header, const TextureOptions* options) {
+    return !memcmp(header->magic, TEXTURE_CACHE_MAGIC, 4) &&
+           header->version == TEXTURE_CACHE_VERSION &&
+           header->requestedFormat == (u8)options->format &&
+           header->dither == (u8)options->dither;
+}
+
+static bool readCacheEntry (
+/*
+    SYNOPSIS
+        Reads the texture of an open cache entry whose header has been read.
+
+    DESCRIPTION
+        Obtains the destination from 'allocate' and reads the tiled data straight into it
+        with one sequential read. Returns false if the entry is truncated.
+*/
+    // Cache file positioned just after the header
+    FILE* file,
+
+    // Header of the entry
+    const TextureCacheHeader* header,
+
+    // Description of the texture read
+    TextureData* data,
+
+    // Provides the texture memory
+    TextureAllocator allocate,
+
+    // Passed to 'allocate'
+    void* context
+) {
+    data->format        = (GPU_TEXCOLOR)header->format;
+    data->width         = header->width;
+    data->height        = header->height;
+    data->textureWidth  = header->textureWidth;
+    data->textureHeight = header->textureHeight;
+    data->size          = (size_t)header->textureWidth * header->textureHeight * textureFormatBits(data->format) / 8;
+    data->sourceHash    = header->sourceHash;
+    data->opacity       = (ImageOpacity)header->opacity;
+
+    if (data->size != header->dataSize) return false;
+
+    data->data = allocate(data, context);
+    return data->data && fread(data->data, 1, header->dataSize, file) == header->dataSize;
+}
+
+static void writeCacheEntry (
+/*
+    SYNOPSIS
+        Stores a converted texture in the cache.
+
+    DESCRIPTION
+        Writes to a temporary file and renames it over the entry, so an interrupted
+        write never leaves a valid-looking but truncated entry behind.
+*/
+    // Cache entry path
+    const char* path,
+
+    // Header describing the texture and its source
+    const TextureCacheHeader* header,
+
+    // Texture data, header->dataSize bytes
+    const void* data
+) {
+    char temporary[300];
+    snprintf(temporary, sizeof(temporary), "%s.tmp", path);
+
+    mkdir(textureCacheDirectory, 0777);
+    FILE* file = fopen(temporary, "wb");
+    if (!file) return;
+
+    const bool written = fwrite(header, sizeof(*header), 1, file) == 1 &&
+                         fwrite(data, 1, header->dataSize, file) == header->dataSize;
+    fclose(file);
+
+    remove(path);
+    if (!written || rename(temporary, path)) {
+        remove(temporary);
+    }
+}
+
+static void storeCacheEntry (
+/*
+    SYNOPSIS
+        Describes a decoded texture and its source in a cache header and writes the entry.
+*/
+    // Cache entry path
+    const char* path,
+
+    // Size and modification time of the source PNG (0 for a PNG held in memory)
+    u64 sourceSize,
+    s64 sourceMtime,
+
+    // Options the texture was decoded with
+    const TextureOptions* options,
+
+    // Decoded texture
+    const TextureData* data,
+
+    // hash64 of the source PNG
+    u64 sourceHash
+) {
+    TextureCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TEXTURE_CACHE_MAGIC, 4);
+    header.version         = TEXTURE_CACHE_VERSION;
+    header.format          = (u8)data->format;
+    header.requestedFormat = (u8)options->format;
+    header.dither          = (u8)options->dither;
+    header.width           = data->width;
+    header.height          = data->height;
+    header.textureWidth    = data->textureWidth;
+    header.textureHeight   = data->textureHeight;
+    header.dataSize        = (u32)data->size;
+    header.opacity         = (u8)data->opacity;
+    header.sourceSize      = sourceSize;
+    header.sourceMtime     = sourceMtime;
+    header.sourceHash      = sourceHash;
+    writeCacheEntry(path, &header, data->data);
+}
+
+bool loadPNGCached (
+/*
+    SYNOPSIS
+        Loads a PNG through the persistent texture cache into memory from an allocator.
+
+    DESCRIPTION
+        If the cache holds an entry built from a source of the same size and modification
+        time with the same options, the texture is read straight from it. If only the
+        modification time differs, the source is hashed and the entry reused when the
+        hash still matches. Otherwise the PNG is decoded as usual and the resulting tiled
+        texture is written to the cache for the next launch.
+
+        Does not touch the GPU when 'allocate' does not, so it can run on a loader thread.
+        On failure data->data may still hold memory handed out by the allocator.
+
+    EXAMPLE
+        TextureData data;
+        loadPNGCached("images/game0.png", &defaultTextureOptions, &data, allocateTextureData, NULL);
+*/
+    // Filename of the PNG image to be loaded
+    const char* filename,
+
+    // Texture format and dithering
+    const TextureOptions* options,
+
+    // Description of the loaded texture
+    TextureData* data,
+
+    // Provides the texture memory once its size is known
+    TextureAllocator allocate,
+
+    // Passed to 'allocate'
+    void* context
+) {
+    memset(data, 0, sizeof(*data));
+
+    struct stat info;
+    if (stat(filename, &info)) {
+        printf("error: cannot find %s\n", filename);
+        return false;
+    }
+
+    char path[300];
+    cachePathFor(filename, path, sizeof(path));
+
+    TextureCacheHeader header;
+    bool headerValid = false;
+    FILE* file = fopen(path, "rb");
+    if (file) {
+        headerValid = fread(&header, sizeof(header), 1, file) == 1 && cacheHeaderMatches(&header, options) &&
+                      header.sourceSize == (u64)info.st_size;
+
+        // Fast path: same file as last time, no need to touch the PNG at all
+        if (headerValid && header.sourceMtime == (s64)info.st_mtime) {
+            const bool read = readCacheEntry(file, &header, data, allocate, context);
+            fclose(file);
+            if (read) return true;
+            if (data->data) return false;
+            headerValid = false;
+        } else {
+            fclose(file);
+        }
+    }
+
+    unsigned char* png;
+    size_t pngsize;
+    unsigned error = lodepng_load_file(&png, &pngsize, filename);
+    if (error) {
+        printf("error %u: %s\n", error, lodepng_error_text(error));
+        return false;
+    }
+    const u64 sourceHash = hash64(png, pngsize, 0);
+
+    // The file was touched but its contents are unchanged: keep the entry, refresh its timestamp
+    if (headerValid && header.sourceHash == sourceHash) {
+        file = fopen(path, "rb");
+        if (file) {
+            fseek(file, sizeof(header), SEEK_SET);
+            const bool read = readCacheEntry(file, &header, data, allocate, context);
+            fclose(file);
+
+            if (read) {
+                header.sourceMtime = (s64)info.st_mtime;
+                writeCacheEntry(path, &header, data->data);
+                free(png);
+                return true;
+            }
+            if (data->data) {
+                free(png);
+                return false;
+            }
+        }
+    }
+
+    const bool decoded = decodePNGToTexture(png, pngsize, options, data, allocate, context);
+    free(png);
+    if (!decoded) return false;
+    data->sourceHash = sourceHash;
+
+    // Remember the converted texture for the next launch
+    storeCacheEntry(path, (u64)info.st_size, (s64)info.st_mtime, options, data, sourceHash);
+    return true;
+}
+
+bool loadPNGCacheEntry (
+/*
+    SYNOPSIS
+        Reads the cache entry of a PNG if it is current, without ever decoding the PNG.
+
+    DESCRIPTION
+        Only the fast path of loadPNGCached: the entry is used if it was built with the
+        same options from a source of the same size and modification time. Lets a caller
+        that decodes on its own terms (see beginPNGDecode) still benefit from the cache.
+        On failure data->data may still hold memory handed out by the allocator.
+
+    EXAMPLE
+        TextureData data;
+        if (!loadPNGCacheEntry("images/game0.png", &options, &data, allocateTextureData, NULL)) {
+            freeTextureData(&data);
+            // decode the PNG, then storePNGCacheEntry
+        }
+*/
+    // Filename of the PNG image
+    const char* filename,
+
+    // Texture format and dithering
+    const TextureOptions* options,
+
+    // Description of the loaded texture
+    TextureData* data,
+
+    // Provides the texture memory once its size is known
+    TextureAllocator allocate,
+
+    // Passed to 'allocate'
+    void* context
+) {
+    memset(data, 0, sizeof(*data));
+
+    struct stat info;
+    if (stat(filename, &info)) return false;
+
+    char path[300];
+    cachePathFor(filename, path, sizeof(path));
+
+    FILE* file = fopen(path, "rb");
+    if (!file) return false;
+
+    TextureCacheHeader header;
+    const bool read = fread(&header, sizeof(header), 1, file) == 1 && cacheHeaderMatches(&header, options) &&
+                      header.sourceSize == (u64)info.st_size && header.sourceMtime == (s64)info.st_mtime &&
+                      readCacheEntry(file, &header, data, allocate, context);
+    fclose(file);
+    return read;
+}
+
+void storePNGCacheEntry (
+/*
+    SYNOPSIS
+        Stores a texture decoded from a PNG in the cache. The PNG is only hashed when
+        data->sourceHash is not already set.
+
+    EXAMPLE
+        storePNGCacheEntry("images/game0.png", &options, &data, png, pngsize);
+*/
+    // Filename of the PNG image
+    const char* filename,
+
+    // Texture format and dithering the texture was decoded with
+    const TextureOptions* options,
+
+    // Decoded texture
+    const TextureData* data,
+
+    // Contents of the PNG file
+    const unsigned char* png,
+
+    // Size of the PNG file in bytes
+    size_t pngsize
+) {
+    struct stat info;
+    if (stat(filename, &info)) return;
+
+    char path[300];
+    cachePathFor(filename, path, sizeof(path));
+    storeCacheEntry(path, (u64)info.st_size, (s64)info.st_mtime, options, data,
+                    data->sourceHash ? data->sourceHash : hash64(png, pngsize, 0));
+}
+
+bool loadPNGBufferCacheEntry (
+/*
+    SYNOPSIS
+        Reads the cache entry of a PNG held in memory if it is current, without decoding.
+
+    DESCRIPTION
+        A PNG from memory (e.g. a bundle) has no modification time, so the entry stored
+        under 'name' is used when it was built with the same options from data of the
+        same size and hash. On failure data->data may still hold memory handed out by the
+        allocator.
+
+    EXAMPLE
+        TextureData data;
+        loadPNGBufferCacheEntry("covers.bundle:3", png, pngsize, &options, &data, allocateTextureData, NULL);
+*/
+    // Name the entry is stored under
+    const char* name,
+
+    // Encoded PNG data
+    const unsigned char* png,
+
+    // Size of the encoded PNG data in bytes
+    size_t pngsize,
+
+    // Texture format and dithering
+    const TextureOptions* options,
+
+    // Description of the loaded texture
+    TextureData* data,
+
+    // Provides the texture memory once its size is known
+    TextureAllocator allocate,
+
+    // Passed to 'allocate'
+    void* context
+) {
+    memset(data, 0, sizeof(*data));
+
+    char path[300];
+    cachePathFor(name, path, sizeof(path));
+
+    FILE* file = fopen(path, "rb");
+    if (!file) return false;
+
+    TextureCacheHeader header;
+    const bool read = fread(&header, sizeof(header), 1, file) == 1 && cacheHeaderMatches(&header, options) &&
+                      header.sourceSize == (u64)pngsize && header.sourceHash == hash64(png, pngsize, 0) &&
+                      readCacheEntry(file, &header, data, allocate, context);
+    fclose(file);
+    return read;
+}
+
+void storePNGBufferCacheEntry (
+/*
+    SYNOPSIS
+        Stores a texture decoded from a PNG held in memory in the cache under 'name'. The
+        PNG is only hashed when data->sourceHash is not already set.
+
+    EXAMPLE
+        storePNGBufferCacheEntry("covers.bundle:3", &options, &data, png, pngsize);
+*/
+    // Name to store the entry under
+    const char* name,
+
+    // Texture format and dithering the texture was decoded with
+    const TextureOptions* options,
+
+    // Decoded texture
+    const TextureData* data,
+
+    // Encoded PNG data
+    const unsigned char* png,
+
+    // Size of the encoded PNG data in bytes
+    size_t pngsize
+) {
+    char path[300];
+    cachePathFor(name, path, sizeof(path));
+    storeCacheEntry(path, (u64)pngsize, 0, options, data, data->sourceHash ? data->sourceHash : hash64(png, pngsize, 0));
+}
+
+bool loadPNGBufferCached (
+/*
+    SYNOPSIS
+        Loads a PNG held in memory through the persistent texture cache.
+
+    DESCRIPTION
+        Reads the entry stored under 'name' if it is current (see loadPNGBufferCacheEntry),
+        otherwise decodes the PNG and stores the result for the next launch. Usable off the
+        GPU thread like loadPNGCached. On failure data->data may still hold memory handed
+        out by the allocator.
+
+    EXAMPLE
+        TextureData data;
+        loadPNGBufferCached("covers.bundle:3", png, pngsize, &options, &data, allocateTextureData, NULL);
+*/
+    // Name the entry is stored under
+    const char* name,
+
+    // Encoded PNG data
+    const unsigned char* png,
+
+    // Size of the encoded PNG data in bytes
+    size_t pngsize,
+
+    // Texture format and dithering
+    const TextureOptions* options,
+
+    // Description of the loaded texture
+    TextureData* data,
+
+    // Provides the texture memory once its size is known
+    TextureAllocator allocate,
+
+    // Passed to 'allocate'
+    void* context
+) {
+    if (loadPNGBufferCacheEntry(name, png, pngsize, options, data, allocate, context)) return true;
+    if (data->data) return false;
+
+    if (!decodePNGToTexture(png, pngsize, options, data, allocate, context)) return false;
+    data->sourceHash = hash64(png, pngsize, 0);
+
+    storePNGBufferCacheEntry(name, options, data, png, pngsize);
+    return true;
+}
+
+C2D_Image convertPNGToC2DImageCachedWithOptions (
+/*
+    SYNOPSIS
+        Loads a PNG through the persistent texture cache.
+
+    DESCRIPTION
+        See loadPNGCached. The texture is created directly, so the cached data is read
+        straight into it.
+
+    EXAMPLE
+        C2D_Image image = convertPNGToC2DImageCachedWithOptions("images/game0.png", &defaultTextureOptions);
+*/
+    // Filename of the PNG image to be loaded
+    const char* filename,
+
+    // Texture format and dithering
+    const TextureOptions* options
+) {
+    C2D_Image img = {0};
+    TextureData data;
+
+    if (!loadPNGCached(filename, options, &data, allocateC2DImageTexture, &img)) {
+        freeC2DImage(&img);
+        return (C2D_Image){0};
+    }
+
+    finishC2DImageTexture(&img, &data);
+    return img;
+}
+
+C2D_Image convertPNGToC2DImageCached (
+/*
+    SYNOPSIS
+        Loads a PNG through the persistent texture cache using defaultTextureOptions.
+
+    EXAMPLE
+        C2D_Image image = convertPNGToC2DImageCached("images/game0.png");
+*/
+    // Filename of the PNG image to be loaded
+    const char* filename
+) {
+    return convertPNGToC2DImageCachedWithOptions(filename, &defaultTextureOptions);
+}
@@ -0,0 +1,1475 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lodepng.h"
+#include "hash.h"
+#include "pixels.h"
+#include "texture.h"
+
+u32 calculateTexturePosition (
+/*
+    SYNOPSIS
+        Calculates the position in the texture buffer for a given pixel coordinate.
+
+    DESCRIPTION
+        This function takes the x and y pixel coordinates and calculates the corresponding
+        position in the texture buffer. It is used for converting image data into a format
+        suitable for graphics rendering. The calculation involves bit manipulation to
+        efficiently determine the position in a linear texture buffer.
+
+    EXAMPLE
+        u32 position = calculateTexturePosition(10, 20);
+        // This will calculate the texture buffer position for the pixel at coordinates (10, 20).
+*/
+    // X coordinate of the pixel
+    u32 x,
+    // Y coordinate of the pixel
+    u32 y
+) {
+    return ((((y >> 3) * (512 >> 3) + (x >> 3)) << 6) +
+            ((x & 1) | ((y & 1) << 1) | ((x & 2) << 1) | ((y & 2) << 2) |
+            ((x & 4) << 2) | ((y & 4) << 3))) * 4;
+}
+
+// Offset of a texel inside an 8x8 tile, split per axis: offset = tileOffsetX[x & 7] | tileOffsetY[y & 7]
+static const u8 tileOffsetX[8] = { 0x00, 0x01, 0x04, 0x05, 0x10, 0x11, 0x14, 0x15 };
+static const u8 tileOffsetY[8] = { 0x00, 0x02, 0x08, 0x0A, 0x20, 0x22, 0x28, 0x2A };
+
+static inline u32 loadTexel(const u8* src, bool reverse) {
+    u32 pixel;
+    memcpy(&pixel, src, sizeof(pixel));
+    return reverse ? __builtin_bswap32(pixel) : pixel; // R,G,B,A in memory becomes A,B,G,R
+}
+
+static inline void swizzleWords (
+/*
+    SYNOPSIS
+        Tile walk shared by swizzleRGBA8 and swizzleABGR8, see swizzleRGBA8.
+*/
+    // Texture data of a GPU_RGBA8 texture
+    void* texture,
+
+    // Texture dimensions in texels (multiples of 8)
+    u32 textureWidth,
+    u32 textureHeight,
+
+    // Source image, 4 bytes per pixel
+    const u8* pixels,
+
+    // Source image dimensions in pixels
+    u32 width,
+    u32 height,
+
+    // Reverse the bytes of each pixel (R,G,B,A source) or copy them as they are (A,B,G,R source)
+    bool reverse
+) {
+    const u32 copyWidth  = width  < textureWidth  ? width  : textureWidth;
+    const u32 copyHeight = height < textureHeight ? height : textureHeight;
+    const u32 tilesX     = (copyWidth  + 7) >> 3;
+    const u32 tilesY     = (copyHeight + 7) >> 3;
+
+    for (u32 tileY = 0; tileY < tilesY; tileY++) {
+        // Each row of tiles starts at a whole number of tile rows into the texture
+        u32* tile = (u32*)texture + tileY * (textureWidth >> 3) * 64;
+        const u8* band = pixels + (size_t)tileY * 8 * width * 4;
+
+        for (u32 tileX = 0; tileX < tilesX; tileX++, tile += 64) {
+            const u32 x0 = tileX * 8;
+            const bool fullTile = x0 + 8 <= copyWidth && tileY * 8 + 8 <= copyHeight;
+
+            for (u32 ty = 0; ty < 8; ty++) {
+                const u8* row = band + ((size_t)ty * width + x0) * 4;
+                const u8 offsetY = tileOffsetY[ty];
+
+                if (fullTile) {
+                    for (u32 tx = 0; tx < 8; tx++) {
+                        tile[tileOffsetX[tx] | offsetY] = loadTexel(row + tx * 4, reverse);
+                    }
+                } else {
+                    // Edge tile: only part of it is covered by the image
+                    const bool rowInside = tileY * 8 + ty < copyHeight;
+                    for (u32 tx = 0; tx < 8; tx++) {
+                        tile[tileOffsetX[tx] | offsetY] =
+                            (rowInside && x0 + tx < copyWidth) ? loadTexel(row + tx * 4, reverse) : 0;
+                    }
+                }
+            }
+        }
+    }
+}
+
+void swizzleRGBA8 (
+/*
+    SYNOPSIS
+        Copies an RGBA image into a tiled RGBA8 texture, one 8x8 tile at a time.
+
+    DESCRIPTION
+        Walks the image in bands of 8 source rows and fills each 8x8 tile of the texture
+        completely before moving on, so texture writes stay inside one 256 byte tile and
+        source reads stay inside the current band. Texels of edge tiles that fall outside
+        the image are cleared to transparent black. The copied region is clipped to the
+        texture dimensions.
+
+    EXAMPLE
+        swizzleRGBA8(tex->data, 512, 512, rgba, width, height);
+
+        Fills the top-left width x height texels of a 512x512 RGBA8 texture.
+*/
+    // Texture data of a GPU_RGBA8 texture
+    void* texture,
+
+    // Width of the texture in texels (a multiple of 8)
+    u32 textureWidth,
+
+    // Height of the texture in texels (a multiple of 8)
+    u32 textureHeight,
+
+    // Source image, 4 bytes per pixel in R,G,B,A order
+    const u8* rgba,
+
+    // Width of the source image in pixels
+    u32 width,
+
+    // Height of the source image in pixels
+    u32 height
+) {
+    swizzleWords(texture, textureWidth, textureHeight, rgba, width, height, true);
+}
+
+void swizzleABGR8 (
+/*
+    SYNOPSIS
+        Copies texels already in the GPU's byte order into a tiled RGBA8 texture.
+
+    DESCRIPTION
+        The same tile walk as swizzleRGBA8 without the byte reversal, for pixels that
+        convertPixels wrote as PIXELS_ABGR.
+
+    EXAMPLE
+        convertPixels(PIXELS_RGB8, PIXELS_ABGR, texels, rgb, width * height, NULL);
+        swizzleABGR8(tex->data, 512, 512, texels, width, height);
+*/
+    // Texture data of a GPU_RGBA8 texture
+    void* texture,
+
+    // Texture dimensions in texels (multiples of 8)
+    u32 textureWidth,
+    u32 textureHeight,
+
+    // Source image, one texel per pixel with A,B,G,R in memory
+    const u32* abgr,
+
+    // Source image dimensions in pixels
+    u32 width,
+    u32 height
+) {
+    swizzleWords(texture, textureWidth, textureHeight, (const u8*)abgr, width, height, false);
+}
+
+// Options used by convertPNGToC2DImage and convertPNGBufferToC2DImage, and for the cover art
+// main.c loads through the residency manager
+TextureOptions defaultTextureOptions = { TEXTURE_FORMAT_AUTO, true };
+
+// 4x4 ordered dither thresholds, (2 * bayer + 1) * 255 / 32, and the flat rounding used without dithering
+static const u8 ditherThresholds[4][4] = {
+    {   7, 135,  39, 167 },
+    { 199,  71, 231, 103 },
+    {  55, 183,  23, 151 },
+    { 247, 119, 215,  87 },
+};
+static const u8 roundingThresholds[4][4] = {
+    { 127, 127, 127, 127 },
+    { 127, 127, 127, 127 },
+    { 127, 127, 127, 127 },
+    { 127, 127, 127, 127 },
+};
+
+// Scales an 8-bit channel to 0..max; 'threshold' in 0..254 sets where it rounds up
+static inline u32 quantizeChannel(u32 value, u32 max, u32 threshold) {
+    const u32 n = value * max + threshold;
+    return (n + 1 + (n >> 8)) >> 8; // n / 255 for n < 65535
+}
+
+static inline u16 packRGB565(const u8* src, u32 threshold) {
+    return (u16)((quantizeChannel(src[0], 31, threshold) << 11) |
+                 (quantizeChannel(src[1], 63, threshold) << 5) |
+                  quantizeChannel(src[2], 31, threshold));
+}
+
+static inline u16 packRGBA5551(const u8* src, u32 threshold) {
+    return (u16)((quantizeChannel(src[0], 31, threshold) << 11) |
+                 (quantizeChannel(src[1], 31, threshold) << 6) |
+                 (quantizeChannel(src[2], 31, threshold) << 1) |
+                 (src[3] >> 7));
+}
+
+static inline u16 packRGBA4(const u8* src, u32 threshold) {
+    return (u16)((quantizeChannel(src[0], 15, threshold) << 12) |
+                 (quantizeChannel(src[1], 15, threshold) << 8) |
+                 (quantizeChannel(src[2], 15, threshold) << 4) |
+                  quantizeChannel(src[3], 15, threshold));
+}
+
+/*
+    Defines a tile-walking swizzle kernel for a 16-bit texture format. Each kernel walks
+    the image exactly like swizzleRGBA8 and packs texels with its own inline PACK function,
+    so the format is resolved once per image instead of once per pixel.
+*/
+#define DEFINE_SWIZZLE16(NAME, PACK)                                                            \
+void NAME(void* texture, u32 textureWidth, u32 textureHeight,                                  \
+          const u8* rgba, u32 width, u32 height, bool dither) {                                \
+    const u8 (*thresholds)[4] = dither ? ditherThresholds : roundingThresholds;                \
+    const u32 copyWidth  = width  < textureWidth  ? width  : textureWidth;                     \
+    const u32 copyHeight = height < textureHeight ? height : textureHeight;                    \
+    const u32 tilesX     = (copyWidth  + 7) >> 3;                                              \
+    const u32 tilesY     = (copyHeight + 7) >> 3;                                              \
+                                                                                               \
+    for (u32 tileY = 0; tileY < tilesY; tileY++) {                                             \
+        u16* tile = (u16*)texture + tileY * (textureWidth >> 3) * 64;                          \
+        const u8* band = rgba + (size_t)tileY * 8 * width * 4;                                 \
+                                                                                               \
+        for (u32 tileX = 0; tileX < tilesX; tileX++, tile += 64) {                             \
+            const u32 x0 = tileX * 8;                                                          \
+            const bool fullTile = x0 + 8 <= copyWidth && tileY * 8 + 8 <= copyHeight;          \
+                                                                                               \
+            for (u32 ty = 0; ty < 8; ty++) {                                                   \
+                const u8* row = band + ((size_t)ty * width + x0) * 4;                          \
+                const u8* threshold = thresholds[ty & 3];                                      \
+                const u8 offsetY = tileOffsetY[ty];                                            \
+                const bool rowInside = tileY * 8 + ty < copyHeight;                            \
+                                                                                               \
+                for (u32 tx = 0; tx < 8; tx++) {                                               \
+                    tile[tileOffsetX[tx] | offsetY] =                                          \
+                        (fullTile || (rowInside && x0 + tx < copyWidth))                       \
+                            ? PACK(row + tx * 4, threshold[tx & 3]) : 0;                       \
+                }                                                                              \
+            }                                                                                  \
+        }                                                                                      \
+    }                                                                                          \
+}
+
+DEFINE_SWIZZLE16(swizzleRGB565, packRGB565)
+DEFINE_SWIZZLE16(swizzleRGBA5551, packRGBA5551)
+DEFINE_SWIZZLE16(swizzleRGBA4, packRGBA4)
+
+// Classifies 'count' alpha samples 'stride' bytes apart, see imageOpacity
+static ImageOpacity alphaOpacity(const u8* alpha, size_t count, size_t stride) {
+    ImageOpacity opacity = IMAGE_OPAQUE;
+
+    for (size_t i = 0; i < count; i++) {
+        const u8 value = alpha[i * stride];
+        if (value == 0xFF) continue;
+        if (value != 0x00) return IMAGE_TRANSLUCENT;
+        opacity = IMAGE_BINARY_ALPHA;
+    }
+
+    return opacity;
+}
+
+ImageOpacity imageOpacity (
+/*
+    SYNOPSIS
+        Classifies how an RGBA image uses its alpha channel.
+
+    DESCRIPTION
+        Returns IMAGE_OPAQUE when every pixel has alpha 255, IMAGE_BINARY_ALPHA when every
+        pixel is either fully opaque or fully transparent, and IMAGE_TRANSLUCENT otherwise.
+
+    EXAMPLE
+        if (imageOpacity(rgba, width, height) == IMAGE_OPAQUE) {
+            // No alpha channel needed
+        }
+*/
+    // Image, 4 bytes per pixel in R,G,B,A order
+    const u8* rgba,
+
+    // Image dimensions in pixels
+    u32 width,
+    u32 height
+) {
+    return alphaOpacity(rgba + 3, (size_t)width * height, 4);
+}
+
+ImageOpacity pngOpacity (
+/*
+    SYNOPSIS
+        Tells how a PNG uses alpha from its header chunks, without decoding any pixels.
+
+    DESCRIPTION
+        Gray and RGB images are opaque unless a tRNS chunk names a color key, which makes
+        them binary-alpha. A palette image takes the least opaque class of the alpha
+        values its tRNS chunk gives the palette entries; entries it leaves out are opaque.
+        Only the chunks before the image data are looked at. Images with an alpha channel
+        (most of them fully opaque anyway) need a look at the pixels and are reported as
+        IMAGE_OPACITY_UNKNOWN, as is data that is not a PNG.
+
+    EXAMPLE
+        if (pngOpacity(png, pngsize) == IMAGE_OPAQUE) {
+            // Store without alpha and draw without blending
+        }
+*/
+    // Encoded PNG data
+    const unsigned char* png,
+
+    // Size of the encoded PNG data in bytes
+    size_t pngsize
+) {
+    // Signature, then IHDR: length, type, width, height, bit depth, color type
+    if (pngsize < 33 || !lodepng_chunk_type_equals(png + 8, "IHDR")) return IMAGE_OPACITY_UNKNOWN;
+
+    const LodePNGColorType colortype = (LodePNGColorType)png[25];
+    if (colortype == LCT_GREY_ALPHA || colortype == LCT_RGBA) return IMAGE_OPACITY_UNKNOWN;
+
+    const unsigned char* end = png + pngsize;
+    for (const unsigned char* chunk = png + 8; chunk + 12 <= end; chunk = lodepng_chunk_next_const(chunk, end)) {
+        if (lodepng_chunk_type_equals(chunk, "IDAT") || lodepng_chunk_type_equals(chunk, "IEND")) break;
+        if (!lodepng_chunk_type_equals(chunk, "tRNS")) continue;
+
+        const unsigned length = lodepng_chunk_length(chunk);
+        if (length > (size_t)(end - chunk) - 12) return IMAGE_OPACITY_UNKNOWN;
+        if (colortype != LCT_PALETTE) return IMAGE_BINARY_ALPHA;
+
+        return alphaOpacity(lodepng_chunk_data_const(chunk), length, 1);
+    }
+
+    return IMAGE_OPAQUE;
+}
+
+ImageOpacity formatOpacity (
+/*
+    SYNOPSIS
+        Tells the opacity a texture format guarantees.
+
+    DESCRIPTION
+        Formats without an alpha channel are opaque; for the others the texels would have
+        to be looked at, so they are taken to be translucent.
+
+    EXAMPLE
+        data->opacity = formatOpacity(tex.fmt);
+*/
+    // Texture format
+    GPU_TEXCOLOR format
+) {
+    switch (format) {
+        case GPU_RGB8:
+        case GPU_RGB565:
+        case GPU_HILO8:
+        case GPU_L8:
+        case GPU_L4:
+        case GPU_ETC1:
+            return IMAGE_OPAQUE;
+        default:
+            return IMAGE_TRANSLUCENT;
+    }
+}
+
+GPU_TEXCOLOR textureFormatFor (
+/*
+    SYNOPSIS
+        Resolves the texture format the loader should use for an image of known opacity.
+
+    DESCRIPTION
+        TEXTURE_FORMAT_AUTO picks a 16-bit format: GPU_RGB565 for opaque art, so it is
+        stored without alpha, GPU_RGBA5551 when alpha is only on/off, and GPU_RGBA4 for
+        soft or unknown alpha. Any other requested format is returned unchanged.
+
+        This is the format cover art is decoded to in the app: main.c loads the covers
+        with defaultTextureOptions, and its atlas keeps pages of each format instead of
+        converting them to one.
+
+    EXAMPLE
+        GPU_TEXCOLOR format = textureFormatFor(TEXTURE_FORMAT_AUTO, pngOpacity(png, pngsize));
+*/
+    // Requested format or TEXTURE_FORMAT_AUTO
+    GPU_TEXCOLOR requested,
+
+    // How the image uses alpha
+    ImageOpacity opacity
+) {
+    if (requested != TEXTURE_FORMAT_AUTO) return requested;
+
+    switch (opacity) {
+        case IMAGE_OPAQUE:
+            return GPU_RGB565;
+        case IMAGE_BINARY_ALPHA:
+            return GPU_RGBA5551;
+        default:
+            return GPU_RGBA4;
+    }
+}
+
+GPU_TEXCOLOR chooseTextureFormat (
+/*
+    SYNOPSIS
+        Resolves the texture format the loader should use for an image.
+
+    DESCRIPTION
+        Like textureFormatFor, classifying the image's alpha channel with imageOpacity
+        when TEXTURE_FORMAT_AUTO is requested.
+
+    EXAMPLE
+        GPU_TEXCOLOR format = chooseTextureFormat(TEXTURE_FORMAT_AUTO, rgba, width, height);
+*/
+    // Requested format or TEXTURE_FORMAT_AUTO
+    GPU_TEXCOLOR requested,
+
+    // Decoded image, 4 bytes per pixel in R,G,B,A order
+    const u8* rgba,
+
+    // Image dimensions in pixels
+    u32 width,
+    u32 height
+) {
+    if (requested != TEXTURE_FORMAT_AUTO) return requested;
+    return textureFormatFor(requested, imageOpacity(rgba, width, height));
+}
+
+u32 textureFormatBits (
+/*
+    SYNOPSIS
+        Returns the number of bits one texel takes in a texture format.
+
+    EXAMPLE
+        size_t bytes = width * height * textureFormatBits(GPU_RGB565) / 8;
+*/
+    // Texture format
+    GPU_TEXCOLOR format
+) {
+    switch (format) {
+        case GPU_RGBA8:
+            return 32;
+        case GPU_RGB8:
+            return 24;
+        case GPU_RGBA5551:
+        case GPU_RGB565:
+        case GPU_RGBA4:
+        case GPU_LA8:
+        case GPU_HILO8:
+            return 16;
+        case GPU_L8:
+        case GPU_A8:
+        case GPU_LA4:
+        case GPU_ETC1A4:
+            return 8;
+        default:
+            return 4;
+    }
+}
+
+u32 textureSizeFor (
+/*
+    SYNOPSIS
+        Returns the smallest texture dimension that can hold a given image dimension.
+
+    DESCRIPTION
+        The GPU only samples textures whose sides are powers of two between
+        MIN_TEXTURE_SIZE and MAX_TEXTURE_SIZE. Sizes above the maximum are clamped to it.
+
+    EXAMPLE
+        u32 height = textureSizeFor(130); // 256
+*/
+    // Image dimension in pixels
+    u32 size
+) {
+    u32 result = MIN_TEXTURE_SIZE;
+    while (result < size && result < MAX_TEXTURE_SIZE) {
+        result <<= 1;
+    }
+
+    return result;
+}
+
+static unsigned char* downscaleRGBA8 (
+/*
+    SYNOPSIS
+        Shrinks an RGBA image by an integer factor using a box filter.
+
+    DESCRIPTION
+        Every destination pixel is the average of a factor x factor block of source
+        pixels. Partial blocks at the right and bottom edges are dropped. Returns NULL
+        when the scaled image cannot be allocated.
+*/
+    // Source image, 4 bytes per pixel
+    const unsigned char* rgba,
+
+    // Source dimensions in pixels
+    u32 width,
+    u32 height,
+
+    // Scale factor, at least 2
+    u32 factor
+) {
+    const u32 scaledWidth  = width / factor;
+    const u32 scaledHeight = height / factor;
+    const u32 area         = factor * factor;
+    unsigned char* scaled  = (unsigned char*)malloc((size_t)scaledWidth * scaledHeight * 4);
+    if (!scaled) return NULL;
+
+    for (u32 y = 0; y < scaledHeight; y++) {
+        for (u32 x = 0; x < scaledWidth; x++) {
+            u32 sum[4] = { 0, 0, 0, 0 };
+
+            for (u32 by = 0; by < factor; by++) {
+                const unsigned char* src = rgba + (((size_t)y * factor + by) * width + x * factor) * 4;
+                for (u32 bx = 0; bx < factor * 4; bx++) {
+                    sum[bx & 3] += src[bx];
+                }
+            }
+
+            unsigned char* dst = scaled + ((size_t)y * scaledWidth + x) * 4;
+            for (u32 c = 0; c < 4; c++) {
+                dst[c] = (unsigned char)((sum[c] + area / 2) / area);
+            }
+        }
+    }
+
+    return scaled;
+}
+
+bool createC2DImage (
+/*
+    SYNOPSIS
+        Allocates an empty texture and sub-texture for an image of a given size.
+
+    DESCRIPTION
+        Initializes a texture of the requested size and format with linear filtering and
+        a clamp-to-border wrap, and a sub-texture that maps the top-left width x height
+        texels. The texture contents are left for the caller to fill.
+
+    EXAMPLE
+        C2D_Image img;
+        if (createC2DImage(&img, 128, 130, 128, 256, GPU_RGBA8)) {
+            swizzleRGBA8(img.tex->data, 128, 256, rgba, 128, 130);
+        }
+*/
+    // Image to be initialized; left empty on failure
+    C2D_Image* img,
+
+    // Image dimensions in pixels
+    u32 width,
+    u32 height,
+
+    // Texture dimensions in texels
+    u32 textureWidth,
+    u32 textureHeight,
+
+    // Texture format
+    GPU_TEXCOLOR format
+) {
+    C3D_Tex* tex = (C3D_Tex*)malloc(sizeof(C3D_Tex));
+    Tex3DS_SubTexture* subtex = (Tex3DS_SubTexture*)malloc(sizeof(Tex3DS_SubTexture));
+
+    // Initialize the texture with the requested format and set filters
+    if (!tex || !subtex || !C3D_TexInit(tex, textureWidth, textureHeight, format)) {
+        printf("error: out of texture memory for %ux%u image\n", (unsigned)width, (unsigned)height);
+        free(tex);
+        free(subtex);
+        *img = (C2D_Image){0};
+        return false;
+    }
+    C3D_TexSetFilter(tex, GPU_LINEAR, GPU_LINEAR);
+    tex->border = 0xFFFFFFFF;
+    C3D_TexSetWrap(tex, GPU_CLAMP_TO_BORDER, GPU_CLAMP_TO_BORDER);
+
+    // Set up the sub-texture parameters based on image and texture dimensions
+    *subtex = (Tex3DS_SubTexture){
+        (u16)width, (u16)height, 0.0f, 1.0f,
+        (float)width / textureWidth, 1.0f - ((float)height / textureHeight)
+    };
+
+    img->tex    = tex;
+    img->subtex = subtex;
+    return true;
+}
+
+void* allocateC2DImageTexture (
+/*
+    SYNOPSIS
+        TextureAllocator that creates a C2D_Image and hands out its texture memory.
+
+    DESCRIPTION
+        'context' points to the C2D_Image to be created. Must be called on the thread that
+        owns the GPU. On failure the image is left empty and NULL is returned.
+
+    EXAMPLE
+        C2D_Image img = {0};
+        TextureData data;
+        decodePNGToTexture(png, pngsize, &options, &data, allocateC2DImageTexture, &img);
+*/
+    // Format and size of the texture to create
+    const TextureData* data,
+
+    // C2D_Image to be created
+    void* context
+) {
+    C2D_Image* img = (C2D_Image*)context;
+    if (!createC2DImage(img, data->width, data->height, data->textureWidth, data->textureHeight, data->format)) {
+        return NULL;
+    }
+
+    return img->tex->data;
+}
+
+void finishC2DImageTexture (
+/*
+    SYNOPSIS
+        Completes a C2D_Image filled through allocateC2DImageTexture.
+
+    DESCRIPTION
+        With TEXTURE_FORMAT_AUTO the decode may settle on another 16-bit format than the
+        one the texture was created with; the texels already are in the final one, so
+        only the texture's format changes. The texture is then flushed for the GPU.
+
+    EXAMPLE
+        if (decodePNGToTexture(png, pngsize, &options, &data, allocateC2DImageTexture, &img)) {
+            finishC2DImageTexture(&img, &data);
+        }
+*/
+    // Image created by allocateC2DImageTexture
+    C2D_Image* img,
+
+    // Description of the decoded texture
+    const TextureData* data
+) {
+    img->tex->fmt = data->format;
+    C3D_TexFlush(img->tex);
+}
+
+void* allocateTextureData (
+/*
+    SYNOPSIS
+        TextureAllocator that keeps texel data in ordinary heap memory.
+
+    DESCRIPTION
+        Safe to use from any thread. The data can later be turned into a texture with
+        uploadTextureData and must be released with freeTextureData.
+*/
+    // Format and size of the texture data
+    const TextureData* data,
+
+    // Unused
+    void* context
+) {
+    (void)context;
+    return malloc(data->size);
+}
+
+static void describeTexture(TextureData* data, GPU_TEXCOLOR format, u32 width, u32 height) {
+    data->format        = format;
+    data->width         = (u16)width;
+    data->height        = (u16)height;
+    data->textureWidth  = (u16)textureSizeFor(width);
+    data->textureHeight = (u16)textureSizeFor(height);
+    data->size          = (size_t)data->textureWidth * data->textureHeight * textureFormatBits(format) / 8;
+}
+
+void swizzleToFormat (
+/*
+    SYNOPSIS
+        Swizzles RGBA pixels into a texture of any of the supported formats.
+
+    EXAMPLE
+        swizzleToFormat(GPU_RGB565, tex->data, 512, 512, rgba, width, height, true);
+*/
+    // Format of the texture
+    GPU_TEXCOLOR format,
+
+    // Texture data
+    void* texture,
+
+    // Texture dimensions in texels
+    u32 textureWidth,
+    u32 textureHeight,
+
+    // Source image, 4 bytes per pixel in R,G,B,A order
+    const u8* rgba,
+
+    // Image dimensions in pixels
+    u32 width,
+    u32 height,
+
+    // Ordered dithering for the 16-bit formats
+    bool dither
+) {
+    switch (format) {
+        case GPU_RGB565:
+            swizzleRGB565(texture, textureWidth, textureHeight, rgba, width, height, dither);
+            break;
+        case GPU_RGBA5551:
+            swizzleRGBA5551(texture, textureWidth, textureHeight, rgba, width, height, dither);
+            break;
+        case GPU_RGBA4:
+            swizzleRGBA4(texture, textureWidth, textureHeight, rgba, width, height, dither);
+            break;
+        default:
+            swizzleRGBA8(texture, textureWidth, textureHeight, rgba, width, height);
+            break;
+    }
+}
+
+// Destination of the rows lodepng_decode_rows hands to swizzleBand
+typedef struct {
+    TextureData* data;
+    bool         dither;
+    PixelLayout  layout;        // Layout of the rows; anything but PIXELS_RGBA8 goes through 'scratch'
+    PixelOrder   order;         // Order convertPixels writes: PIXELS_ABGR for a GPU_RGBA8 texture
+    u8*          scratch;       // One band of converted pixels, NULL when the rows are RGBA already
+    const LodePNGColorMode* mode; // The PNG's color mode; its palette is only known once decoding starts
+    bool         paletteBuilt;
+    bool         scanAlpha;     // The header left the opacity open, so each band's alpha is classified
+    bool         speculative;   // TEXTURE_FORMAT_AUTO with the opacity open: data->format is a guess
+    bool         restart;       // A band showed alpha the guess cannot hold; decode again from row 0
+    u32          palette[256];  // Lookup table of a PIXELS_PALETTE8 image
+} TextureBands;
+
+// Returned by swizzleBand to stop the decoder when the texture has to be filled again
+#define TEXTURE_BANDS_RESTART 0x7E57
+
+// Format the bands are swizzled to first. TEXTURE_FORMAT_AUTO starts out with the one opaque art
+// gets; every format it may end up with takes 16 bits a texel, so the texture never changes size.
+static GPU_TEXCOLOR bandFormat(GPU_TEXCOLOR format) {
+    return format == TEXTURE_FORMAT_AUTO ? textureFormatFor(TEXTURE_FORMAT_AUTO, IMAGE_OPAQUE) : format;
+}
+
+// Layout the pixel kernels read a PNG's own rows in. lodepng_inspect leaves the tRNS chunk unread,
+// so a color key only shows in the opacity pngOpacity gave; keyed gray and RGB art stays with lodepng.
+static PixelLayout rowLayout(const LodePNGColorMode* mode, ImageOpacity opacity) {
+    const PixelLayout layout = pixelLayoutFor(mode);
+    if ((layout == PIXELS_GRAY8 || layout == PIXELS_RGB8) && opacity != IMAGE_OPAQUE) return PIXELS_UNSUPPORTED;
+    return layout;
+}
+
+static bool beginTextureBands (
+/*
+    SYNOPSIS
+        Sets up converting the decoded rows of a PNG with the pixel kernels.
+
+    DESCRIPTION
+        When the PNG's own color mode is one convertPixels reads, lodepng is told to hand
+        over rows in that mode, skipping its generic conversion to RGBA, and a band of
+        scratch pixels is allocated to convert into. The palette lookup table is built
+        with the first band, once the decoder has read the PLTE chunk. RGBA rows and modes
+        the kernels do not read are left to lodepng. When data->opacity is unknown, the
+        bands classify the alpha they convert into it; with TEXTURE_FORMAT_AUTO they also
+        ask for a restart when that alpha outgrows the format, see swizzleBand. Call before
+        the decoder is created; release the scratch buffer with endTextureBands. Returns
+        false if memory runs out.
+*/
+    // Bands to set up
+    TextureBands* bands,
+
+    // Decoder state, after lodepng_inspect
+    LodePNGState* state,
+
+    // Format of the texture the bands go into, or TEXTURE_FORMAT_AUTO
+    GPU_TEXCOLOR format,
+
+    // Image width in pixels
+    unsigned width
+) {
+    bands->layout    = rowLayout(&state->info_png.color, bands->data->opacity);
+    bands->order     = format == GPU_RGBA8 ? PIXELS_ABGR : PIXELS_RGBA;
+    bands->scratch   = NULL;
+    bands->scanAlpha = bands->data->opacity == IMAGE_OPACITY_UNKNOWN;
+    bands->speculative = bands->scanAlpha && format == TEXTURE_FORMAT_AUTO;
+    bands->restart     = false;
+    if (bands->scanAlpha) bands->data->opacity = IMAGE_OPAQUE;
+
+    if (bands->layout == PIXELS_UNSUPPORTED || bands->layout == PIXELS_RGBA8) {
+        bands->layout = PIXELS_RGBA8;
+        return true;
+    }
+
+    state->decoder.color_convert = 0;
+    bands->mode         = &state->info_png.color;
+    bands->paletteBuilt = false;
+    bands->scratch      = malloc((size_t)width * 8 * 4);
+    return bands->scratch != NULL;
+}
+
+static void endTextureBands(TextureBands* bands) {
+    free(bands->scratch);
+    bands->scratch = NULL;
+}
+
+// Raises data->opacity to the class of 'count' more alpha samples, 4 bytes apart. Returns false
+// when a speculative format no longer holds that alpha; data->format is then the one that does.
+static bool raiseOpacity(TextureBands* bands, const u8* alpha, size_t count) {
+    TextureData* data = bands->data;
+    if (data->opacity == IMAGE_TRANSLUCENT) return true;
+
+    const ImageOpacity opacity = alphaOpacity(alpha, count, 4);
+    if (opacity <= data->opacity) return true;
+
+    data->opacity = opacity;
+    if (!bands->speculative || textureFormatFor(TEXTURE_FORMAT_AUTO, opacity) == data->format) return true;
+
+    data->format   = textureFormatFor(TEXTURE_FORMAT_AUTO, opacity);
+    bands->restart = true;
+    return false;
+}
+
+static unsigned swizzleBand (
+/*
+    SYNOPSIS
+        LodePNGRowCallback that swizzles one band of 8 decoded rows into a row of tiles.
+
+    DESCRIPTION
+        Bands start at multiples of 8, so each one fills exactly one row of tiles and the
+        dither pattern lines up with a whole-image swizzle. Rows of the last band below the
+        image are cleared like any other edge texel. Alpha is classified while the band is
+        still in the cache, raising data->opacity as needed. When that alpha does not fit a
+        speculative format, the decode is stopped with TEXTURE_BANDS_RESTART: the bands so
+        far went into the wrong format and the decode starts over in the new one. The
+        opacity is kept, so every format change is for good and there are at most two.
+*/
+    // TextureBands being filled
+    void* user,
+
+    // Decoded rows, in the layout of the TextureBands
+    const unsigned char* rows,
+
+    // First row of the band
+    unsigned y,
+
+    // Rows in the band
+    unsigned count,
+
+    // Row width in pixels
+    unsigned width
+) {
+    TextureBands* bands = (TextureBands*)user;
+    TextureData* data = bands->data;
+    const size_t tileRowBytes = (size_t)data->textureWidth * 8 * textureFormatBits(data->format) / 8;
+    u8* tiles = (u8*)data->data + (y >> 3) * tileRowBytes;
+
+    if (!bands->scratch) {
+        if (bands->scanAlpha && !raiseOpacity(bands, rows + 3, width * count)) return TEXTURE_BANDS_RESTART;
+        swizzleToFormat(data->format, tiles, data->textureWidth, 8, rows, width, count, bands->dither);
+        return 0;
+    }
+
+    if (bands->layout == PIXELS_PALETTE8 && !bands->paletteBuilt) {
+        buildPixelPalette(bands->palette, bands->mode, bands->order);
+        bands->paletteBuilt = true;
+    }
+
+    // 8-bit rows have no padding, so the band converts as one run of pixels
+    convertPixels(bands->layout, bands->order, bands->scratch, rows, width * count, bands->palette);
+    if (bands->scanAlpha && !raiseOpacity(bands, bands->scratch + (bands->order == PIXELS_ABGR ? 0 : 3), width * count)) {
+        return TEXTURE_BANDS_RESTART;
+    }
+    if (bands->order == PIXELS_ABGR) {
+        swizzleABGR8(tiles, data->textureWidth, 8, (const u32*)bands->scratch, width, count);
+    } else {
+        swizzleToFormat(data->format, tiles, data->textureWidth, 8, bands->scratch, width, count, bands->dither);
+    }
+    return 0;
+}
+
+static bool decodePNGBandsToTexture (
+/*
+    SYNOPSIS
+        Decodes a PNG straight into the texture, 8 rows at a time.
+
+    DESCRIPTION
+        The texture is allocated from the header alone, then lodepng_decode_rows hands over
+        bands of finished rows that are swizzled into place, so neither the decoded image nor
+        the whole inflated data is ever held in memory. Rows stay in the PNG's own color
+        mode where the pixel kernels can convert them. A TEXTURE_FORMAT_AUTO the header
+        could not settle starts out as the opaque format and decodes again whenever a band
+        shows alpha it cannot hold.
+*/
+    // Encoded PNG data
+    const unsigned char* png,
+
+    // Size of the encoded PNG data in bytes
+    size_t pngsize,
+
+    // Decoder state with info_raw set to 8-bit RGBA
+    LodePNGState* state,
+
+    // Texture format and dithering
+    const TextureOptions* options,
+
+    // Description of the decoded texture
+    TextureData* data,
+
+    // Provides the texture memory once its size is known
+    TextureAllocator allocate,
+
+    // Passed to 'allocate'
+    void* context
+) {
+    unsigned width, height;
+    TextureBands bands = { data, options->dither };
+
+    lodepng_inspect(&width, &height, state, png, pngsize);
+    describeTexture(data, bandFormat(options->format), width, height);
+
+    data->data = allocate(data, context);
+    if (!data->data) return false;
+
+    if (!beginTextureBands(&bands, state, options->format, width)) {
+        endTextureBands(&bands);
+        return false;
+    }
+    unsigned error;
+    do {
+        bands.restart = false;
+        error = lodepng_decode_rows(&width, &height, state, png, pngsize, 8, swizzleBand, &bands);
+    } while (error == TEXTURE_BANDS_RESTART && bands.restart);
+    endTextureBands(&bands);
+    if (error) {
+        printf("error %u: %s\n", error, lodepng_error_text(error));
+        return false;
+    }
+
+    return true;
+}
+
+static unsigned decodePNGImage (
+/*
+    SYNOPSIS
+        Decodes a whole PNG into an RGBA image.
+
+    DESCRIPTION
+        Where the pixel kernels read the PNG's own color mode, the image is decoded in that
+        mode and expanded to RGBA with convertPixels; otherwise lodepng converts it. Returns
+        a lodepng error code.
+*/
+    // Receives the image, 4 bytes per pixel in R,G,B,A order; release with free
+    unsigned char** image,
+
+    // Receive the image dimensions in pixels
+    unsigned* width,
+    unsigned* height,
+
+    // Decoder state with info_raw set to 8-bit RGBA
+    LodePNGState* state,
+
+    // Encoded PNG data
+    const unsigned char* png,
+
+    // Size of the encoded PNG data in bytes
+    size_t pngsize,
+
+    // The PNG's opacity from pngOpacity
+    ImageOpacity opacity
+) {
+    const PixelLayout layout = lodepng_inspect(width, height, state, png, pngsize)
+                             ? PIXELS_UNSUPPORTED : rowLayout(&state->info_png.color, opacity);
+    if (layout == PIXELS_UNSUPPORTED || layout == PIXELS_RGBA8) {
+        return lodepng_decode(image, width, height, state, png, pngsize);
+    }
+
+    unsigned char* native = NULL;
+    state->decoder.color_convert = 0;
+    const unsigned error = lodepng_decode(&native, width, height, state, png, pngsize);
+    if (error) return error;
+
+    u32 palette[256];
+    if (layout == PIXELS_PALETTE8) buildPixelPalette(palette, &state->info_png.color, PIXELS_RGBA);
+
+    *image = malloc((size_t)*width * *height * 4);
+    if (*image) convertPixels(layout, PIXELS_RGBA, *image, native, *width * *height, palette);
+    free(native);
+    return *image ? 0 : 83;
+}
+
+bool decodePNGToTexture (
+/*
+    SYNOPSIS
+        Decodes a PNG and swizzles it into texture memory obtained from an allocator.
+
+    DESCRIPTION
+        Decodes the PNG data, picks the texture size and format from the image and
+        'options', asks 'allocate' for the destination and fills it with tiled texels.
+        When the image fits a texture, rows are swizzled into place as they are decoded
+        and the RGBA image is never built. Automatic format selection is settled by
+        pngOpacity for art without an alpha channel; art with one is classified band by
+        band, see decodePNGBandsToTexture. Oversized art is decoded whole and scaled down.
+        data->opacity tells how the art uses alpha.
+        'data' describes the result. The caller keeps ownership of the PNG buffer; on
+        failure data->data may still hold memory handed out by the allocator.
+
+    EXAMPLE
+        TextureData data;
+        if (decodePNGToTexture(png, pngsize, &options, &data, allocateTextureData, NULL)) {
+            // data.data holds the tiled texture
+        }
+*/
+    // Encoded PNG data
+    const unsigned char* png,
+
+    // Size of the encoded PNG data in bytes
+    size_t pngsize,
+
+    // Texture format and dithering
+    const TextureOptions* options,
+
+    // Description of the decoded texture
+    TextureData* data,
+
+    // Provides the texture memory once its size is known
+    TextureAllocator allocate,
+
+    // Passed to 'allocate'
+    void* context
+) {
+    unsigned error;
+    unsigned char* image;
+    unsigned width, height;
+    LodePNGState state;
+
+    memset(data, 0, sizeof(*data));
+
+    // Initialize the PNG state with RGBA color type
+    lodepng_state_init(&state);
+    state.info_raw.colortype = LCT_RGBA;
+
+    // The color type and tRNS chunk usually settle the opacity, and with it an automatic format
+    TextureOptions resolved = *options;
+    data->opacity = pngOpacity(png, pngsize);
+    if (data->opacity != IMAGE_OPACITY_UNKNOWN) resolved.format = textureFormatFor(options->format, data->opacity);
+
+    // Unless the art has to be scaled down, the texture is filled band by band while decoding
+    if (!lodepng_inspect(&width, &height, &state, png, pngsize) &&
+        width <= MAX_TEXTURE_SIZE && height <= MAX_TEXTURE_SIZE) {
+        const bool decoded = decodePNGBandsToTexture(png, pngsize, &state, &resolved, data, allocate, context);
+        lodepng_state_cleanup(&state);
+        return decoded;
+    }
+
+    // Decode the PNG file into raw image data
+    error = decodePNGImage(&image, &width, &height, &state, png, pngsize, data->opacity);
+    lodepng_state_cleanup(&state);
+    if (error) {
+        printf("error %u: %s\n", error, lodepng_error_text(error));
+        return false;
+    }
+
+    // Art that does not fit the largest texture is scaled down instead of being clipped
+    if (width > MAX_TEXTURE_SIZE || height > MAX_TEXTURE_SIZE) {
+        const u32 factor = ((width > height ? width : height) + MAX_TEXTURE_SIZE - 1) / MAX_TEXTURE_SIZE;
+        printf("note: %ux%u image scaled down by %u to fit a texture\n", width, height, (unsigned)factor);
+
+        unsigned char* scaled = downscaleRGBA8(image, width, height, factor);
+        free(image);
+        if (!scaled) {
+            printf("error: out of memory scaling down %ux%u image\n", width, height);
+            return false;
+        }
+        image  = scaled;
+        width  /= factor;
+        height /= factor;
+
+        // Averaging softens the edges of binary alpha
+        if (data->opacity == IMAGE_BINARY_ALPHA) data->opacity = IMAGE_OPACITY_UNKNOWN;
+    }
+    if (data->opacity == IMAGE_OPACITY_UNKNOWN) data->opacity = imageOpacity(image, width, height);
+
+    // Pick the smallest texture the GPU accepts that still holds the whole image, in the
+    // requested (or automatically chosen) format
+    describeTexture(data, textureFormatFor(options->format, data->opacity), width, height);
+
+    data->data = allocate(data, context);
+    if (!data->data) {
+        free(image);
+        return false;
+    }
+
+    // Convert the PNG image data to texture format
+    swizzleToFormat(data->format, data->data, data->textureWidth, data->textureHeight, image, width, height,
+                    options->dither);
+
+    // Clean up the decoded image
+    free(image);
+    return true;
+}
+
+struct PNGDecode {
+    LodePNGState         state;
+    LodePNGRowDecoder*   rows;      // NULL when the image has to be decoded in one go
+    TextureBands         bands;
+    const unsigned char* png;
+    size_t               pngsize;
+    TextureOptions       options;
+    TextureAllocator     allocate;
+    void*                context;
+};
+
+PNGDecode* beginPNGDecode (
+/*
+    SYNOPSIS
+        Prepares decoding a PNG into texture memory a slice of time at a time.
+
+    DESCRIPTION
+        Reads the header and allocates the texture, but leaves inflating, unfiltering and
+        swizzling to advancePNGDecode, so a cover can stream in over several frames. The
+        PNG buffer must stay valid until endPNGDecode. Like decodePNGToTexture, art with
+        an alpha channel under TEXTURE_FORMAT_AUTO is classified band by band, and started
+        over in a 16-bit format with alpha when a band calls for one. Oversized art needs
+        the whole image; such a PNG is decoded entirely by the first advancePNGDecode.
+        Returns NULL, with nothing allocated, if the PNG cannot be decoded.
+
+    EXAMPLE
+        TextureData data;
+        PNGDecode* decode = beginPNGDecode(png, pngsize, &options, &data, allocateTextureData, NULL);
+        while (decode && advancePNGDecode(decode, 2000) == PNG_DECODE_PENDING) {
+            // draw a frame
+        }
+        endPNGDecode(decode);
+*/
+    // Encoded PNG data
+    const unsigned char* png,
+
+    // Size of the encoded PNG data in bytes
+    size_t pngsize,
+
+    // Texture format and dithering
+    const TextureOptions* options,
+
+    // Description of the decoded texture
+    TextureData* data,
+
+    // Provides the texture memory once its size is known
+    TextureAllocator allocate,
+
+    // Passed to 'allocate'
+    void* context
+) {
+    unsigned width, height;
+    PNGDecode* decode = calloc(1, sizeof(PNGDecode));
+    if (!decode) return NULL;
+
+    memset(data, 0, sizeof(*data));
+    decode->bands    = (TextureBands){ data, options->dither };
+    decode->png      = png;
+    decode->pngsize  = pngsize;
+    decode->options  = *options;
+    decode->allocate = allocate;
+    decode->context  = context;
+
+    // Initialize the PNG state with RGBA color type
+    lodepng_state_init(&decode->state);
+    decode->state.info_raw.colortype = LCT_RGBA;
+
+    data->opacity = pngOpacity(png, pngsize);
+    if (data->opacity != IMAGE_OPACITY_UNKNOWN) decode->options.format = textureFormatFor(options->format, data->opacity);
+
+    if (lodepng_inspect(&width, &height, &decode->state, png, pngsize) ||
+        width > MAX_TEXTURE_SIZE || height > MAX_TEXTURE_SIZE) {
+        return decode;
+    }
+
+    if (!beginTextureBands(&decode->bands, &decode->state, decode->options.format, width)) {
+        endPNGDecode(decode);
+        return NULL;
+    }
+    decode->rows = lodepng_row_decoder_new(&width, &height, &decode->state, png, pngsize, 8, swizzleBand,
+                                           &decode->bands);
+    if (!decode->rows) {
+        printf("error %u: %s\n", decode->state.error, lodepng_error_text(decode->state.error));
+        endPNGDecode(decode);
+        return NULL;
+    }
+
+    describeTexture(data, bandFormat(decode->options.format), width, height);
+    data->data = allocate(data, context);
+    if (!data->data) {
+        endPNGDecode(decode);
+        return NULL;
+    }
+
+    return decode;
+}
+
+PNGDecodeStatus advancePNGDecode (
+/*
+    SYNOPSIS
+        Continues a decode started by beginPNGDecode for about 'budgetUs' microseconds.
+
+    DESCRIPTION
+        Inflates PNG_DECODE_STEP_BYTES at a time and swizzles every band of 8 rows as soon
+        as it is complete, checking the clock between steps. At least one step is taken,
+        so a decode always makes progress; a step overruns the budget by a fraction of a
+        millisecond at most. A band that changes a TEXTURE_FORMAT_AUTO format starts the
+        rows over within the same budget.
+*/
+    // Decode to continue
+    PNGDecode* decode,
+
+    // Time to spend in microseconds
+    u32 budgetUs
+) {
+    if (!decode->rows) {
+        return decodePNGToTexture(decode->png, decode->pngsize, &decode->options, decode->bands.data,
+                                  decode->allocate, decode->context) ? PNG_DECODE_DONE : PNG_DECODE_FAILED;
+    }
+
+    const u64 deadline = svcGetSystemTick() + (u64)(budgetUs * CPU_TICKS_PER_USEC);
+    unsigned done = 0;
+
+    do {
+        const unsigned error = lodepng_row_decoder_step(decode->rows, PNG_DECODE_STEP_BYTES, &done);
+        if (error == TEXTURE_BANDS_RESTART && decode->bands.restart) {
+            unsigned width, height;
+            decode->bands.restart = false;
+            lodepng_row_decoder_free(decode->rows);
+            decode->rows = lodepng_row_decoder_new(&width, &height, &decode->state, decode->png, decode->pngsize, 8,
+                                                   swizzleBand, &decode->bands);
+            if (!decode->rows) {
+                printf("error %u: %s\n", decode->state.error, lodepng_error_text(decode->state.error));
+                return PNG_DECODE_FAILED;
+            }
+        } else if (error) {
+            printf("error %u: %s\n", error, lodepng_error_text(error));
+            return PNG_DECODE_FAILED;
+        }
+    } while (!done && svcGetSystemTick() < deadline);
+
+    return done ? PNG_DECODE_DONE : PNG_DECODE_PENDING;
+}
+
+void endPNGDecode (
+/*
+    SYNOPSIS
+        Releases a decode started by beginPNGDecode.
+
+    DESCRIPTION
+        The texture memory is not released; it belongs to the caller whether or not the
+        decode completed.
+*/
+    // Decode to release, may be NULL
+    PNGDecode* decode
+) {
+    if (!decode) return;
+
+    lodepng_row_decoder_free(decode->rows);
+    lodepng_state_cleanup(&decode->state);
+    endTextureBands(&decode->bands);
+    free(decode);
+}
+
+C2D_Image uploadTextureData (
+/*
+    SYNOPSIS
+        Creates a C2D_Image from texture data prepared off the GPU thread.
+
+    DESCRIPTION
+        Allocates the texture and copies the tiled texels into it. The texture data is
+        not released. Must be called on the thread that owns the GPU.
+
+    EXAMPLE
+        C2D_Image img = uploadTextureData(&result.data);
+        freeTextureData(&result.data);
+*/
+    // Texture data produced with allocateTextureData
+    const TextureData* data
+) {
+    C2D_Image img;
+    if (!data->data || !createC2DImage(&img, data->width, data->height, data->textureWidth, data->textureHeight,
+                                       data->format)) {
+        return (C2D_Image){0};
+    }
+
+    memcpy(img.tex->data, data->data, data->size < img.tex->size ? data->size : img.tex->size);
+    C3D_TexFlush(img.tex);
+
+    return img;
+}
+
+void freeTextureData (
+/*
+    SYNOPSIS
+        Releases texture data obtained from allocateTextureData.
+*/
+    // Texture data to be released
+    TextureData* data
+) {
+    free(data->data);
+    data->data = NULL;
+}
+
+bool loadT3XTexture (
+/*
+    SYNOPSIS
+        Reads a .t3x texture baked at build time into memory from an allocator.
+
+    DESCRIPTION
+        The texture is imported with Tex3DS_TextureImportStdio, which already holds it
+        tiled in its final format, so nothing is decoded; the texels of the first
+        sub-texture's level 0 are copied into the allocator's memory and hashed into
+        data->sourceHash. The import
+        allocates from the linear heap, so this belongs on the GPU thread. A missing
+        file is not an error; it returns false with nothing allocated so callers can
+        fall back to the other sources. On other failures data->data may still hold
+        memory handed out by the allocator.
+
+    EXAMPLE
+        TextureData data;
+        if (!loadT3XTexture("romfs:/gfx/cover0.t3x", &data, allocateTextureData, NULL)) {
+            freeTextureData(&data);
+        }
+*/
+    // Filename of the .t3x file to load
+    const char* filename,
+
+    // Description of the loaded texture
+    TextureData* data,
+
+    // Provides the texture memory once its size is known
+    TextureAllocator allocate,
+
+    // Passed to 'allocate'
+    void* context
+) {
+    memset(data, 0, sizeof(*data));
+
+    FILE* file = fopen(filename, "rb");
+    if (!file) return false;
+
+    C3D_Tex tex;
+    Tex3DS_Texture t3x = Tex3DS_TextureImportStdio(file, &tex, NULL, false);
+    fclose(file);
+    if (!t3x) {
+        printf("error: invalid baked texture %s\n", filename);
+        return false;
+    }
+
+    const Tex3DS_SubTexture* subtex = Tex3DS_GetSubTexture(t3x, 0);
+    data->format        = tex.fmt;
+    data->width         = subtex->width;
+    data->height        = subtex->height;
+    data->textureWidth  = tex.width;
+    data->textureHeight = tex.height;
+    data->size          = (size_t)tex.width * tex.height * textureFormatBits(tex.fmt) / 8;
+    data->opacity       = formatOpacity(tex.fmt);
+    data->data          = allocate(data, context);
+
+    if (data->data) {
+        memcpy(data->data, tex.data, data->size);
+        data->sourceHash = hash64(data->data, data->size, 0);
+    }
+
+    C3D_TexDelete(&tex);
+    Tex3DS_TextureFree(t3x);
+    return data->data != NULL;
+}
+
+C2D_Image convertPNGBufferToC2DImageWithOptions (
+/*
+    SYNOPSIS
+        Converts an in-memory PNG image to a C2D_Image format for rendering.
+
+    DESCRIPTION
+        Decodes the PNG data and converts the image data into a C2D_Image format suitable
+        for rendering, using the texture format and dithering given in 'options'. The
+        texels are swizzled straight into the texture. The caller keeps ownership of the
+        PNG buffer.
+
+    EXAMPLE
+        TextureOptions options = { GPU_RGB565, true };
+        C2D_Image image = convertPNGBufferToC2DImageWithOptions(png, pngsize, &options);
+
+        Converts the PNG image held in 'png' to a dithered RGB565 C2D_Image.
+*/
+    // Encoded PNG data
+    const unsigned char* png,
+
+    // Size of the encoded PNG data in bytes
+    size_t pngsize,
+
+    // Texture format and dithering
+    const TextureOptions* options
+) {
+    C2D_Image img = {0};
+    TextureData data;
+
+    if (!decodePNGToTexture(png, pngsize, options, &data, allocateC2DImageTexture, &img)) {
+        freeC2DImage(&img);
+        return (C2D_Image){0}; // Return an empty image in case of error
+    }
+
+    finishC2DImageTexture(&img, &data);
+    return img; // Return the created C2D_Image
+}
+
+C2D_Image convertPNGBufferToC2DImage (
+/*
+    SYNOPSIS
+        Converts an in-memory PNG image to a C2D_Image using defaultTextureOptions.
+
+    EXAMPLE
+        C2D_Image image = convertPNGBufferToC2DImage(png, pngsize);
+*/
+    // Encoded PNG data
+    const unsigned char* png,
+
+    // Size of the encoded PNG data in bytes
+    size_t pngsize
+) {
+    return convertPNGBufferToC2DImageWithOptions(png, pngsize, &defaultTextureOptions);
+}
+
+C2D_Image convertPNGToC2DImage (
+/*
+    SYNOPSIS
+        Converts a PNG image file to a C2D_Image format for rendering in a graphics application.
+
+    DESCRIPTION
+        Loads a PNG file specified by the filename, decodes it, and then converts the image
+        data into a C2D_Image format suitable for rendering. The function handles loading errors
+        and allocates necessary resources for the image conversion.
+
+    EXAMPLE
+        C2D_Image image = convertPNGToC2DImage("path/to/image.png");
+
+        Converts the PNG image at the specified path to a C2D_Image.
+*/
+    // Filename of the PNG image to be converted
+    const char* filename
+) {
+    unsigned error;
+    unsigned char* png;
+    size_t pngsize;
+
+    // Load the PNG file and handle any errors
+    error = lodepng_load_file(&png, &pngsize, filename);
+    if (error) {
+        printf("error %u: %s\n", error, lodepng_error_text(error));
+        return (C2D_Image){0}; // Return an empty image in case of error
+    }
+
+    C2D_Image img = convertPNGBufferToC2DImage(png, pngsize);
+
+    // The encoded file is no longer needed once the texture has been built
+    free(png);
+
+    return img; // Return the created C2D_Image
+}
+
+void freeC2DImage (
+/*
+    SYNOPSIS
+        Releases an image created by convertPNGToC2DImage.
+
+    DESCRIPTION
+        Deletes the GPU texture and frees the texture and sub-texture objects. The image is reset to an
+        empty image so it can safely be freed twice.
+
+    EXAMPLE
+        freeC2DImage(&boxes[i].BoxArtObject);
+*/
+    // Image to be released
+    C2D_Image* image
+) {
+    if (image->tex) {
+        C3D_TexDelete(image->tex);
+        free(image->tex);
+    }
+    free((void*)image->subtex);
+
+    *image = (C2D_Image){0};
+}
@@ -0,0 +1,268 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lodepng.h"
+#include "tiledimage.h"
+
+/*
+    Images larger than one texture.
+
+    The GPU samples textures of at most 1024x1024 texels, so a full-screen background
+    or a high-resolution banner is split into a grid of tiles, each a texture of its
+    own with a sub-texture covering the pixels it holds. The tiles are allocated from
+    the header, then filled band by band while lodepng decodes the rows, so neither the
+    decoded image nor the whole inflated data is ever held in memory.
+*/
+
+// Destination of the rows lodepng_decode_rows hands to fillTileBand
+typedef struct {
+    TiledImage* image;
+    bool        dither;
+    bool        scanAlpha;  // The header left the opacity open, so each band's alpha is classified
+    u8*         scratch;    // One band of one column of tiles, NULL for a single column
+} TiledBands;
+
+static unsigned fillTileBand (
+/*
+    SYNOPSIS
+        LodePNGRowCallback that swizzles one band of 8 decoded rows into the tiles it crosses.
+
+    DESCRIPTION
+        Tile rows start at multiples of TILED_IMAGE_TILE_SIZE, so a band never straddles
+        two of them and fills one row of 8x8 texel tiles in each texture of its grid row.
+        With several columns, each column's part of the band is gathered into contiguous
+        rows first, as the swizzles read rows as wide as the image they are given.
+*/
+    // TiledBands being filled
+    void* user,
+
+    // Decoded rows, 4 bytes per pixel in R,G,B,A order
+    const unsigned char* rows,
+
+    // First row of the band
+    unsigned y,
+
+    // Rows in the band
+    unsigned count,
+
+    // Row width in pixels
+    unsigned width
+) {
+    TiledBands* bands = (TiledBands*)user;
+    TiledImage* image = bands->image;
+    const u32 gridRow = y / TILED_IMAGE_TILE_SIZE;
+    const u32 tileY   = y % TILED_IMAGE_TILE_SIZE;
+
+    if (bands->scanAlpha && image->opacity != IMAGE_TRANSLUCENT) {
+        const ImageOpacity opacity = imageOpacity(rows, width, count);
+        if (opacity > image->opacity) image->opacity = opacity;
+    }
+
+    for (u32 column = 0; column < image->columns; column++) {
+        const C2D_Image* tile = &image->tiles[gridRow * image->columns + column];
+        const u32 span = tile->subtex->width;
+        const u8* source = rows;
+
+        if (bands->scratch) {
+            for (u32 row = 0; row < count; row++) {
+                memcpy(bands->scratch + (size_t)row * span * 4,
+                       rows + ((size_t)row * width + column * TILED_IMAGE_TILE_SIZE) * 4, (size_t)span * 4);
+            }
+            source = bands->scratch;
+        }
+
+        const size_t tileRowBytes = (size_t)tile->tex->width * 8 * textureFormatBits(image->format) / 8;
+        swizzleToFormat(image->format, (u8*)tile->tex->data + (tileY >> 3) * tileRowBytes, tile->tex->width, 8,
+                        source, span, count, bands->dither);
+    }
+
+    return 0;
+}
+
+static bool createTiles (
+/*
+    SYNOPSIS
+        Allocates the grid of textures for an image whose size and format are set.
+
+    DESCRIPTION
+        Full tiles are TILED_IMAGE_TILE_SIZE square; those on the right and bottom edges
+        get the smallest texture that holds what is left. Tiles clamp to their edge
+        texels rather than a border color, so filtering leaves no seams between them.
+*/
+    // Image with width, height and format set
+    TiledImage* image
+) {
+    image->columns = (u16)((image->width  + TILED_IMAGE_TILE_SIZE - 1) / TILED_IMAGE_TILE_SIZE);
+    image->rows    = (u16)((image->height + TILED_IMAGE_TILE_SIZE - 1) / TILED_IMAGE_TILE_SIZE);
+    image->tiles   = calloc((size_t)image->columns * image->rows, sizeof(C2D_Image));
+    if (!image->tiles) return false;
+
+    for (u32 row = 0; row < image->rows; row++) {
+        for (u32 column = 0; column < image->columns; column++) {
+            const u32 x = column * TILED_IMAGE_TILE_SIZE;
+            const u32 y = row * TILED_IMAGE_TILE_SIZE;
+            const u32 width  = image->width  - x < TILED_IMAGE_TILE_SIZE ? image->width  - x : TILED_IMAGE_TILE_SIZE;
+            const u32 height = image->height - y < TILED_IMAGE_TILE_SIZE ? image->height - y : TILED_IMAGE_TILE_SIZE;
+            C2D_Image* tile = &image->tiles[row * image->columns + column];
+
+            if (!createC2DImage(tile, width, height, textureSizeFor(width), textureSizeFor(height), image->format)) {
+                return false;
+            }
+            C3D_TexSetWrap(tile->tex, GPU_CLAMP_TO_EDGE, GPU_CLAMP_TO_EDGE);
+        }
+    }
+
+    return true;
+}
+
+bool loadTiledImage (
+/*
+    SYNOPSIS
+        Decodes a PNG of any size into a grid of textures.
+
+    DESCRIPTION
+        Unlike the cover loaders, art beyond MAX_TEXTURE_SIZE is neither clipped nor
+        scaled down. The format follows 'options'; TEXTURE_FORMAT_AUTO is settled from
+        pngOpacity before any pixel is decoded, so art with an alpha channel gets
+        GPU_RGBA4. Peak memory is the tiles plus one band of rows. On failure the image
+        is left empty.
+
+    EXAMPLE
+        TiledImage background;
+        if (loadTiledImage(&background, png, pngsize, &defaultTextureOptions)) {
+            drawTiledImage(&background, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f);
+        }
+*/
+    // Image to be created
+    TiledImage* image,
+
+    // Encoded PNG data
+    const unsigned char* png,
+
+    // Size of the encoded PNG data in bytes
+    size_t pngsize,
+
+    // Texture format and dithering
+    const TextureOptions* options
+) {
+    unsigned width, height;
+    LodePNGState state;
+    TiledBands bands = { image, options->dither };
+
+    memset(image, 0, sizeof(*image));
+    lodepng_state_init(&state);
+    state.info_raw.colortype = LCT_RGBA;
+
+    unsigned error = lodepng_inspect(&width, &height, &state, png, pngsize);
+    if (!error) {
+        image->width   = width;
+        image->height  = height;
+        image->opacity = pngOpacity(png, pngsize);
+        image->format  = textureFormatFor(options->format, image->opacity);
+
+        bands.scanAlpha = image->opacity == IMAGE_OPACITY_UNKNOWN;
+        if (bands.scanAlpha) image->opacity = IMAGE_OPAQUE;
+
+        if (!createTiles(image) ||
+            (image->columns > 1 && !(bands.scratch = malloc((size_t)TILED_IMAGE_TILE_SIZE * 8 * 4)))) {
+            error = 83;
+        }
+    }
+    if (!error) error = lodepng_decode_rows(&width, &height, &state, png, pngsize, 8, fillTileBand, &bands);
+
+    free(bands.scratch);
+    lodepng_state_cleanup(&state);
+    if (error) {
+        printf("error %u: %s\n", error, lodepng_error_text(error));
+        freeTiledImage(image);
+        return false;
+    }
+
+    for (u32 i = 0; i < (u32)image->columns * image->rows; i++) {
+        C3D_TexFlush(image->tiles[i].tex);
+    }
+    return true;
+}
+
+bool loadTiledImageFile (
+/*
+    SYNOPSIS
+        Loads the PNG at 'filename' into a grid of textures, see loadTiledImage.
+
+    EXAMPLE
+        TiledImage banner;
+        loadTiledImageFile(&banner, "romfs:/gfx/banner.png", &defaultTextureOptions);
+*/
+    // Image to be created
+    TiledImage* image,
+
+    // Filename of the PNG image
+    const char* filename,
+
+    // Texture format and dithering
+    const TextureOptions* options
+) {
+    unsigned char* png;
+    size_t pngsize;
+
+    memset(image, 0, sizeof(*image));
+    const unsigned error = lodepng_load_file(&png, &pngsize, filename);
+    if (error) {
+        printf("error %u: %s\n", error, lodepng_error_text(error));
+        return false;
+    }
+
+    const bool loaded = loadTiledImage(image, png, pngsize, options);
+    free(png);
+    return loaded;
+}
+
+void drawTiledImage (
+/*
+    SYNOPSIS
+        Draws a tiled image as one.
+
+    DESCRIPTION
+        Each tile is drawn at its offset in the grid, scaled like the whole image.
+
+    EXAMPLE
+        drawTiledImage(&background, 0.0f, 0.0f, 0.0f, 400.0f / background.width, 240.0f / background.height);
+*/
+    // Image to draw
+    const TiledImage* image,
+
+    // Position of the top-left corner and depth
+    float x,
+    float y,
+    float depth,
+
+    // Scale factors
+    float scaleX,
+    float scaleY
+) {
+    const float step = TILED_IMAGE_TILE_SIZE;
+
+    for (u32 row = 0; row < image->rows; row++) {
+        for (u32 column = 0; column < image->columns; column++) {
+            C2D_DrawImageAt(image->tiles[row * image->columns + column], x + column * step * scaleX,
+                            y + row * step * scaleY, depth, NULL, scaleX, scaleY);
+        }
+    }
+}
+
+void freeTiledImage (
+/*
+    SYNOPSIS
+        Releases the textures of a tiled image and leaves it empty.
+*/
+    // Image to release
+    TiledImage* image
+) {
+    if (image->tiles) {
+        for (u32 i = 0; i < (u32)image->columns * image->rows; i++) {
+            freeC2DImage(&image->tiles[i]);
+        }
+        free(image->tiles);
+    }
+    memset(image, 0, sizeof(*image));
+}